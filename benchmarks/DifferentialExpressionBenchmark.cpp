@@ -0,0 +1,577 @@
+// Micro-benchmarks of the DE engine phases on synthetic single-cell-like matrices
+// Results are written as JSON lines or CSV, one record per scenario, selection shape and phase.
+
+#include "SyntheticData.h"
+
+#include "engine/ChunkedStatistics.h"
+#include "engine/DifferentialExpression.h"
+#include "engine/DimensionRanges.h"
+#include "engine/IncrementalAggregates.h"
+#include "engine/PerformanceTrace.h"
+#include "engine/ResultTable.h"
+#include "engine/ScanBatcher.h"
+#include "engine/StatisticsRegistry.h"
+#include "engine/TransposedMatrix.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace local
+{
+    const char* usage =
+        "Usage: DifferentialExpressionBenchmark [options]\n"
+        "\n"
+        "  --preset NAME        quick, default or large (sets rows and dims)\n"
+        "  --rows LIST          comma separated numbers of rows, overrides the preset\n"
+        "  --dims LIST          comma separated numbers of dimensions, overrides the preset\n"
+        "  --storage LIST       dense, sparse or both (default both)\n"
+        "  --types LIST         element types: float32, bfloat16, uint16, int16, uint8, int8 (default float32)\n"
+        "  --density VALUE      average fraction of non-zero elements (default 0.1)\n"
+        "  --shapes LIST        random, contiguous, strided, overlapping, imbalanced or all (default all)\n"
+        "  --fraction VALUE     fraction of rows per selection (default 0.1)\n"
+        "  --repetitions N      runs per measurement, the median is reported (default 3)\n"
+        "  --max-memory-gb GB   skip scenarios needing more memory (default 4)\n"
+        "  --format NAME        json (JSON lines) or csv (default json)\n"
+        "  --output FILE        write results to FILE instead of stdout\n";
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Measurement
+    {
+        std::vector<double> seconds;
+        std::uint64_t       bytes   = 0;
+        std::uint64_t       rows    = 0;
+    };
+
+    struct Record
+    {
+        std::string     storage;
+        std::string     elementType;
+        std::size_t     numRows         = 0;
+        std::size_t     numDimensions   = 0;
+        double          density         = 0;
+        std::uint64_t   numNonZeros     = 0;
+        std::string     selection;
+        std::size_t     sizeA           = 0;
+        std::size_t     sizeB           = 0;
+        std::string     phase;
+        Measurement     measurement;
+    };
+
+    std::vector<std::string> split(const std::string& text)
+    {
+        std::vector<std::string> parts;
+        std::stringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, ','))
+            if (!part.empty())
+                parts.push_back(part);
+        return parts;
+    }
+
+    std::vector<std::size_t> splitNumbers(const std::string& text)
+    {
+        std::vector<std::size_t> numbers;
+        for (const auto& part : split(text))
+            numbers.push_back(std::stoull(part));
+        return numbers;
+    }
+
+    de::ElementType parseElementType(const std::string& name)
+    {
+        for (const auto type : { de::ElementType::Float32, de::ElementType::BFloat16, de::ElementType::UInt16, de::ElementType::Int16, de::ElementType::UInt8, de::ElementType::Int8 })
+            if (de::elementTypeName(type) == name)
+                return type;
+        throw std::runtime_error("Unknown element type " + name);
+    }
+
+    SelectionShape parseShape(const std::string& name)
+    {
+        for (const auto shape : allSelectionShapes())
+            if (selectionShapeName(shape) == name)
+                return shape;
+        throw std::runtime_error("Unknown selection shape " + name);
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[values.size() / 2];
+    }
+
+    void writeRecord(std::ostream& output, const Record& record, bool csv)
+    {
+        const double seconds = median(record.measurement.seconds);
+        const double minimum = record.measurement.seconds.empty() ? 0.0 : *std::min_element(record.measurement.seconds.begin(), record.measurement.seconds.end());
+        const double gbPerSecond = seconds > 0 ? record.measurement.bytes / seconds / 1e9 : 0.0;
+        const double rowsPerSecond = seconds > 0 ? record.measurement.rows / seconds : 0.0;
+
+        if (csv)
+        {
+            output << record.storage << ',' << record.elementType << ',' << record.numRows << ',' << record.numDimensions << ','
+                   << record.density << ',' << record.numNonZeros << ',' << record.selection << ',' << record.sizeA << ','
+                   << record.sizeB << ',' << record.phase << ',' << record.measurement.seconds.size() << ',' << seconds << ','
+                   << minimum << ',' << record.measurement.bytes << ',' << gbPerSecond << ',' << rowsPerSecond << '\n';
+        }
+        else
+        {
+            output << "{\"storage\":\"" << record.storage << "\",\"element_type\":\"" << record.elementType
+                   << "\",\"rows\":" << record.numRows << ",\"dims\":" << record.numDimensions
+                   << ",\"density\":" << record.density << ",\"nnz\":" << record.numNonZeros
+                   << ",\"selection\":\"" << record.selection << "\",\"size_a\":" << record.sizeA << ",\"size_b\":" << record.sizeB
+                   << ",\"phase\":\"" << record.phase << "\",\"repetitions\":" << record.measurement.seconds.size()
+                   << ",\"seconds\":" << seconds << ",\"seconds_min\":" << minimum
+                   << ",\"bytes\":" << record.measurement.bytes << ",\"gb_per_s\":" << gbPerSecond
+                   << ",\"rows_per_s\":" << rowsPerSecond << "}\n";
+        }
+        output.flush();
+    }
+
+    const char* csvHeader = "storage,element_type,rows,dims,density,nnz,selection,size_a,size_b,phase,repetitions,seconds,seconds_min,bytes,gb_per_s,rows_per_s\n";
+
+    // Memory limit of the chunked runs, small enough to take several blocks for the default sizes
+    constexpr std::uint64_t chunkedMemoryLimit = 16ull << 20;
+
+    // Phases recorded by the engine's trace, mapped to benchmark phase names
+    const std::map<std::string, std::string> enginePhases = {
+        { "Allocate buffers", "allocate" },
+        { "Gather both selections", "gather" },
+        { "Means and medians (nth_element)", "medians" },
+        { "SD and % expressed", "sd_pct_expressed" },
+    };
+
+    template <typename Matrix>
+    std::vector<std::pair<std::string, Measurement>> benchmarkSelections(const Matrix& matrix, const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, const de::DimensionRanges& ranges, int repetitions)
+    {
+        const std::size_t numDimensions = matrix.numColumns;
+        const std::uint64_t selectedRows = a.size() + b.size();
+
+        std::map<std::string, Measurement> measurements;
+        std::vector<std::string> order;
+        auto measurement = [&](const std::string& phase) -> Measurement& {
+            if (!measurements.contains(phase))
+                order.push_back(phase);
+            return measurements[phase];
+            };
+
+        de::DEOptions options;
+        options.additionalStatistics = true;
+
+        de::ScratchArena scratch;
+
+        for (int repetition = 0; repetition < repetitions; ++repetition)
+        {
+            de::PerformanceTrace trace;
+            trace.reset("benchmark");
+
+            const auto start = Clock::now();
+            const de::DEResult result = de::computeDifferentialExpression(matrix, a, b, options, nullptr, &trace);
+            const double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            std::map<std::string, std::pair<double, std::uint64_t>> phaseTotals;
+            for (const auto& event : trace.events())
+            {
+                const auto found = enginePhases.find(event.name);
+                if (found == enginePhases.end())
+                    continue;
+                phaseTotals[found->second].first += event.durationUs / 1e6;
+                phaseTotals[found->second].second += event.bytes;
+            }
+            for (const auto& [phase, total] : phaseTotals)
+            {
+                auto& m = measurement(phase);
+                m.seconds.push_back(total.first);
+                m.bytes = total.second;
+                m.rows = selectedRows;
+            }
+
+            auto& total = measurement("de_total");
+            total.seconds.push_back(totalSeconds);
+            total.rows = selectedRows;
+
+            // the same statistics from buffers kept between the repetitions
+            {
+                de::DEOptions scratchOptions = options;
+                scratchOptions.scratch = &scratch;
+
+                const auto scratchStart = Clock::now();
+                const de::DEResult scratchResult = de::computeDifferentialExpression(matrix, a, b, scratchOptions);
+                auto& reused = measurement("de_scratch");
+                reused.seconds.push_back(std::chrono::duration<double>(Clock::now() - scratchStart).count());
+                reused.rows = selectedRows;
+            }
+
+            // the same statistics with the median columns hidden, which are then not computed
+            {
+                de::DEOptions lazyOptions = options;
+                lazyOptions.medians = false;
+                lazyOptions.scratch = &scratch;
+
+                const auto lazyStart = Clock::now();
+                const de::DEResult lazyResult = de::computeDifferentialExpression(matrix, a, b, lazyOptions);
+                auto& lazy = measurement("de_without_medians");
+                lazy.seconds.push_back(std::chrono::duration<double>(Clock::now() - lazyStart).count());
+                lazy.rows = selectedRows;
+            }
+
+            // the same statistics in bounded memory, from aggregates of row blocks
+            {
+                const std::vector<float> rescaleValues = de::rescaleFactors(ranges);
+                de::DEOptions chunkedOptions = options;
+                chunkedOptions.minValues = ranges.minimum;
+                chunkedOptions.rescaleValues = rescaleValues;
+                const de::ChunkPlan plan = de::planChunks(2, numDimensions, 1, chunkedMemoryLimit);
+
+                const auto chunkedStart = Clock::now();
+                const de::DEResult chunkedResult = de::computeDifferentialExpressionChunked(matrix, a, b, chunkedOptions, plan);
+                auto& chunked = measurement("de_chunked");
+                chunked.seconds.push_back(std::chrono::duration<double>(Clock::now() - chunkedStart).count());
+                chunked.rows = matrix.numRows;
+            }
+
+            // aggregates of both selections, then again as a second view on the dataset finds them in the registry
+            {
+                const std::vector<float> rescaleValues = de::rescaleFactors(ranges);
+                de::AggregationOptions aggregationOptions;
+                aggregationOptions.minValues = ranges.minimum;
+                aggregationOptions.rescaleValues = rescaleValues;
+
+                de::StatisticsRegistry registry;
+                const de::DatasetKey key = registry.key("benchmark");
+                const std::array<de::RowIndices, 2> selections = { de::RowIndices(a), de::RowIndices(b) };
+
+                const auto scanStart = Clock::now();
+                de::aggregateSelections(matrix, selections, aggregationOptions, registry, key);
+                auto& scan = measurement("aggregate_selections");
+                scan.seconds.push_back(std::chrono::duration<double>(Clock::now() - scanStart).count());
+                scan.rows = matrix.numRows;
+
+                const auto registeredStart = Clock::now();
+                de::aggregateSelections(matrix, selections, aggregationOptions, registry, key);
+                auto& registered = measurement("aggregate_registered");
+                registered.seconds.push_back(std::chrono::duration<double>(Clock::now() - registeredStart).count());
+                registered.rows = selectedRows;
+            }
+
+            // three views asking for A, B and both at once: a scan per request, then one batched scan for all
+            {
+                const std::vector<float> rescaleValues = de::rescaleFactors(ranges);
+                de::AggregationOptions aggregationOptions;
+                aggregationOptions.minValues = ranges.minimum;
+                aggregationOptions.rescaleValues = rescaleValues;
+
+                const std::vector<de::ScanBatcher::Selections> requests = { { a }, { b }, { a, b } };
+
+                const auto separateStart = Clock::now();
+                for (const auto& request : requests)
+                {
+                    const std::vector<de::RowIndices> selections(request.begin(), request.end());
+                    de::aggregateGroups(matrix, de::GroupMembership::fromSelections(matrix.numRows, selections), aggregationOptions);
+                }
+                auto& separate = measurement("aggregate_separate");
+                separate.seconds.push_back(std::chrono::duration<double>(Clock::now() - separateStart).count());
+                separate.rows = 3 * matrix.numRows;
+
+                de::StatisticsRegistry registry;
+                de::ScanBatcher batcher;
+                const de::DatasetKey key = registry.key("benchmark");
+                for (const auto& request : requests)
+                {
+                    batcher.submit(key, aggregationOptions, request,
+                        [&](std::span<const de::RowIndices> selections, de::ProgressSink* progress) {
+                            return de::aggregateSelections(matrix, selections, aggregationOptions, registry, key, progress);
+                        }, nullptr, nullptr);
+                }
+
+                const auto batchedStart = Clock::now();
+                batcher.run();
+                auto& batched = measurement("aggregate_batched");
+                batched.seconds.push_back(std::chrono::duration<double>(Clock::now() - batchedStart).count());
+                batched.rows = matrix.numRows;
+            }
+
+            // a Histogram run after A was aggregated in the background while B was drawn: only B is scanned
+            {
+                const std::vector<float> rescaleValues = de::rescaleFactors(ranges);
+                de::DEOptions histogramOptions = options;
+                histogramOptions.minValues = ranges.minimum;
+                histogramOptions.rescaleValues = rescaleValues;
+
+                de::AggregationOptions aggregationOptions;
+                aggregationOptions.minValues = ranges.minimum;
+                aggregationOptions.rescaleValues = rescaleValues;
+                aggregationOptions.expressedThreshold = histogramOptions.expressedThreshold;
+
+                de::StatisticsRegistry registry;
+                const de::DatasetKey key = registry.key("benchmark");
+                const de::RowIndices saved[] = { a };
+                de::aggregateSelections(matrix, std::span<const de::RowIndices>(saved), aggregationOptions, registry, key);
+
+                const auto speculativeStart = Clock::now();
+                de::computeDifferentialExpressionRegistered(matrix, a, b, histogramOptions, aggregationOptions.numBins, registry, key);
+                auto& speculative = measurement("de_histogram_speculative");
+                speculative.seconds.push_back(std::chrono::duration<double>(Clock::now() - speculativeStart).count());
+                speculative.rows = b.size();
+            }
+
+            // a brushed selection: A loses a twentieth of its rows, only those are scanned again
+            {
+                const std::vector<float> rescaleValues = de::rescaleFactors(ranges);
+                de::AggregationOptions aggregationOptions;
+                aggregationOptions.minValues = ranges.minimum;
+                aggregationOptions.rescaleValues = rescaleValues;
+
+                de::IncrementalAggregates live;
+                live.update(matrix, a, aggregationOptions);
+
+                const std::vector<std::uint32_t> brushed(a.begin() + a.size() / 20, a.end());
+
+                const auto incrementalStart = Clock::now();
+                live.update(matrix, brushed, aggregationOptions);
+                auto& incremental = measurement("aggregate_incremental");
+                incremental.seconds.push_back(std::chrono::duration<double>(Clock::now() - incrementalStart).count());
+                incremental.rows = a.size() - brushed.size();
+            }
+
+            // the same statistics from the selected non-zeros only
+            {
+                const auto sparseStart = Clock::now();
+                const de::DEResult sparseResult = de::computeDifferentialExpressionSparse(matrix, a, b, options);
+                auto& sparse = measurement("de_sparse");
+                sparse.seconds.push_back(std::chrono::duration<double>(Clock::now() - sparseStart).count());
+                sparse.rows = selectedRows;
+            }
+
+            // the same statistics from count histograms, for integer-valued data only
+            if (std::find(ranges.integral.begin(), ranges.integral.end(), std::uint8_t(0)) == ranges.integral.end())
+            {
+                de::DEOptions countsOptions = options;
+                countsOptions.minValues = ranges.minimum;
+                countsOptions.maxValues = ranges.maximum;
+                countsOptions.integralDimensions = ranges.integral;
+
+                const auto countsStart = Clock::now();
+                const de::DEResult countsResult = de::computeDifferentialExpressionCounts(matrix, a, b, countsOptions);
+                auto& counts = measurement("de_counts");
+                counts.seconds.push_back(std::chrono::duration<double>(Clock::now() - countsStart).count());
+                counts.rows = selectedRows;
+            }
+
+            // the same statistics from a dimension-major copy, the transpose is paid once per dataset
+            {
+                const auto transposeStart = Clock::now();
+                const de::MatrixData transposed = de::transposeMatrix(matrix);
+                auto& transpose = measurement("transpose");
+                transpose.seconds.push_back(std::chrono::duration<double>(Clock::now() - transposeStart).count());
+                transpose.bytes = transposed.bytes();
+                transpose.rows = matrix.numRows;
+
+                const Matrix transposedMatrix = de::transposedView<Matrix>(transposed);
+                const auto transposedStart = Clock::now();
+                const de::DEResult transposedResult = de::computeDifferentialExpressionTransposed(transposedMatrix, a, b, options);
+                auto& statistics = measurement("de_transposed");
+                statistics.seconds.push_back(std::chrono::duration<double>(Clock::now() - transposedStart).count());
+                statistics.rows = selectedRows;
+            }
+
+            // table rows as presented: rounded values per dimension
+            auto tableStart = Clock::now();
+            std::vector<std::array<float, 9>> table(numDimensions);
+            for (std::size_t d = 0; d < numDimensions; ++d)
+            {
+                table[d] = { de::roundTo(result.de(d), 3), de::roundTo(result.meanA[d], 3), de::roundTo(result.meanB[d], 3),
+                             de::roundTo(result.medianA[d], 3), de::roundTo(result.medianB[d], 3), de::roundTo(result.sdA[d], 3),
+                             de::roundTo(result.sdB[d], 3), de::roundTo(result.pctExpressedA[d], 3), de::roundTo(result.pctExpressedB[d], 3) };
+            }
+            auto& tableMeasurement = measurement("table");
+            tableMeasurement.seconds.push_back(std::chrono::duration<double>(Clock::now() - tableStart).count());
+            tableMeasurement.bytes = table.size() * sizeof(table[0]);
+            tableMeasurement.rows = numDimensions;
+
+            // sorting the table on the DE column, as when clicking its header
+            auto sortStart = Clock::now();
+            std::vector<std::uint32_t> permutation(numDimensions);
+            std::iota(permutation.begin(), permutation.end(), 0u);
+            std::stable_sort(permutation.begin(), permutation.end(), [&table](std::uint32_t l, std::uint32_t r) { return table[l][0] > table[r][0]; });
+            auto& sortMeasurement = measurement("sort");
+            sortMeasurement.seconds.push_back(std::chrono::duration<double>(Clock::now() - sortStart).count());
+            sortMeasurement.bytes = permutation.size() * sizeof(std::uint32_t);
+            sortMeasurement.rows = numDimensions;
+
+            // CSV export
+            auto csvStart = Clock::now();
+            std::ostringstream csv;
+            de::writeResultTable(csv, result, {}, ',');
+            const auto csvSize = csv.str().size();
+            auto& csvMeasurement = measurement("csv_export");
+            csvMeasurement.seconds.push_back(std::chrono::duration<double>(Clock::now() - csvStart).count());
+            csvMeasurement.bytes = csvSize;
+            csvMeasurement.rows = numDimensions;
+        }
+
+        std::vector<std::pair<std::string, Measurement>> ordered;
+        for (const auto& phase : order)
+            ordered.emplace_back(phase, measurements[phase]);
+        return ordered;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::map<std::string, std::string> arguments;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string name = argv[i];
+        if (name == "--help")
+        {
+            std::cerr << local::usage;
+            return EXIT_SUCCESS;
+        }
+        if (name.rfind("--", 0) != 0 || i + 1 >= argc)
+        {
+            std::cerr << local::usage;
+            return EXIT_FAILURE;
+        }
+        arguments[name] = argv[++i];
+    }
+
+    auto argument = [&arguments](const std::string& name, const std::string& defaultValue) -> std::string {
+        const auto found = arguments.find(name);
+        return found == arguments.end() ? defaultValue : found->second;
+        };
+
+    try
+    {
+        const std::map<std::string, std::pair<std::string, std::string>> presets = {
+            { "quick",   { "1000,10000",              "2000" } },
+            { "default", { "1000,10000,100000",       "2000,20000" } },
+            { "large",   { "1000,10000,100000,1000000", "2000,10000,50000" } },
+        };
+
+        const std::string presetName = argument("--preset", "default");
+        if (!presets.contains(presetName))
+            throw std::runtime_error("Unknown preset " + presetName);
+        const auto& preset = presets.at(presetName);
+
+        const auto rowCounts = local::splitNumbers(argument("--rows", preset.first));
+        const auto dimensionCounts = local::splitNumbers(argument("--dims", preset.second));
+        const double density = std::stod(argument("--density", "0.1"));
+        const double fraction = std::stod(argument("--fraction", "0.1"));
+        const int repetitions = std::max(1, std::stoi(argument("--repetitions", "3")));
+        const double maxMemoryBytes = std::stod(argument("--max-memory-gb", "4")) * 1e9;
+        const bool csv = argument("--format", "json") == "csv";
+
+        std::vector<de::MatrixStorage> storages;
+        const std::string storage = argument("--storage", "both");
+        if (storage == "dense" || storage == "both")
+            storages.push_back(de::MatrixStorage::Dense);
+        if (storage == "sparse" || storage == "both")
+            storages.push_back(de::MatrixStorage::Sparse);
+
+        std::vector<de::ElementType> elementTypes;
+        for (const auto& name : local::split(argument("--types", "float32")))
+            elementTypes.push_back(local::parseElementType(name));
+
+        std::vector<SelectionShape> shapes;
+        const std::string shapeList = argument("--shapes", "all");
+        if (shapeList == "all")
+            shapes = allSelectionShapes();
+        else
+            for (const auto& name : local::split(shapeList))
+                shapes.push_back(local::parseShape(name));
+
+        std::ofstream outputFile;
+        if (arguments.contains("--output"))
+        {
+            outputFile.open(arguments["--output"], std::ios::trunc);
+            if (!outputFile)
+                throw std::runtime_error("Cannot open " + arguments["--output"] + " for writing");
+        }
+        std::ostream& output = outputFile.is_open() ? outputFile : std::cout;
+
+        if (csv)
+            output << local::csvHeader;
+
+        for (const auto matrixStorage : storages)
+        for (const auto elementType : elementTypes)
+        for (const auto numRows : rowCounts)
+        for (const auto numDimensions : dimensionCounts)
+        {
+            SyntheticMatrixSpec spec;
+            spec.numRows = numRows;
+            spec.numColumns = numDimensions;
+            spec.storage = matrixStorage;
+            spec.elementType = elementType;
+            spec.density = density;
+
+            // the matrix plus the float copies of both selections
+            const double requiredBytes = estimateMatrixBytes(spec) + 2.0 * numRows * fraction * numDimensions * sizeof(float) * 2.5;
+            const std::string storageName = matrixStorage == de::MatrixStorage::Dense ? "dense" : "sparse";
+            if (requiredBytes > maxMemoryBytes)
+            {
+                std::cerr << "Skipping " << storageName << " " << numRows << " x " << numDimensions << ": needs about " << de::PerformanceTrace::formatBytes(static_cast<std::uint64_t>(requiredBytes)) << "\n";
+                continue;
+            }
+
+            std::cerr << "Generating " << storageName << " " << de::elementTypeName(elementType) << " " << numRows << " x " << numDimensions << "\n";
+            const de::MatrixData matrix = generateMatrix(spec);
+
+            local::Record base;
+            base.storage = storageName;
+            base.elementType = std::string(de::elementTypeName(elementType));
+            base.numRows = numRows;
+            base.numDimensions = numDimensions;
+            base.density = density;
+            base.numNonZeros = matrixStorage == de::MatrixStorage::Sparse ? matrix.columnIndices.size() : 0;
+
+            matrix.visit([&](const auto& view) {
+                // range scan over all rows, independent of the selections
+                de::DimensionRanges ranges;
+                local::Record rangeRecord = base;
+                rangeRecord.selection = "all";
+                rangeRecord.phase = "range_scan";
+                for (int repetition = 0; repetition < repetitions; ++repetition)
+                {
+                    const auto start = local::Clock::now();
+                    ranges = de::computeDimensionRanges(view);
+                    rangeRecord.measurement.seconds.push_back(std::chrono::duration<double>(local::Clock::now() - start).count());
+                }
+                rangeRecord.measurement.bytes = matrix.values.size() + matrix.columnIndices.size() * sizeof(std::uint32_t) + matrix.rowOffsets.size() * sizeof(std::uint64_t);
+                rangeRecord.measurement.rows = numRows;
+                local::writeRecord(output, rangeRecord, csv);
+
+                for (const auto shape : shapes)
+                {
+                    const auto [a, b] = generateSelections(numRows, shape, fraction, 7);
+
+                    for (const auto& [phase, measurement] : local::benchmarkSelections(view, a, b, ranges, repetitions))
+                    {
+                        local::Record record = base;
+                        record.selection = selectionShapeName(shape);
+                        record.sizeA = a.size();
+                        record.sizeB = b.size();
+                        record.phase = phase;
+                        record.measurement = measurement;
+                        local::writeRecord(output, record, csv);
+                    }
+                }
+                });
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << "DifferentialExpressionBenchmark: " << exception.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+#include "SyntheticData.h"
+
+#include "engine/TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace local
+{
+    constexpr std::size_t generatorBlockRows = 1024;
+
+    struct ColumnModel
+    {
+        std::vector<double> detectionRate;  // probability of a non-zero value
+        std::vector<double> meanCount;      // mean of the non-zero counts
+    };
+
+    ColumnModel columnModel(const SyntheticMatrixSpec& spec)
+    {
+        std::mt19937_64 generator(spec.seed);
+        std::exponential_distribution<double> detection(1.0);
+        std::lognormal_distribution<double> level(0.5, 1.0);
+
+        ColumnModel model;
+        model.detectionRate.resize(spec.numColumns);
+        model.meanCount.resize(spec.numColumns);
+
+        for (std::size_t column = 0; column < spec.numColumns; ++column)
+        {
+            model.detectionRate[column] = std::min(1.0, spec.density * detection(generator));
+            model.meanCount[column] = level(generator);
+        }
+
+        return model;
+    }
+
+    template <typename T>
+    T encode(double count)
+    {
+        if constexpr (std::is_integral_v<T>)
+            return static_cast<T>(std::min(count, static_cast<double>(std::numeric_limits<T>::max())));
+        else
+            return T(static_cast<float>(std::log1p(count)));
+    }
+
+    // Visits the non-zero elements of one row in column order
+    template <typename Visitor>
+    void generateRow(const ColumnModel& model, std::mt19937_64& generator, Visitor visitor)
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        for (std::size_t column = 0; column < model.detectionRate.size(); ++column)
+        {
+            if (uniform(generator) >= model.detectionRate[column])
+                continue;
+
+            // at least one count, geometric-like tail
+            const double count = 1.0 + std::floor(-std::log(1.0 - uniform(generator)) * model.meanCount[column]);
+            visitor(column, count);
+        }
+    }
+
+    template <typename T>
+    void generateDense(const SyntheticMatrixSpec& spec, const ColumnModel& model, de::MatrixData& matrix)
+    {
+        matrix.values.assign(spec.numRows * spec.numColumns * sizeof(T), std::byte{ 0 });
+        T* values = reinterpret_cast<T*>(matrix.values.data());
+
+        const std::ptrdiff_t numBlocks = static_cast<std::ptrdiff_t>((spec.numRows + generatorBlockRows - 1) / generatorBlockRows);
+
+        de::TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            std::mt19937_64 generator(spec.seed + 1 + block);
+            const std::size_t last = std::min((block + 1) * generatorBlockRows, spec.numRows);
+
+            for (std::size_t row = block * generatorBlockRows; row < last; ++row)
+            {
+                T* rowValues = values + row * spec.numColumns;
+                generateRow(model, generator, [rowValues](std::size_t column, double count) {
+                    rowValues[column] = encode<T>(count);
+                    });
+            }
+            });
+    }
+
+    template <typename T>
+    void generateSparse(const SyntheticMatrixSpec& spec, const ColumnModel& model, de::MatrixData& matrix)
+    {
+        const std::ptrdiff_t numBlocks = static_cast<std::ptrdiff_t>((spec.numRows + generatorBlockRows - 1) / generatorBlockRows);
+
+        std::vector<std::vector<std::uint32_t>> blockColumns(numBlocks);
+        std::vector<std::vector<T>> blockValues(numBlocks);
+        matrix.rowOffsets.assign(spec.numRows + 1, 0);
+
+        de::TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            std::mt19937_64 generator(spec.seed + 1 + block);
+            const std::size_t last = std::min((block + 1) * generatorBlockRows, spec.numRows);
+
+            for (std::size_t row = block * generatorBlockRows; row < last; ++row)
+            {
+                generateRow(model, generator, [&](std::size_t column, double count) {
+                    blockColumns[block].push_back(static_cast<std::uint32_t>(column));
+                    blockValues[block].push_back(encode<T>(count));
+                    });
+                matrix.rowOffsets[row + 1] = blockColumns[block].size();   // local to the block for now
+            }
+            });
+
+        // make the row offsets global and concatenate the blocks
+        std::uint64_t offset = 0;
+        for (std::ptrdiff_t block = 0; block < numBlocks; ++block)
+        {
+            const std::size_t last = std::min((block + 1) * generatorBlockRows, spec.numRows);
+            for (std::size_t row = block * generatorBlockRows; row < last; ++row)
+                matrix.rowOffsets[row + 1] += offset;
+            offset += blockColumns[block].size();
+        }
+
+        matrix.columnIndices.reserve(offset);
+        matrix.values.resize(offset * sizeof(T));
+        T* values = reinterpret_cast<T*>(matrix.values.data());
+        for (std::ptrdiff_t block = 0; block < numBlocks; ++block)
+        {
+            std::copy(blockValues[block].begin(), blockValues[block].end(), values + matrix.columnIndices.size());
+            matrix.columnIndices.insert(matrix.columnIndices.end(), blockColumns[block].begin(), blockColumns[block].end());
+        }
+    }
+
+    std::vector<std::uint32_t> randomRows(std::size_t numRows, std::size_t count, std::mt19937_64& generator)
+    {
+        std::vector<std::uint32_t> rows(numRows);
+        std::iota(rows.begin(), rows.end(), 0u);
+        std::shuffle(rows.begin(), rows.end(), generator);
+        rows.resize(std::min(count, numRows));
+        return rows;
+    }
+
+    void sortRows(std::vector<std::uint32_t>& rows)
+    {
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    }
+}
+
+de::MatrixData generateMatrix(const SyntheticMatrixSpec& spec)
+{
+    const local::ColumnModel model = local::columnModel(spec);
+
+    de::MatrixData matrix;
+    matrix.storage = spec.storage;
+    matrix.elementType = spec.elementType;
+    matrix.numRows = spec.numRows;
+    matrix.numColumns = spec.numColumns;
+
+    de::visitElementType(spec.elementType, [&](auto element) {
+        using T = decltype(element);
+        if (spec.storage == de::MatrixStorage::Sparse)
+            local::generateSparse<T>(spec, model, matrix);
+        else
+            local::generateDense<T>(spec, model, matrix);
+        });
+
+    return matrix;
+}
+
+std::uint64_t estimateMatrixBytes(const SyntheticMatrixSpec& spec)
+{
+    const std::uint64_t elements = static_cast<std::uint64_t>(spec.numRows) * spec.numColumns;
+    const std::size_t valueSize = de::elementSize(spec.elementType);
+
+    if (spec.storage == de::MatrixStorage::Dense)
+        return elements * valueSize;
+
+    const auto nonZeros = static_cast<std::uint64_t>(elements * spec.density);
+    return nonZeros * (valueSize + sizeof(std::uint32_t)) + (spec.numRows + 1) * sizeof(std::uint64_t);
+}
+
+const std::vector<SelectionShape>& allSelectionShapes()
+{
+    static const std::vector<SelectionShape> shapes = {
+        SelectionShape::Random, SelectionShape::Contiguous, SelectionShape::Strided, SelectionShape::Overlapping, SelectionShape::Imbalanced
+    };
+    return shapes;
+}
+
+std::string selectionShapeName(SelectionShape shape)
+{
+    switch (shape)
+    {
+    case SelectionShape::Random:        return "random";
+    case SelectionShape::Contiguous:    return "contiguous";
+    case SelectionShape::Strided:       return "strided";
+    case SelectionShape::Overlapping:   return "overlapping";
+    case SelectionShape::Imbalanced:    return "imbalanced";
+    }
+    return "unknown";
+}
+
+std::pair<std::vector<std::uint32_t>, std::vector<std::uint32_t>> generateSelections(std::size_t numRows, SelectionShape shape, double fraction, std::uint64_t seed)
+{
+    std::mt19937_64 generator(seed);
+    const auto selectionSize = std::max<std::size_t>(1, static_cast<std::size_t>(numRows * fraction));
+
+    std::vector<std::uint32_t> a, b;
+
+    switch (shape)
+    {
+    case SelectionShape::Random:
+    {
+        auto rows = local::randomRows(numRows, 2 * selectionSize, generator);
+        const auto middle = rows.begin() + rows.size() / 2;
+        a.assign(rows.begin(), middle);
+        b.assign(middle, rows.end());
+        break;
+    }
+    case SelectionShape::Contiguous:
+    {
+        for (std::size_t row = 0; row < std::min(selectionSize, numRows); ++row)
+            a.push_back(static_cast<std::uint32_t>(row));
+        for (std::size_t row = numRows - std::min(selectionSize, numRows); row < numRows; ++row)
+            b.push_back(static_cast<std::uint32_t>(row));
+        break;
+    }
+    case SelectionShape::Strided:
+    {
+        const std::size_t stride = std::max<std::size_t>(2, static_cast<std::size_t>(1.0 / fraction));
+        for (std::size_t row = 0; row < numRows; row += stride)
+            a.push_back(static_cast<std::uint32_t>(row));
+        for (std::size_t row = 1; row < numRows; row += stride)
+            b.push_back(static_cast<std::uint32_t>(row));
+        break;
+    }
+    case SelectionShape::Overlapping:
+    {
+        auto rows = local::randomRows(numRows, selectionSize + selectionSize / 2, generator);
+        a.assign(rows.begin(), rows.begin() + std::min(selectionSize, rows.size()));
+        b.assign(rows.begin() + selectionSize / 2, rows.end());
+        break;
+    }
+    case SelectionShape::Imbalanced:
+    {
+        auto rows = local::randomRows(numRows, selectionSize / 20 + 4 * selectionSize, generator);
+        const auto smallSize = std::max<std::size_t>(1, selectionSize / 20);
+        a.assign(rows.begin(), rows.begin() + std::min(smallSize, rows.size()));
+        b.assign(rows.begin() + std::min(smallSize, rows.size()), rows.end());
+        break;
+    }
+    }
+
+    local::sortRows(a);
+    local::sortRows(b);
+
+    return { std::move(a), std::move(b) };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "engine/MatrixIO.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*  Synthetic single-cell-like expression matrices for benchmarking
+    Every dimension (gene) gets a detection rate and an expression level drawn from skewed
+    distributions, so most genes are rarely detected and a few are detected almost everywhere,
+    like in UMI count data. Detected values are counts (integer element types) or log1p of
+    counts (float element types); everything else is zero.
+*/
+struct SyntheticMatrixSpec
+{
+    std::size_t         numRows     = 10'000;
+    std::size_t         numColumns  = 2'000;
+    de::MatrixStorage   storage     = de::MatrixStorage::Dense;
+    de::ElementType     elementType = de::ElementType::Float32;
+    double              density     = 0.1;      // average fraction of non-zero elements
+    std::uint64_t       seed        = 42;
+};
+
+de::MatrixData generateMatrix(const SyntheticMatrixSpec& spec);
+
+/** Bytes the matrix of \p spec occupies, without generating it */
+std::uint64_t estimateMatrixBytes(const SyntheticMatrixSpec& spec);
+
+enum class SelectionShape
+{
+    Random,         // two disjoint random subsets
+    Contiguous,     // a block at the start and a block at the end, as for sorted clusters
+    Strided,        // every k-th row, interleaved
+    Overlapping,    // random subsets sharing half of their rows
+    Imbalanced,     // a small selection against a large one
+};
+
+const std::vector<SelectionShape>& allSelectionShapes();
+std::string selectionShapeName(SelectionShape shape);
+
+/** Two sorted, unique row selections of about \p fraction of \p numRows rows each */
+std::pair<std::vector<std::uint32_t>, std::vector<std::uint32_t>> generateSelections(std::size_t numRows, SelectionShape shape, double fraction, std::uint64_t seed);
@@ -0,0 +1,367 @@
+// Headless benchmark of TableModel, TableSortFilterProxyModel and the table view
+// Runs on the offscreen Qt platform, fills the model at realistic sizes and measures every
+// operation's time and the number of TableModel::data() calls it causes. Results are checked
+// (sort order, filter row counts) so the run fails when a change breaks the models.
+
+#include "TableModel.h"
+#include "TableSortFilterProxyModel.h"
+#include "TableView.h"
+#include "WordWrapHeaderView.h"
+
+#include "engine/ResultTable.h"
+
+#include <QApplication>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace local
+{
+    const char* usage =
+        "Usage: TableModelBenchmark [options]\n"
+        "\n"
+        "  --rows LIST          comma separated numbers of table rows (default 1000,10000,60000)\n"
+        "  --additional VALUE   1 for the 10 column table with SD and % expressed, 0 for 6 columns (default 1)\n"
+        "  --repetitions N      runs per operation, the median is reported (default 3)\n"
+        "  --format NAME        json (JSON lines) or csv (default json)\n"
+        "  --output FILE        write results to FILE instead of stdout\n";
+
+    using Clock = std::chrono::steady_clock;
+
+    // TableModel that counts data() calls, the main cost driver of sorting, filtering and painting
+    class CountingTableModel : public TableModel
+    {
+    public:
+        CountingTableModel() : TableModel(nullptr, false) {}
+
+        QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override
+        {
+            _dataCalls.fetch_add(1, std::memory_order_relaxed);
+            return TableModel::data(index, role);
+        }
+
+        std::uint64_t takeDataCalls() { return _dataCalls.exchange(0, std::memory_order_relaxed); }
+
+    private:
+        mutable std::atomic<std::uint64_t> _dataCalls = 0;
+    };
+
+    struct Record
+    {
+        std::size_t             numRows     = 0;
+        std::size_t             numColumns  = 0;
+        std::string             operation;
+        std::vector<double>     seconds;
+        std::uint64_t           dataCalls   = 0;    // per repetition
+    };
+
+    std::vector<std::size_t> splitNumbers(const std::string& text)
+    {
+        std::vector<std::size_t> numbers;
+        std::stringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, ','))
+            if (!part.empty())
+                numbers.push_back(std::stoull(part));
+        return numbers;
+    }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[values.size() / 2];
+    }
+
+    const char* csvHeader = "rows,columns,operation,repetitions,seconds,seconds_min,data_calls,ns_per_data_call\n";
+
+    void writeRecord(std::ostream& output, const Record& record, bool csv)
+    {
+        const double seconds = median(record.seconds);
+        const double minimum = record.seconds.empty() ? 0.0 : *std::min_element(record.seconds.begin(), record.seconds.end());
+        const double nsPerCall = record.dataCalls > 0 ? seconds * 1e9 / record.dataCalls : 0.0;
+
+        if (csv)
+        {
+            output << record.numRows << ',' << record.numColumns << ',' << record.operation << ',' << record.seconds.size() << ','
+                   << seconds << ',' << minimum << ',' << record.dataCalls << ',' << nsPerCall << '\n';
+        }
+        else
+        {
+            output << "{\"rows\":" << record.numRows << ",\"columns\":" << record.numColumns
+                   << ",\"operation\":\"" << record.operation << "\",\"repetitions\":" << record.seconds.size()
+                   << ",\"seconds\":" << seconds << ",\"seconds_min\":" << minimum
+                   << ",\"data_calls\":" << record.dataCalls << ",\"ns_per_data_call\":" << nsPerCall << "}\n";
+        }
+        output.flush();
+    }
+
+    void check(bool condition, const std::string& message)
+    {
+        if (!condition)
+            throw std::runtime_error("Check failed: " + message);
+    }
+
+    // Gene-like dimension names, a few common prefixes followed by a number
+    std::vector<QString> dimensionNames(std::size_t numRows)
+    {
+        const char* prefixes[] = { "MT-", "RPL", "RPS", "CD", "IL", "HLA-", "GENE" };
+
+        std::vector<QString> names(numRows);
+        for (std::size_t row = 0; row < numRows; ++row)
+            names[row] = QString(prefixes[row % std::size(prefixes)]) + QString::number(row);
+        return names;
+    }
+
+    // Rows as the plugin builds them: the name followed by rounded floats
+    std::vector<std::vector<QVariant>> tableRows(const std::vector<QString>& names, std::size_t numColumns)
+    {
+        std::mt19937 generator(42);
+        std::normal_distribution<float> de(0.0f, 0.3f);
+        std::lognormal_distribution<float> statistic(0.0f, 1.0f);
+
+        std::vector<std::vector<QVariant>> rows(names.size());
+        for (std::size_t row = 0; row < names.size(); ++row)
+        {
+            rows[row].reserve(numColumns);
+            rows[row].push_back(names[row]);
+            rows[row].push_back(de::roundTo(de(generator), 3));
+            for (std::size_t column = 2; column < numColumns; ++column)
+                rows[row].push_back(de::roundTo(statistic(generator), 3));
+        }
+        return rows;
+    }
+
+    class Harness
+    {
+    public:
+        Harness(std::size_t numRows, bool additionalStatistics, int repetitions, std::ostream& output, bool csv) :
+            _numRows(numRows),
+            _numColumns(de::resultColumnNames(additionalStatistics).size()),
+            _repetitions(repetitions),
+            _output(output),
+            _csv(csv),
+            _names(dimensionNames(numRows)),
+            _rows(tableRows(_names, _numColumns))
+        {
+            _proxyModel.setSourceModel(&_model);
+
+            _view.setModel(&_proxyModel);
+            _view.setSortingEnabled(true);
+            _view.setSelectionMode(QAbstractItemView::SingleSelection);
+            _view.setSelectionBehavior(QAbstractItemView::SelectRows);
+
+            auto* horizontalHeader = new WordWrapHeaderView(Qt::Horizontal, &_view, true);
+            horizontalHeader->setSectionsClickable(true);
+            horizontalHeader->setSectionResizeMode(QHeaderView::Stretch);
+            horizontalHeader->setStretchLastSection(true);
+            horizontalHeader->setSortIndicator(1, Qt::AscendingOrder);
+            horizontalHeader->setDefaultAlignment(Qt::AlignBottom | Qt::AlignLeft | Qt::Alignment(Qt::TextWordWrap));
+            _view.setHorizontalHeader(horizontalHeader);
+
+            _view.resize(1200, 800);
+            _view.show();
+            QApplication::processEvents();
+        }
+
+        void run()
+        {
+            measure("build", [this] { build(); });
+            check(_proxyModel.rowCount() == static_cast<int>(_numRows), "all rows are shown after building");
+
+            for (const int column : { 0, 1, 2 })
+            {
+                for (const auto order : { Qt::AscendingOrder, Qt::DescendingOrder })
+                {
+                    const std::string name = "sort_column" + std::to_string(column) + (order == Qt::AscendingOrder ? "_ascending" : "_descending");
+                    measure(name, [this, column, order] { _proxyModel.sort(column, order); });
+                    checkSorted(column, order);
+                }
+            }
+
+            // from a selective to an unselective pattern, the last one clears the filter
+            for (const QString pattern : { QString("HLA-1"), QString("RPL"), QString("1"), QString() })
+            {
+                const std::string name = "filter_" + (pattern.isEmpty() ? std::string("clear") : pattern.toStdString());
+                measure(name, [this, &pattern] { _proxyModel.nameFilterChanged(pattern); });
+                checkFiltered(pattern);
+            }
+
+            _proxyModel.sort(1, Qt::DescendingOrder);
+
+            measure("scroll_page", [this] { scrollPages(20); }, 20);
+            measure("data_display_role", [this] { readAll(Qt::DisplayRole); });
+            measure("data_background_role", [this] { readAll(Qt::BackgroundRole); });
+            measure("csv_export", [this] { _model.createCSVString(','); });
+        }
+
+    private:
+        void build()
+        {
+            _model.startModelBuilding(_numColumns, _numRows);
+
+            const auto columnNames = de::resultColumnNames(_numColumns == 10);
+            for (std::size_t column = 0; column < columnNames.size(); ++column)
+                _model.setHorizontalHeader(column, QString::fromStdString(columnNames[column]));
+
+            for (std::size_t row = 0; row < _numRows; ++row)
+                _model.setRow(row, _rows[row], Qt::Unchecked, true);
+
+            _model.endModelBuilding();
+        }
+
+        // Scrolls \p pages pages down, painting the viewport after each step
+        void scrollPages(int pages)
+        {
+            QScrollBar* scrollBar = _view.verticalScrollBar();
+            scrollBar->setValue(scrollBar->minimum());
+
+            for (int page = 0; page < pages; ++page)
+            {
+                scrollBar->setValue(std::min(scrollBar->maximum(), scrollBar->value() + scrollBar->pageStep()));
+                _view.viewport()->repaint();
+            }
+        }
+
+        void readAll(int role)
+        {
+            const int numRows = _proxyModel.rowCount();
+            const int numColumns = _proxyModel.columnCount();
+            for (int row = 0; row < numRows; ++row)
+                for (int column = 0; column < numColumns; ++column)
+                    _proxyModel.data(_proxyModel.index(row, column), role);
+        }
+
+        void checkSorted(int column, Qt::SortOrder order)
+        {
+            const int numRows = _proxyModel.rowCount();
+            check(numRows == static_cast<int>(_numRows), "sorting keeps all rows");
+
+            for (int row = 1; row < numRows; ++row)
+            {
+                const QVariant previous = _proxyModel.data(_proxyModel.index(row - 1, column));
+                const QVariant current = _proxyModel.data(_proxyModel.index(row, column));
+                const bool ordered = order == Qt::AscendingOrder ? QVariant::compare(previous, current) != QPartialOrdering::Greater : QVariant::compare(previous, current) != QPartialOrdering::Less;
+                check(ordered, "column " + std::to_string(column) + " is sorted at row " + std::to_string(row));
+            }
+            _model.takeDataCalls();
+        }
+
+        void checkFiltered(const QString& pattern)
+        {
+            const auto expected = std::count_if(_names.cbegin(), _names.cend(), [&pattern](const QString& name) { return name.contains(pattern, Qt::CaseInsensitive); });
+            check(_proxyModel.rowCount() == expected, "filter \"" + pattern.toStdString() + "\" shows " + std::to_string(expected) + " rows");
+            _model.takeDataCalls();
+        }
+
+        void measure(const std::string& operation, const std::function<void()>& function, std::uint64_t steps = 1)
+        {
+            Record record;
+            record.numRows = _numRows;
+            record.numColumns = _numColumns;
+            record.operation = operation;
+
+            std::uint64_t dataCalls = 0;
+            for (int repetition = 0; repetition < _repetitions; ++repetition)
+            {
+                QApplication::processEvents();
+                _model.takeDataCalls();
+
+                const auto start = Clock::now();
+                function();
+                record.seconds.push_back(std::chrono::duration<double>(Clock::now() - start).count() / steps);
+
+                dataCalls += _model.takeDataCalls();
+            }
+            record.dataCalls = dataCalls / (static_cast<std::uint64_t>(_repetitions) * steps);
+
+            writeRecord(_output, record, _csv);
+        }
+
+        const std::size_t                   _numRows;
+        const std::size_t                   _numColumns;
+        const int                           _repetitions;
+        std::ostream&                       _output;
+        const bool                          _csv;
+        std::vector<QString>                _names;
+        std::vector<std::vector<QVariant>>  _rows;
+        CountingTableModel                  _model;
+        TableSortFilterProxyModel           _proxyModel;
+        TableView                           _view { nullptr };
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    // headless unless a platform is requested explicitly
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication application(argc, argv);
+
+    std::map<std::string, std::string> arguments;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string name = argv[i];
+        if (name == "--help")
+        {
+            std::cerr << local::usage;
+            return EXIT_SUCCESS;
+        }
+        if (name.rfind("--", 0) != 0 || i + 1 >= argc)
+        {
+            std::cerr << local::usage;
+            return EXIT_FAILURE;
+        }
+        arguments[name] = argv[++i];
+    }
+
+    auto argument = [&arguments](const std::string& name, const std::string& defaultValue) -> std::string {
+        const auto found = arguments.find(name);
+        return found == arguments.end() ? defaultValue : found->second;
+        };
+
+    try
+    {
+        const auto rowCounts = local::splitNumbers(argument("--rows", "1000,10000,60000"));
+        const bool additionalStatistics = argument("--additional", "1") != "0";
+        const int repetitions = std::max(1, std::stoi(argument("--repetitions", "3")));
+        const bool csv = argument("--format", "json") == "csv";
+
+        std::ofstream outputFile;
+        if (arguments.contains("--output"))
+        {
+            outputFile.open(arguments["--output"], std::ios::trunc);
+            if (!outputFile)
+                throw std::runtime_error("Cannot open " + arguments["--output"] + " for writing");
+        }
+        std::ostream& output = outputFile.is_open() ? outputFile : std::cout;
+
+        if (csv)
+            output << local::csvHeader;
+
+        for (const auto numRows : rowCounts)
+        {
+            local::Harness harness(numRows, additionalStatistics, repetitions, output, csv);
+            harness.run();
+        }
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << "TableModelBenchmark: " << exception.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
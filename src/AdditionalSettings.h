@@ -12,6 +12,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <utility>
 #include <vector>
 
@@ -102,15 +103,10 @@ public: // Getter
 
     bool checkMappingSurjective() const { return _checkMappingSurjective.isChecked(); }
 
-    std::vector<uint32_t>& getSelection(const QString& selectionName) {
-        if (selectionName == "A")
-            return _selectionA;
+    // selection of the mapping source saved along with the selection \p selectionName of the current data
+    std::vector<uint32_t>& getSelection(const QString& selectionName) { return _selections[selectionName]; }
 
-        return _selectionB;
-    }
-
-    std::vector<uint32_t>& getSelectionA() { return _selectionA; }
-    std::vector<uint32_t>& getSelectionB() { return _selectionB; }
+    void removeSelection(const QString& selectionName) { _selections.erase(selectionName); }
 
 public: // Setter
 
@@ -125,6 +121,5 @@ private:
     mv::Dataset<Points>             _currentData = {};
     mv::gui::StringAction           _currentDataGUID;      // internal for serialization
 
-    std::vector<uint32_t>           _selectionA = {};
-    std::vector<uint32_t>           _selectionB = {};
+    std::map<QString, std::vector<uint32_t>> _selections = {};
 };
@@ -112,6 +112,21 @@ void ButtonProgressBar::setProgressBarText(const QString& format)
         _progressBar->setFormat(format);
 }
 
+void ButtonProgressBar::setProgress(double fraction, const QString& text)
+{
+    if (_progressBar == nullptr)
+        return;
+
+    constexpr int progressRange = 1000;
+    if (_progressBar->maximum() != progressRange)
+        _progressBar->setRange(0, progressRange);
+
+    _button->hide();
+    _progressBar->setFormat(text);
+    _progressBar->setValue(static_cast<int>(fraction * progressRange));
+    _progressBar->show();
+}
+
 void ButtonProgressBar::showStatus(TableModel::Status status)
 {
 	switch(status)
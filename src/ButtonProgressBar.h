@@ -13,6 +13,9 @@ public:
 	void setButtonText(const QString&, QColor color = Qt::black);
 	void setProgressBarText(const QString&);
 
+	/** Show the progress bar at \p fraction (in [0, 1]) with \p text as format */
+	void setProgress(double fraction, const QString& text);
+
 	QProgressBar* getProgressBar()
 	{
 		return _progressBar;
@@ -1,20 +1,40 @@
 #include "DifferentialExpressionPlugin.h"
 
+#include <ClusterData/ClusterData.h>
 #include <DatasetsMimeData.h>
 
+#include <QBrush>
 #include <QDebug>
 #include <QFile>
 #include <QFileDialog>
+#include <QGridLayout>
+#include <QHash>
+#include <QMenu>
 #include <QMimeData>
 #include <QPushButton>
+#include <QRegularExpression>
+#include <QScopedValueRollback>
+#include <QTimer>
 
 #include "AdditionalSettings.h"
+#include "PointsMatrix.h"
 #include "WordWrapHeaderView.h"
 
+#include "engine/DifferentialExpression.h"
+#include "engine/DimensionRanges.h"
+#include "engine/GroupStatistics.h"
+#include "engine/ResultTable.h"
+#include "engine/ScanBatcher.h"
+#include "engine/StatisticsRegistry.h"
+#include "engine/StrategyPlanner.h"
+#include "engine/TaskPool.h"
+
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <limits>
+#include <type_traits>
 
 Q_PLUGIN_METADATA(IID "nl.BioVault.DifferentialExpressionPlugin")
 
@@ -62,42 +82,41 @@ namespace local
             return T();
         }
     }
-    template <typename FunctionObject>
-    void visitAllElements(Dataset<Points>& points, FunctionObject functionObject)
+
+    // A table cell with values for several roles, see TableModel::data
+    QVariant roleMap(std::initializer_list<std::pair<int, QVariant>> roles)
     {
-        const auto numDimensions = points->getNumDimensions();
-        const auto numRows = points->getNumPoints();
-        points->visitData([numRows, numDimensions, functionObject](auto data)
-            {
-                for (std::size_t r = 0; r < numRows; ++r)
-                {
-                    for (std::size_t column = 0; column < numDimensions; ++column)
-                    {
-                        const auto value = data[r][column];
-                        functionObject(r, column, value);
-                    }
-                }
-            });
+        QVariantMap map;
+        for (const auto& [role, value] : roles)
+            map[QString::number(role)] = value;
+        return map;
     }
-    template <typename RowRange, typename FunctionObject>
-    void visitElements(Dataset<Points>& points, const RowRange& rows, FunctionObject functionObject)
+
+    // options of _dimensionSubsetAction
+    enum DimensionSubset { AllDimensions, GeneList, IdFilter };
+
+    // How long a group comparison waits for requests of other views to share its scan, e.g. of views reacting to the same event
+    constexpr int scanBatchWindowMs = 20;
+
+    // Selection changes within this interval are compared once in live mode, with the latest selection
+    constexpr int liveUpdateIntervalMs = 30;
+
+    // A change of the settings is recomputed once no other change followed for this long
+    constexpr int recomputeDelayMs = 250;
+
+    // View of the dimension-major copy of matrix, empty if there is none or it was made of other data
+    template <typename Matrix>
+    Matrix transposedView(const Matrix& matrix, const de::MatrixData* transposed)
     {
-        const auto numDimensions = points->getNumDimensions();
-        points->visitData([&rows, numDimensions, functionObject](auto data)
-            {
-                const size_t numRows = rows.size();
-                for (std::size_t localRow = 0; localRow < numRows; ++localRow)
-                {
-                    const auto globalRow = rows[localRow];
-                    for (std::size_t column = 0; column < numDimensions; ++column)
-                    {
-                        const auto value = data[globalRow][column];
-                        functionObject(globalRow, localRow, column, value);
-                    }
-                }
-            });
-    }
+        using T = typename Matrix::value_type;
 
+        if (transposed == nullptr || transposed->elementType != de::elementTypeOf<T> || (transposed->storage == de::MatrixStorage::Sparse) != de::isSparseMatrix<Matrix>)
+            return {};
+        if (transposed->numRows != matrix.numColumns || transposed->numColumns != matrix.numRows)
+            return {};
+
+        return de::transposedView<Matrix>(*transposed);
+    }
 }
 
 DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory* factory) :
@@ -121,8 +140,28 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
     _additionalCalculationsAction(&getWidget(), "Additional calculations"),
     _thresholdExpressedAction(&getWidget(), "Threshold %expressed", 0.0f, 1.0f, 0.0f, 1),
     _normAction(&getWidget(), "Min-max normalization"),
+    _statisticalTestsAction(&getWidget(), "Statistical tests"),
+    _strategyAction(&getWidget(), "Strategy"),
+    _memoryBudgetAction(&getWidget(), "Memory budget (GB)", 0.1f, 1024.0f, 4.0f, 1),
+    _threadsAction(&getWidget(), "Threads", 1, static_cast<int>(de::TaskPool::shared().numThreads()), static_cast<int>(de::TaskPool::shared().concurrency())),
+    _planLabel(new QLabel()),
+    _dimensionSubsetAction(&getWidget(), "Dimensions"),
+    _loadGeneListAction(&getWidget(), "Load gene list..."),
+    _topKAction(&getWidget(), "Top K by |DE|", 0, 100000, 0),
+    _transposedCopyAction(&getWidget(), "Dimension-major copy"),
+    _transposedCacheLimitAction(&getWidget(), "Copy limit (GB)", 0.0f, 1024.0f, 8.0f, 1),
+    _progressiveAction(&getWidget(), "Progressive"),
+    _liveAction(&getWidget(), "Live"),
+    _groupingDatasetPickerAction(&getWidget(), "Clusters"),
+    _computeGroupMarkersAction(&getWidget(), "Compute markers (one vs. rest)"),
+    _groupResultAction(&getWidget(), "Result"),
+    _selectionLayout(nullptr),
+    _addSelectionAction(&getWidget(), "Add selection"),
+    _removeSelectionAction(&getWidget(), "Remove selection"),
+    _computeAllPairsAction(&getWidget(), "Compare all pairs"),
     _currentSelectedDimension(this, "Selected dimension"),
     _openAdditionalSettingsAction(&getWidget(), "Open additional settings"),
+    _savePerformanceTraceAction(&getWidget(), "Save performance trace..."),
     _additionalSettingsDialog()
 {
     // This line is mandatory if drag and drop behavior is required
@@ -135,6 +174,121 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
 
     _thresholdExpressedAction.setDefaultWidgetFlags(DecimalAction::SpinBox);
 
+    _statisticalTestsAction.setToolTip("Welch's t-test, Wilcoxon rank-sum test with AUROC and Benjamini-Hochberg adjusted p-values per dimension");
+
+    { // strategy planning
+
+        QStringList strategies;
+        for (const auto strategy : { de::DEStrategy::Automatic, de::DEStrategy::Exact, de::DEStrategy::Sparse, de::DEStrategy::Counts, de::DEStrategy::Transposed, de::DEStrategy::Histogram, de::DEStrategy::Chunked })
+            strategies << de::strategyName(strategy);
+
+        _strategyAction.setOptions(strategies);
+        _strategyAction.setCurrentIndex(static_cast<int>(de::DEStrategy::Automatic));
+        _strategyAction.setToolTip("Exact copies the selected values, Sparse only their non-zeros; Counts counts integer data (e.g. UMI counts) into one bin per value; Transposed reads the dimension-major copy of the data, once it is built; Histogram and Chunked aggregate the items and approximate medians, AUROC and rank-sum p-values. Automatic picks the fastest exact strategy within the memory budget, else the fastest approximate one.");
+        _memoryBudgetAction.setDefaultWidgetFlags(DecimalAction::SpinBox);
+        _memoryBudgetAction.setToolTip("Working memory of a run, on top of the loaded data");
+        _threadsAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
+        _threadsAction.setToolTip("Threads that compute the statistics. They are shared by all DE views, so runs of several views divide them instead of starting threads of their own.");
+
+        connect(&_strategyAction, &OptionAction::currentIndexChanged, this, &DifferentialExpressionPlugin::updatePlan);
+        connect(&_memoryBudgetAction, &DecimalAction::valueChanged, this, &DifferentialExpressionPlugin::updatePlan);
+        connect(&_threadsAction, &IntegralAction::valueChanged, this, [this](std::int32_t value)
+            {
+                de::TaskPool::shared().setConcurrency(value);
+                updatePlan();
+            });
+    }
+
+    { // dimension-major copy
+
+        _transposedCopyAction.setToolTip("Keep a copy of the data with the values of every dimension side by side, built in the background after loading. The Transposed strategy reads only the selected values of each dimension from it.");
+        _transposedCacheLimitAction.setDefaultWidgetFlags(DecimalAction::SpinBox);
+        _transposedCacheLimitAction.setToolTip("Memory of the dimension-major copies of all recently loaded datasets, shared by all DE views; the least recently used copy is dropped first");
+
+        connect(&_transposedCopyAction, &ToggleAction::toggled, this, [this](bool toggled)
+            {
+                if (toggled)
+                    startTranspose();
+                else
+                {
+                    stopTranspose();
+                    de::StatisticsRegistry::shared().eraseTransposed(_datasetKey);
+                    updatePlan();
+                }
+            });
+        connect(&_transposedCacheLimitAction, &DecimalAction::valueChanged, this, [this](float value)
+            {
+                de::StatisticsRegistry::shared().setTransposedCapacity(static_cast<std::uint64_t>(value * (1ull << 30)));
+                startTranspose();
+                updatePlan();
+            });
+    }
+
+    { // dimension subset and top K
+
+        _dimensionSubsetAction.setOptions({ "All dimensions", "Gene list", "Filter on Id" });
+        _dimensionSubsetAction.setCurrentIndex(local::AllDimensions);
+        _dimensionSubsetAction.setToolTip("Compute the statistics of all dimensions, of those in the loaded gene list or of those matching the ID filter only");
+        _loadGeneListAction.setIcon(mv::util::StyledIcon("file-import"));
+        _loadGeneListAction.setToolTip("Load a text file with one dimension name per line");
+        _topKAction.setDefaultWidgetFlags(IntegralAction::SpinBox);
+        _topKAction.setToolTip("Show only the K dimensions with the largest absolute DE, 0 shows all");
+
+        connect(&_loadGeneListAction, &TriggerAction::triggered, this, &DifferentialExpressionPlugin::loadGeneList);
+        connect(&_dimensionSubsetAction, &OptionAction::currentIndexChanged, this, &DifferentialExpressionPlugin::updatePlan);
+        connect(&_topKAction, &IntegralAction::valueChanged, this, &DifferentialExpressionPlugin::scheduleRecompute);
+    }
+
+    _progressiveAction.setToolTip("Show provisional statistics of growing stratified samples of both selections first, refined until they are exact. Rows whose ranking may still change are grayed out, the DE tooltip shows its 95% confidence interval.");
+
+    { // live mode
+
+        _liveAction.setToolTip("Compare the current selection to saved selection B while brushing. Only the items that entered or left the selection are read again. Medians, AUROC and rank-sum p-values come from histograms.");
+
+        _liveTimer.setSingleShot(true);
+        _liveTimer.setInterval(local::liveUpdateIntervalMs);
+        connect(&_liveTimer, &QTimer::timeout, this, &DifferentialExpressionPlugin::updateLiveComparison);
+
+        connect(&_liveAction, &ToggleAction::toggled, this, [this](bool toggled) {
+            _liveAggregates.reset();
+            if (toggled)
+                _liveTimer.start();
+            else
+                _liveTimer.stop();
+            });
+    }
+
+    { // grouped one-vs-rest mode
+
+        _groupingDatasetPickerAction.setToolTip("Clusters of the current dataset, every cluster is compared to all other clustered items");
+        _groupingDatasetPickerAction.setFilterFunction([this](mv::Dataset<mv::DatasetImpl> dataset) -> bool {
+            return dataset->getDataType() == ClusterType && _points.isValid() && dataset->getParent() == _points;
+            });
+
+        _computeGroupMarkersAction.setToolTip("Compute the statistics of every cluster against the rest in a single pass over the data");
+        _groupResultAction.setToolTip("Cluster whose one-vs-rest statistics or pair of selections whose statistics are shown");
+
+        connect(&_computeGroupMarkersAction, &TriggerAction::triggered, this, &DifferentialExpressionPlugin::computeGroupMarkers);
+
+        connect(&_groupResultAction, &OptionAction::currentIndexChanged, this, [this](int index) {
+            if (index >= 0 && static_cast<std::size_t>(index) < _groupResults.size())
+                showResult(_groupResults[index]);
+            });
+    }
+
+    { // saved selections
+
+        _addSelectionAction.setIcon(mv::util::StyledIcon("plus"));
+        _addSelectionAction.setToolTip("Add a slot to save another selection");
+        _removeSelectionAction.setIcon(mv::util::StyledIcon("minus"));
+        _removeSelectionAction.setToolTip("Remove the last saved selection");
+        _computeAllPairsAction.setToolTip("Compute the statistics of every pair of saved selections in a single pass over the data");
+
+        connect(&_addSelectionAction, &TriggerAction::triggered, this, &DifferentialExpressionPlugin::addSelectionSlot);
+        connect(&_removeSelectionAction, &TriggerAction::triggered, this, &DifferentialExpressionPlugin::removeSelectionSlot);
+        connect(&_computeAllPairsAction, &TriggerAction::triggered, this, &DifferentialExpressionPlugin::computeAllPairs);
+    }
+
     { // save to CSV
 
         //addTitleBarMenuAction(&_saveToCsvAction);
@@ -155,7 +309,14 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
         _copyToClipboardAction.setShortcutContext(Qt::WidgetWithChildrenShortcut);
 
         connect(&_copyToClipboardAction, &TriggerAction::triggered, this, [this]() -> void {
-            _tableItemModel->copyToClipboard();
+            // all columns are copied, also the hidden ones whose statistics were not computed yet
+            const QScopedValueRollback<int> computing(_computing, _computing + 1);
+            computeMissingStatistics(true);
+
+            _progressManager.start(_tableItemModel->rowCount(), "Copying");
+            _tableItemModel->copyToClipboard('\t', &_progressManager);
+            _progressManager.end();
+            _buttonProgressBar->showStatus(_tableItemModel->status());
             });
     }
 
@@ -170,20 +331,46 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
             });
     }
 
+    { // performance trace
+
+        _tableItemModel->setPerformanceTrace(&_performanceTrace);
+        _sortFilterProxyModel->setPerformanceTrace(&_performanceTrace);
+
+        _savePerformanceTraceAction.setIcon(mv::util::StyledIcon("stopwatch"));
+        _savePerformanceTraceAction.setToolTip("Save the timings of the last run as Chrome trace-event JSON (open with chrome://tracing or ui.perfetto.dev)");
+
+        connect(&_savePerformanceTraceAction, &TriggerAction::triggered, this, [this]() -> void {
+            writePerformanceTrace();
+            });
+
+        // sorting and filtering the table are recorded in the trace of the last run; its summary is refreshed after them
+        connect(_sortFilterProxyModel, &QSortFilterProxyModel::layoutChanged, this, [this]() -> void {
+            if (_buttonProgressBar && !_progressManager.active())
+                _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+            });
+    }
+
     _sortFilterProxyModel->setSourceModel(_tableItemModel.get());
     _filterOnIdAction.setSearchMode(true);
     _filterOnIdAction.setClearable(true);
     _filterOnIdAction.setPlaceHolderString("Filter by ID");
 
-    connect(&_updateStatisticsAction, &TriggerAction::triggered, [this](const bool& var)
-        {
-            _tableItemModel->invalidate();
-        });
-
     connect(&_filterOnIdAction, &mv::gui::StringAction::stringChanged, _sortFilterProxyModel, &TableSortFilterProxyModel::nameFilterChanged);
 
+    // computeDE invalidates the table itself
     connect(&_updateStatisticsAction, &mv::gui::TriggerAction::triggered, this, &DifferentialExpressionPlugin::computeDE);
 
+    // changes of the settings come in bursts, e.g. while a spin box is spun; they are coalesced into one run of the latest settings
+    _recomputeTimer.setSingleShot(true);
+    _recomputeTimer.setInterval(local::recomputeDelayMs);
+    connect(&_recomputeTimer, &QTimer::timeout, this, &DifferentialExpressionPlugin::recompute);
+
+    // ranges scanned during a computation are adopted after it, from the event loop
+    connect(&_progressManager, &ProgressManager::ended, this, [this]() {
+        if (_rangesPending)
+            runWhenIdle([this]() { rangeScanFinished(); });
+        }, Qt::QueuedConnection);
+
     connect(&_normAction, &mv::gui::ToggleAction::toggled, this, [this]()
         {
             if (_normAction.isChecked())
@@ -191,12 +378,15 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
             else
                 _norm = false;
 
-            _updateStatisticsAction.trigger();
+            scheduleRecompute();
         });
 
-    connect(&_thresholdExpressedAction, &DecimalAction::valueChanged, this, [this](float value)
+    connect(&_thresholdExpressedAction, &DecimalAction::valueChanged, this, &DifferentialExpressionPlugin::scheduleRecompute);
+
+    connect(&_statisticalTestsAction, &mv::gui::ToggleAction::toggled, this, [this](bool toggled)
         {
-            _updateStatisticsAction.trigger();
+            _useStatisticalTests = toggled;
+            scheduleRecompute();
         });
 
     _serializedActions.append(&_loadedDatasetsAction);
@@ -209,6 +399,7 @@ DifferentialExpressionPlugin::DifferentialExpressionPlugin(const PluginFactory*
     _serializedActions.append(&_highlightSelectionTriggerActions);
     _serializedActions.append(&_currentSelectedDimension);
     _serializedActions.append(&_openAdditionalSettingsAction);
+    _serializedActions.append(&_groupingDatasetPickerAction);
 }
 
 void DifferentialExpressionPlugin::init()
@@ -236,6 +427,19 @@ void DifferentialExpressionPlugin::init()
         toolBarLayout->addWidget(_additionalCalculationsAction.createWidget(&mainWidget), 2);
         toolBarLayout->addWidget(normWidget, 2);
         toolBarLayout->addWidget(thresholdWidget, 2);
+        toolBarLayout->addWidget(_statisticalTestsAction.createWidget(&mainWidget), 2);
+
+        toolBarLayout->addWidget(_strategyAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_memoryBudgetAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_threadsAction.createWidget(&mainWidget), 1);
+        toolBarLayout->addWidget(_transposedCopyAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_transposedCacheLimitAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_progressiveAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_liveAction.createWidget(&mainWidget), 1);
+
+        toolBarLayout->addWidget(_dimensionSubsetAction.createWidget(&mainWidget), 2);
+        toolBarLayout->addWidget(_loadGeneListAction.createWidget(&mainWidget), 1);
+        toolBarLayout->addWidget(_topKAction.createWidget(&mainWidget), 2);
 
         bool showExtra = _additionalCalculationsAction.isChecked();
         normWidget->setVisible(showExtra);
@@ -255,10 +459,19 @@ void DifferentialExpressionPlugin::init()
                 _thresholdExpressedAction.setValue(0.0f);
             }
 
-            _updateStatisticsAction.trigger();
+            scheduleRecompute();
             });
 
         layout->addLayout(toolBarLayout);
+
+        _planLabel->setWordWrap(true);
+        layout->addWidget(_planLabel);
+
+        QHBoxLayout* groupsLayout = new QHBoxLayout;
+        groupsLayout->addWidget(_groupingDatasetPickerAction.createWidget(&mainWidget), 4);
+        groupsLayout->addWidget(_computeGroupMarkersAction.createWidget(&mainWidget), 2);
+        groupsLayout->addWidget(_groupResultAction.createWidget(&mainWidget), 4);
+        layout->addLayout(groupsLayout);
     }
 
     { // table view
@@ -283,11 +496,16 @@ void DifferentialExpressionPlugin::init()
         horizontalHeader->setSortIndicator(1, Qt::AscendingOrder);
         horizontalHeader->setDefaultAlignment(Qt::AlignBottom | Qt::AlignLeft | Qt::Alignment(Qt::TextWordWrap));
         _tableView->setHorizontalHeader(horizontalHeader);
+
+        // the statistics of hidden columns are not computed, showing a column computes them
+        horizontalHeader->setContextMenuPolicy(Qt::CustomContextMenu);
+        connect(horizontalHeader, &QHeaderView::customContextMenuRequested, this, &DifferentialExpressionPlugin::showColumnMenu);
         layout->addWidget(_tableView);
 
         _tableView->addAction(&_saveToCsvAction);
         _tableView->addAction(&_copyToClipboardAction);
         _tableView->addAction(&_openAdditionalSettingsAction);
+        _tableView->addAction(&_savePerformanceTraceAction);
     }
 
     {// Progress bar and update button
@@ -299,26 +517,21 @@ void DifferentialExpressionPlugin::init()
 
         connect(_tableItemModel.get(), &TableModel::statusChanged, _buttonProgressBar, &ButtonProgressBar::showStatus);
 
+        _progressManager.setProgressBar(_buttonProgressBar);
+
         layout->addWidget(_buttonProgressBar);
     }
 
-    _totalTableColumns = _additionalCalculationsAction.isChecked() ? 10 : 6;
+    const auto columnNames = de::resultColumnNames(_additionalCalculationsAction.isChecked(), _statisticalTestsAction.isChecked());
+    _totalTableColumns = static_cast<int>(columnNames.size());
 
     _tableItemModel->startModelBuilding(_totalTableColumns, 0);
-    _tableItemModel->setHorizontalHeader(0, QString("ID"));
-    _tableItemModel->setHorizontalHeader(1, QString("DE"));
-    _tableItemModel->setHorizontalHeader(2, QString("Mean (Sel. 1)"));
-    _tableItemModel->setHorizontalHeader(3, QString("Mean (Sel. 2)"));
-    _tableItemModel->setHorizontalHeader(4, QString("Median (Sel. 1)"));
-    _tableItemModel->setHorizontalHeader(5, QString("Median (Sel. 2)"));
-
-    if (_totalTableColumns == 10) {
-        _tableItemModel->setHorizontalHeader(6, QString("SD (Sel. 1)"));
-        _tableItemModel->setHorizontalHeader(7, QString("SD (Sel. 2)"));
-        _tableItemModel->setHorizontalHeader(8, QString("% Expressed (Sel. 1)"));
-        _tableItemModel->setHorizontalHeader(9, QString("% Expressed (Sel. 2)"));
-    }
+
+    for (std::size_t column = 0; column < columnNames.size(); ++column)
+        _tableItemModel->setHorizontalHeader(column, QString::fromStdString(columnNames[column]));
+
     _tableItemModel->endModelBuilding();
+    applyColumnVisibility();
 
     // Apply the layout
     getWidget().setLayout(layout);
@@ -396,94 +609,268 @@ void DifferentialExpressionPlugin::init()
         _dropWidget->setShowDropIndicator(newDatasetName.isEmpty());
         });
 
-    for (std::size_t i = 0; i < _selectedCellsLabel.size(); ++i)
+    _selectionLayout = new QGridLayout();
+    for (std::size_t slot = 0; slot < _setSelectionTriggerActions.getNumTriggerActions(); ++slot)
+        addSelectionSlot();
+
+    layout->addLayout(_selectionLayout);
+
+    QHBoxLayout* savedSelectionsLayout = new QHBoxLayout;
+    savedSelectionsLayout->addWidget(_addSelectionAction.createWidget(&mainWidget), 1);
+    savedSelectionsLayout->addWidget(_removeSelectionAction.createWidget(&mainWidget), 1);
+    savedSelectionsLayout->addWidget(_computeAllPairsAction.createWidget(&mainWidget), 2);
+    layout->addLayout(savedSelectionsLayout);
+
+     // Load points when the pointer to the position dataset changes
+    connect(&_points, &Dataset<Points>::changed, this, &DifferentialExpressionPlugin::positionDatasetChanged);
+
+    // In live mode the changes of the selection within the interval of the timer are compared once, the timer is not restarted so brushing updates continuously
+    connect(&_points, &Dataset<Points>::dataSelectionChanged, this, [this]() {
+        if (_liveAction.isChecked() && !_liveTimer.isActive())
+            _liveTimer.start();
+        });
+
+    // The registered statistics are stale once the values change, and the dimension-major copy must not outlive the values it reads;
+    // the first view to hear of a change advances the generation, the others find it advanced
+    connect(&_points, &Dataset<Points>::dataChanged, this, [this]() {
+        stopSelectionAggregations();
+        stopTranspose();
+        _shownRun = ShownRun::None;
+        _datasetKey = de::StatisticsRegistry::shared().invalidate(_datasetKey);
+        startRangeScan();
+        startTranspose();
+        });
+    connect(&_points, &Dataset<Points>::dataAboutToBeRemoved, this, [this]() {
+        _rangeScan.reset();
+        stopSelectionAggregations();
+        stopTranspose();
+        de::StatisticsRegistry::shared().remove(_datasetKey.id);
+        });
+}
+
+DifferentialExpressionPlugin::~DifferentialExpressionPlugin()
+{
+    cancelGroupRequest();
+    _rangeScan.reset();
+    stopSelectionAggregations();
+    stopTranspose();
+}
+
+
+void DifferentialExpressionPlugin::addSelectionSlot()
+{
+    const std::size_t slot = _savedSelections.size();
+    if (slot >= maxSavedSelections)
+        return;
+
+    // the triggers of the first slots exist from the start
+    if (_setSelectionTriggerActions.getNumTriggerActions() <= slot)
     {
-        _selectedCellsLabel[i].setText(QString("(%1 items)").arg(0));
-        _selectedCellsLabel[i].setAlignment(Qt::AlignHCenter);
+        _setSelectionTriggerActions.addTriggerAction();
+        _highlightSelectionTriggerActions.addTriggerAction();
     }
 
-    auto updateSelectionIndices = [this](std::vector<uint32_t>& selection, const QString& selectionName, QLabel& label) {
-        if (!_points.isValid())
-            return;
+    TriggerAction* setTrigger       = _setSelectionTriggerActions.getTriggerAction(slot);
+    TriggerAction* highlightTrigger = _highlightSelectionTriggerActions.getTriggerAction(slot);
+
+    SavedSelection& selection = _savedSelections.emplace_back();
+    selection.name  = QString(QChar('A' + static_cast<int>(slot)));
+    selection.label = new QLabel(QString("(%1 items)").arg(0));
+    selection.label->setAlignment(Qt::AlignHCenter);
 
-        selection = _points->getSelectionIndices();
+    connect(setTrigger, &TriggerAction::triggered, this, [this, slot]() {
+        saveSelection(slot);
+        });
 
-        // ensure selection is unique and sorted
-        auto sortAndUnique = [](std::vector<uint32_t>& selection) -> void {
-            std::sort(selection.begin(), selection.end());
-            const auto last = std::unique(selection.begin(), selection.end());
-            selection.erase(last, selection.end());
-            };
+    connect(highlightTrigger, &TriggerAction::triggered, this, [this, slot]() {
+        highlightSelection(slot);
+        });
 
-        sortAndUnique(selection);
+    QWidget& mainWidget = getWidget();
+    _selectionLayout->addWidget(setTrigger->createWidget(&mainWidget), 0, slot);
+    _selectionLayout->addWidget(highlightTrigger->createWidget(&mainWidget), 1, slot);
+    _selectionLayout->addWidget(selection.label, 2, slot);
 
-        label.setText(QString("(%1 items)").arg(selection.size()));
+    _addSelectionAction.setEnabled(_savedSelections.size() < maxSavedSelections);
+    _removeSelectionAction.setEnabled(_savedSelections.size() > 2);
+}
 
-        const auto otherData     = _additionalSettingsDialog.getSelectionMappingSourcePicker().getCurrentDataset<Points>();
-        auto& otherDataSelection = _additionalSettingsDialog.getSelection(selectionName);
-        otherDataSelection       = otherData.isValid() ? otherData->getSelection<Points>()->indices : std::vector<uint32_t>{};
-        sortAndUnique(otherDataSelection);
+void DifferentialExpressionPlugin::removeSelectionSlot()
+{
+    if (_savedSelections.size() <= 2)
+        return;
 
-        qDebug() << "DifferentialExpressionPlugin: Saved selection " << selectionName << " with " << selection.size() << " items.";
+    const int slot = static_cast<int>(_savedSelections.size()) - 1;
 
-        if (_selectionA.size() != 0 && _selectionB.size() != 0)
-            _buttonProgressBar->showStatus(TableModel::Status::OutDated);
+    // the widgets refer to the triggers, delete them first
+    for (int row = 0; row < 3; ++row)
+        if (QLayoutItem* item = _selectionLayout->itemAtPosition(row, slot))
+            delete item->widget();
 
-        };
+    stopSelectionAggregation(slot);
 
-    auto highlightSelectionIndices = [this](const std::vector<uint32_t>& selection, const QString& selectionName) {
-        if (!_points.isValid())
-            return;
+    _additionalSettingsDialog.removeSelection(_savedSelections.back().name);
+    _savedSelections.pop_back();
 
-        auto otherData = _additionalSettingsDialog.getSelectionMappingSourcePicker().getCurrentDataset<Points>();
+    _setSelectionTriggerActions.removeLastTriggerAction();
+    _highlightSelectionTriggerActions.removeLastTriggerAction();
 
-        if (otherData.isValid()) {
+    _addSelectionAction.setEnabled(_savedSelections.size() < maxSavedSelections);
+    _removeSelectionAction.setEnabled(_savedSelections.size() > 2);
+}
 
-            // Check if the selection mapping makes sense
-            const auto [selectionMapping, numPointsTarget] = getSelectionMappingOtherToCurrent(otherData, _points);
-            const bool useOtherSelection = isMappingValid(selectionMapping, numPointsTarget, _points, _additionalSettingsDialog.checkMappingSurjective());
+void DifferentialExpressionPlugin::saveSelection(std::size_t slot)
+{
+    if (!_points.isValid() || slot >= _savedSelections.size())
+        return;
 
-            otherData->getSelection<Points>()->indices = useOtherSelection ? _additionalSettingsDialog.getSelection(selectionName) : std::vector<uint32_t>{};
-            
-            events().notifyDatasetDataSelectionChanged(otherData);
-        }
-        else {
-            _points->setSelectionIndices(selection);
-            events().notifyDatasetDataSelectionChanged(_points);
-        }
+    SavedSelection& selection = _savedSelections[slot];
+    selection.indices = _points->getSelectionIndices();
 
+    // ensure selection is unique and sorted
+    auto sortAndUnique = [](std::vector<uint32_t>& selection) -> void {
+        std::sort(selection.begin(), selection.end());
+        const auto last = std::unique(selection.begin(), selection.end());
+        selection.erase(last, selection.end());
         };
 
-    connect(_setSelectionTriggerActions.getTriggerAction(0), &TriggerAction::triggered, [this, updateSelectionIndices](){
-            updateSelectionIndices(_selectionA, "A", _selectedCellsLabel[0]);
-        });
+    sortAndUnique(selection.indices);
 
-    connect(_setSelectionTriggerActions.getTriggerAction(1), &TriggerAction::triggered, [this, updateSelectionIndices](){
-            updateSelectionIndices(_selectionB, "B", _selectedCellsLabel[1]);
-        });
+    if (slot < 2)
+        updateSelectionLabels();
+    else
+        selection.label->setText(QString("(%1 items)").arg(selection.indices.size()));
 
-    connect(_highlightSelectionTriggerActions.getTriggerAction(0), &TriggerAction::triggered, [this, highlightSelectionIndices](){
-        highlightSelectionIndices(_selectionA, "A");
-        });
+    const auto otherData     = _additionalSettingsDialog.getSelectionMappingSourcePicker().getCurrentDataset<Points>();
+    auto& otherDataSelection = _additionalSettingsDialog.getSelection(selection.name);
+    otherDataSelection       = otherData.isValid() ? otherData->getSelection<Points>()->indices : std::vector<uint32_t>{};
+    sortAndUnique(otherDataSelection);
+
+    qDebug() << "DifferentialExpressionPlugin: Saved selection " << selection.name << " with " << selection.indices.size() << " items.";
+
+    // the selection is compared once the next one is drawn, its aggregates are ready by then
+    startSelectionAggregation(slot);
+
+    // a new reference is compared to the current selection at once
+    if (slot == 1 && _liveAction.isChecked())
+        _liveTimer.start();
+
+    // the shown pair no longer compares the saved selections, the next run computes the columns shown meanwhile
+    if (slot < 2 && _shownRun != ShownRun::Groups)
+        _shownRun = ShownRun::None;
+
+    if (slot < 2 && _savedSelections[0].indices.size() != 0 && _savedSelections[1].indices.size() != 0)
+    {
+        _buttonProgressBar->showStatus(TableModel::Status::OutDated);
+        updatePlan();
+    }
+}
+
+void DifferentialExpressionPlugin::updateSelectionLabels()
+{
+    // items in both are compared as part of each, the DE scan reads them once
+    const std::size_t overlap = de::countOverlap(_savedSelections[0].indices, _savedSelections[1].indices);
+
+    for (std::size_t slot = 0; slot < 2; ++slot)
+    {
+        const SavedSelection& selection = _savedSelections[slot];
+        if (overlap == 0)
+            selection.label->setText(QString("(%1 items)").arg(selection.indices.size()));
+        else
+            selection.label->setText(QString("(%1 items, %2 also in %3)").arg(selection.indices.size()).arg(overlap).arg(_savedSelections[1 - slot].name));
+
+        selection.label->setToolTip(overlap == 0 ? QString() : QString("%1 items are in both selections A and B").arg(overlap));
+    }
+}
+
+void DifferentialExpressionPlugin::highlightSelection(std::size_t slot)
+{
+    if (!_points.isValid() || slot >= _savedSelections.size())
+        return;
+
+    const SavedSelection& selection = _savedSelections[slot];
+
+    auto otherData = _additionalSettingsDialog.getSelectionMappingSourcePicker().getCurrentDataset<Points>();
+
+    if (otherData.isValid()) {
+
+        // Check if the selection mapping makes sense
+        const auto [selectionMapping, numPointsTarget] = getSelectionMappingOtherToCurrent(otherData, _points);
+        const bool useOtherSelection = isMappingValid(selectionMapping, numPointsTarget, _points, _additionalSettingsDialog.checkMappingSurjective());
 
-    connect(_highlightSelectionTriggerActions.getTriggerAction(1), &TriggerAction::triggered, [this, highlightSelectionIndices](){
-            highlightSelectionIndices(_selectionB, "B");
+        otherData->getSelection<Points>()->indices = useOtherSelection ? _additionalSettingsDialog.getSelection(selection.name) : std::vector<uint32_t>{};
+
+        events().notifyDatasetDataSelectionChanged(otherData);
+    }
+    else {
+        _points->setSelectionIndices(selection.indices);
+        events().notifyDatasetDataSelectionChanged(_points);
+    }
+}
+
+void DifferentialExpressionPlugin::startSelectionAggregation(std::size_t slot)
+{
+    stopSelectionAggregation(slot);
+
+    // the bins span the ranges, rangeScanFinished starts the aggregation once the range scan has them
+    SavedSelection& selection = _savedSelections[slot];
+    if (!_points.isValid() || selection.indices.empty() || _rangeScan || _minValues.empty())
+        return;
+
+    std::vector<uint32_t> buffer;
+    const de::RowIndices storage = storageRows(_points, selection.indices, buffer);
+    std::vector<uint32_t> rows(storage.begin(), storage.end());
+
+    de::StatisticsRegistry& registry = de::StatisticsRegistry::shared();
+    const de::AggregationOptions options = aggregationOptions(deOptions());
+    if (registry.aggregates(_datasetKey, rows, options))
+        return;
+
+    if (!selection.aggregationCancel)
+        selection.aggregationCancel = std::make_unique<CancelFlag>();
+    selection.aggregationCancel->stop = false;
+
+    // the task reads the storage of the points and the ranges, setPositionDataset, a change of the data and the removal of the data cancel it;
+    // a canceled aggregation is not registered
+    visitPointsMatrix(_points, [&](const auto& matrix) {
+        selection.aggregation = std::async(std::launch::async, [&registry, matrix, rows = std::move(rows), options, key = _datasetKey, cancel = selection.aggregationCancel.get()]() {
+            const de::RowIndices selections[] = { rows };
+            de::aggregateSelections(matrix, std::span<const de::RowIndices>(selections), options, registry, key, cancel);
+            });
         });
+}
+
+void DifferentialExpressionPlugin::waitForSelectionAggregation(std::size_t slot)
+{
+    std::future<void>& aggregation = _savedSelections[slot].aggregation;
+    if (!aggregation.valid())
+        return;
 
-    QGridLayout* selectionLayout = new QGridLayout();
-    for (std::size_t i = 0; i < _selectedCellsLabel.size(); ++i)
+    if (aggregation.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
     {
-        selectionLayout->addWidget(_setSelectionTriggerActions.getTriggerAction(i)->createWidget(&mainWidget), 0, i);
-        selectionLayout->addWidget(_highlightSelectionTriggerActions.getTriggerAction(i)->createWidget(&mainWidget), 1, i);
-        selectionLayout->addWidget(&_selectedCellsLabel[i], 2, i);
+        de::PerformanceTrace::Scope scope(&_performanceTrace, "Wait for selection aggregation", "de");
+        aggregation.wait();
     }
 
-    layout->addLayout(selectionLayout);
+    aggregation = {};
+}
 
-     // Load points when the pointer to the position dataset changes
-    connect(&_points, &Dataset<Points>::changed, this, &DifferentialExpressionPlugin::positionDatasetChanged);
+void DifferentialExpressionPlugin::stopSelectionAggregation(std::size_t slot)
+{
+    SavedSelection& selection = _savedSelections[slot];
+    if (!selection.aggregation.valid())
+        return;
+
+    selection.aggregationCancel->stop = true;
+    selection.aggregation.wait();
+    selection.aggregation = {};
 }
 
+void DifferentialExpressionPlugin::stopSelectionAggregations()
+{
+    for (std::size_t slot = 0; slot < _savedSelections.size(); ++slot)
+        stopSelectionAggregation(slot);
+}
 
 void DifferentialExpressionPlugin::setPositionDataset(const mv::Dataset<Points>& newPoints)
 {
@@ -493,8 +880,18 @@ void DifferentialExpressionPlugin::setPositionDataset(const mv::Dataset<Points>&
         return;
     }
 
+    // the range scan, the aggregations and the copy being built read the values of the previous dataset
+    _rangeScan.reset();
+    stopSelectionAggregations();
+    stopTranspose();
+
     _points = newPoints;
 
+    // drop pending rounds of a progressive run and the pending group comparison on the previous dataset
+    ++_runGeneration;
+    cancelGroupRequest();
+    _shownRun = ShownRun::None;
+
     // Update the current dataset name label and dimension picker
     _currentDatasetNameLabel->setText(QString("Current points dataset: %1").arg(_points->getGuiName()));
     _currentSelectedDimension.setPointsDataset(_points);
@@ -508,89 +905,204 @@ void DifferentialExpressionPlugin::positionDatasetChanged()
     // Do not show the drop indicator if there is a valid point positions dataset
     _dropWidget->setShowDropIndicator(!_points.isValid());
 
+    // the buffers were sized for the previous dataset, the aggregations bin on its ranges
+    _scratchArena.release();
+    stopSelectionAggregations();
+
     // Compute normalization
     const auto numDimensions    = _points->getNumDimensions();
     const auto numPoints        = _points->getNumPoints();
 
-    // check if min and max need to be recomputed or are stored
-    // first check if there are dimension statistics stored in the properties and if they contain min and max values
-    QVariantMap dimensionStatisticsMap = _points->getProperty("Dimension Statistics").toMap();
-    bool recompute = dimensionStatisticsMap.empty();
-    recompute |= (dimensionStatisticsMap.constFind("min") == dimensionStatisticsMap.constEnd());
-    recompute |= (dimensionStatisticsMap.constFind("max") == dimensionStatisticsMap.constEnd());
+    _performanceTrace.reset(QString("Dataset load: %1 dimensions, %2 items").arg(numDimensions).arg(numPoints).toStdString());
 
-    if (recompute)
+    // another view on the dataset may have registered its ranges already, or they are stored with the dataset;
+    // otherwise they are scanned in the background and the first computation that needs them waits for the rest
+    de::StatisticsRegistry& registry = de::StatisticsRegistry::shared();
+    _datasetKey = registry.key(_points->getId().toStdString());
+
+    std::shared_ptr<const de::RangeStatistics> rangeStatistics = registry.ranges(_datasetKey);
+    if (!rangeStatistics)
     {
-        qDebug() << "DifferentialExpressionPlugin: Computing dimension ranges";
-        _minValues.resize(numDimensions, std::numeric_limits<float>::max());
-        _rescaleValues.resize(numDimensions, std::numeric_limits<float>::lowest());
+        de::DimensionRanges storedRanges = loadDimensionRanges();
+        if (storedRanges.minimum.size() == numDimensions)
+            rangeStatistics = registry.insertRanges(_datasetKey, std::move(storedRanges));
+    }
 
-        std::vector<std::size_t> count(numDimensions, 0);
+    if (rangeStatistics)
+        setDimensionRanges(*rangeStatistics);
+    else
+        startRangeScan();
 
-        local::visitAllElements(_points, [this, &count](auto row, auto column, auto value)->void
-            {
-                if (value > _rescaleValues[column])
-                    _rescaleValues[column] = value;
-                if (value < _minValues[column])
-                    _minValues[column] = value;
-                count[column]++;
+    _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+
+    startTranspose();
+
+    qDebug() << "DifferentialExpressionPlugin: Loaded " << numDimensions << " dimensions for " << numPoints << " points";
+}
+
+de::DimensionRanges DifferentialExpressionPlugin::loadDimensionRanges() const
+{
+    const auto numDimensions = _points->getNumDimensions();
+
+    // check if there are dimension statistics stored in the properties and if they contain min and max values
+    const QVariantMap dimensionStatisticsMap = _points->getProperty("Dimension Statistics").toMap();
+    const QVariantList minList = dimensionStatisticsMap.value("min").toList();
+    const QVariantList maxList = dimensionStatisticsMap.value("max").toList();
+    const QVariantList integralList = dimensionStatisticsMap.value("integral").toList();
+
+    de::DimensionRanges ranges;
+    if (minList.size() != numDimensions || maxList.size() != numDimensions || integralList.size() != numDimensions)
+        return ranges;
+
+    qDebug() << "DifferentialExpressionPlugin: Loading dimension ranges";
+
+    ranges.minimum.resize(numDimensions);
+    ranges.maximum.resize(numDimensions);
+    ranges.integral.resize(numDimensions);
+    de::TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t i) {
+        ranges.minimum[i]   = minList[i].toFloat();
+        ranges.maximum[i]   = maxList[i].toFloat();
+        ranges.integral[i]  = integralList[i].toBool();
+        });
+
+    return ranges;
+}
+
+void DifferentialExpressionPlugin::storeDimensionRanges(const de::DimensionRanges& ranges)
+{
+    QVariantMap dimensionStatisticsMap = _points->getProperty("Dimension Statistics").toMap();
+    dimensionStatisticsMap["min"] = QVariantList(ranges.minimum.cbegin(), ranges.minimum.cend());
+    dimensionStatisticsMap["max"] = QVariantList(ranges.maximum.cbegin(), ranges.maximum.cend());
+    dimensionStatisticsMap["integral"] = QVariantList(ranges.integral.cbegin(), ranges.integral.cend());
+    _points->setProperty("Dimension Statistics", dimensionStatisticsMap);
+}
+
+void DifferentialExpressionPlugin::setDimensionRanges(const de::RangeStatistics& rangeStatistics)
+{
+    // the live aggregates are binned on the previous ranges
+    _liveAggregates.reset();
+
+    _minValues          = rangeStatistics.ranges.minimum;
+    _maxValues          = rangeStatistics.ranges.maximum;
+    _integralDimensions = rangeStatistics.ranges.integral;
+    _rescaleValues      = rangeStatistics.rescaleValues;
+}
+
+void DifferentialExpressionPlugin::startRangeScan()
+{
+    _rangeScan.reset();
+    _rangesPending = false;
+
+    // until the scan is adopted nothing is normalized or binned
+    _liveAggregates.reset();
+    _minValues.clear();
+    _maxValues.clear();
+    _integralDimensions.clear();
+    _rescaleValues.clear();
+
+    qDebug() << "DifferentialExpressionPlugin: Scanning dimension ranges in the background";
+
+    // the scan reads the storage of the points, setPositionDataset and the removal of the data cancel it
+    visitPointsMatrix(_points, [this](const auto& matrix) {
+        const de::RowIndices rows = _points->isFull() ? de::RowIndices() : de::RowIndices(_points->indices);
+        _rangeScan = std::make_unique<de::BackgroundRangeScan>(matrix, rows, [this]() {
+            QMetaObject::invokeMethod(this, [this]() { runWhenIdle([this]() { rangeScanFinished(); }); }, Qt::QueuedConnection);
             });
+        });
+}
 
-        // check for potential 0 values and add them to the min and max range if needed
-#pragma omp parallel for schedule(dynamic,1)
-        for (std::ptrdiff_t d = 0; d < numDimensions; d++)
-        {
-            if (count[d] < numPoints)
-            {
-                if (_minValues[d] > 0)
-                    _minValues[d] = 0;
-                if (_rescaleValues[d] < 0)
-                    _minValues[d] = 0;
-            }
-        }
+void DifferentialExpressionPlugin::adoptRanges()
+{
+    if (!_rangeScan)
+        return;
 
-        // store min and max values in the properties
-        dimensionStatisticsMap["min"] = QVariantList(_minValues.cbegin(), _minValues.cend());
-        dimensionStatisticsMap["max"] = QVariantList(_rescaleValues.cbegin(), _rescaleValues.cend());
-        _points->setProperty("Dimension Statistics", dimensionStatisticsMap);
-    }
+    de::DimensionRanges ranges;
+    if (_rangeScan->ready())
+        ranges = _rangeScan->wait();
     else
     {
-        const QVariantList minList = dimensionStatisticsMap["min"].toList();
-        const QVariantList maxList = dimensionStatisticsMap["max"].toList();
-        recompute |= (minList.size() != numDimensions);
-        recompute |= (maxList.size() != numDimensions);
-        if (!recompute)
-        {
-            qDebug() << "DifferentialExpressionPlugin: Loading dimension ranges";
-            // load them from properties
-            _minValues.resize(numDimensions);
-            _rescaleValues.resize(numDimensions);
-#pragma  omp parallel for
-            for (std::ptrdiff_t i = 0; i < numDimensions; ++i)
-            {
-                _minValues[i]        = minList[i].toFloat();
-                _rescaleValues[i]    = maxList[i].toFloat();
-            }
+        const auto numDimensions = static_cast<std::uint64_t>(_points->getNumDimensions());
+        de::PerformanceTrace::Scope scope(&_performanceTrace, "Wait for dimension ranges", "de", _points->getNumPoints() * numDimensions * sizeof(float));
+        ranges = _rangeScan->wait();
+    }
+    _rangeScan.reset();
 
-        }
+    storeDimensionRanges(ranges);
+    setDimensionRanges(*de::StatisticsRegistry::shared().insertRanges(_datasetKey, std::move(ranges)));
+
+    updatePlan();
+}
+
+void DifferentialExpressionPlugin::rangeScanFinished()
+{
+    _rangesPending = false;
+
+    if (!_rangeScan)
+        return;
+
+    // the running computation, or the group comparison waiting for the scan batcher, holds spans of the current ranges
+    if (_progressManager.active())
+    {
+        _rangesPending = true;
+        return;
     }
 
-    // Compute rescale values
-#pragma omp parallel for schedule(dynamic,1)
-    for (std::ptrdiff_t d = 0; d < numDimensions; d++)
+    adoptRanges();
+
+    // selections saved during the scan could not be binned yet; a computation that needed the ranges earlier aggregates them itself
+    for (std::size_t slot = 0; slot < _savedSelections.size(); ++slot)
+        startSelectionAggregation(slot);
+}
+
+void DifferentialExpressionPlugin::startTranspose()
+{
+    if (!_transposedCopyAction.isChecked() || !_points.isValid())
+        return;
+
+    // one copy is built at a time
+    if (_transposeTask.valid())
     {
-        const float diff = (_rescaleValues[d] - _minValues[d]);
-        if (std::fabs(diff) > 1e-6f)
-            _rescaleValues[d] = 1.0f / diff;
-        else
-            _rescaleValues[d] = 1.0f;
+        if (_transposeTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        _transposeTask = {};
     }
 
-    qDebug() << "DifferentialExpressionPlugin: Loaded " << numDimensions << " dimensions for " << numPoints << " points";
+    de::StatisticsRegistry& registry = de::StatisticsRegistry::shared();
+    if (registry.containsTransposed(_datasetKey))
+        return;
+
+    _transposeCancel.stop = false;
+
+    // the task reads the storage of the points, setPositionDataset and the removal of the data wait for it
+    visitPointsMatrix(_points, [this, &registry](const auto& matrix) {
+        if (de::transposedBytes(matrix) > registry.transposedCapacity())
+        {
+            qDebug() << "DifferentialExpressionPlugin: The dimension-major copy exceeds its memory limit";
+            return;
+        }
+
+        // a copy of data that changed in the meantime is refused by the registry
+        _transposeTask = std::async(std::launch::async, [this, &registry, matrix, key = _datasetKey]() {
+            auto transposed = std::make_shared<const de::MatrixData>(de::transposeMatrix(matrix, &_transposeCancel));
+            if (_transposeCancel.canceled() || !registry.insertTransposed(key, std::move(transposed)))
+                return;
+
+            QMetaObject::invokeMethod(this, &DifferentialExpressionPlugin::updatePlan, Qt::QueuedConnection);
+            });
+        });
+}
+
+void DifferentialExpressionPlugin::stopTranspose()
+{
+    if (!_transposeTask.valid())
+        return;
+
+    _transposeCancel.stop = true;
+    _transposeTask.wait();
+    _transposeTask = {};
 }
 
-void DifferentialExpressionPlugin::writeToCSV() const
+void DifferentialExpressionPlugin::writeToCSV()
 {
     if (_tableItemModel.isNull())
         return;
@@ -615,7 +1127,15 @@ void DifferentialExpressionPlugin::writeToCSV() const
         settings.setValue(directoryPathKey, QFileInfo(fileName).absolutePath());
     }
 
-    QString csvString = _tableItemModel->createCSVString(',');
+    // all columns are exported, also the hidden ones whose statistics were not computed yet
+    const QScopedValueRollback<int> computing(_computing, _computing + 1);
+    computeMissingStatistics(true);
+
+    _progressManager.start(_tableItemModel->rowCount(), "Exporting");
+    QString csvString = _tableItemModel->createCSVString(',', &_progressManager);
+    _progressManager.end();
+    _buttonProgressBar->showStatus(_tableItemModel->status());
+
     if (csvString.isEmpty())
         return;
     QFile file(fileName);
@@ -626,169 +1146,922 @@ void DifferentialExpressionPlugin::writeToCSV() const
     file.close();
 }
 
-void DifferentialExpressionPlugin::computeDE()
+void DifferentialExpressionPlugin::writePerformanceTrace() const
 {
-    if (!_points.isValid())
-        return;
+    QSettings settings(QLatin1String{ "ManiVault" }, QLatin1String{ "Plugins/" } + getKind());
+    const QLatin1String directoryPathKey("directoryPath");
+    const auto directoryPath = settings.value(directoryPathKey).toString() + "/";
 
-    _tableItemModel->invalidate();
+    QString fileName = QFileDialog::getSaveFileName(
+        nullptr, tr("Save performance trace"), directoryPath + "DifferentialExpressionTrace.json", tr("Trace event JSON (*.json);;All Files (*)"));
 
-    const std::ptrdiff_t numDimensions = _points->getNumDimensions();
-    const size_t selectionSizeA = _selectionA.size();
-    const size_t selectionSizeB = _selectionB.size();
+    if (fileName.isEmpty())
+        return;
+
+    settings.setValue(directoryPathKey, QFileInfo(fileName).absolutePath());
+
+    if (!_performanceTrace.writeChromeTrace(fileName.toStdString()))
+        qDebug() << "DifferentialExpressionPlugin: Could not write performance trace to " << fileName;
+}
+
+void DifferentialExpressionPlugin::scheduleRecompute()
+{
+    // the table shows the previous settings until the run
+    _tableItemModel->invalidate();
+
+    // every change restarts the delay, a burst of changes is computed once
+    if (_liveAction.isChecked())
+        _liveTimer.start();
+    else
+        _recomputeTimer.start();
+}
+
+void DifferentialExpressionPlugin::recompute()
+{
+    // a run of older settings is still reporting progress, from whose event loop the timer fired; it is canceled and the latest settings run after it
+    if (_progressManager.active() || _computing > 0)
+    {
+        _progressManager.setCanceled(true);
+        _recomputeTimer.start();
+        return;
+    }
+
+    computeDE();
+}
+
+void DifferentialExpressionPlugin::computeDE()
+{
+    // a run of the current settings makes a scheduled one redundant
+    _recomputeTimer.stop();
+
+    if (!_points.isValid())
+        return;
+
+    const QScopedValueRollback<int> computing(_computing, _computing + 1);
+
+    ++_runGeneration;
+    cancelGroupRequest();
+
+    _tableItemModel->invalidate();
+
+    const std::ptrdiff_t numDimensions = _points->getNumDimensions();
+    const std::vector<uint32_t>& selectionA = _savedSelections[0].indices;
+    const std::vector<uint32_t>& selectionB = _savedSelections[1].indices;
+    const size_t selectionSizeA = selectionA.size();
+    const size_t selectionSizeB = selectionB.size();
 
     if (selectionSizeA == 0 || selectionSizeB == 0)
         return;
 
     qDebug() << "DifferentialExpressionPlugin: Computing differential expression.";
 
-    // Determine dynamic column counts based on the toggle
-    _totalTableColumns = _useAdditionalCalculations ? 10 : 6;
+    _performanceTrace.reset(QString("DE run: %1 dimensions, %2 vs. %3 items").arg(numDimensions).arg(selectionSizeA).arg(selectionSizeB).toStdString());
 
-    // for mean, sum all values and divide by size later
-    std::vector<float> meansA(numDimensions, 0);
-    std::vector<float> meansB(numDimensions, 0);
+    // a pairwise result replaces the one-vs-rest results
+    _groupResults.clear();
+    _groupResultAction.setOptions({});
+    _shownRun = ShownRun::None;
 
-    // for median, collect per dimension values and sprt later
-    // TODO: maybe look for median dynamically, instead of store the vectors
-    std::vector<std::vector<float>> valuesA(numDimensions, std::vector<float>(selectionSizeA, 0));
-    std::vector<std::vector<float>> valuesB(numDimensions, std::vector<float>(selectionSizeB, 0));
-    std::vector<float> mediansA(numDimensions, 0);
-    std::vector<float> mediansB(numDimensions, 0);
+    if (!updateDimensionSubset())
+    {
+        _planLabel->setText("No dimensions in the gene list or matching the ID filter");
+        return;
+    }
 
-    // Optional calculation vectors
-    // for SD
-    std::vector<float> SDA(numDimensions, 0);
-    std::vector<float> SDB(numDimensions, 0);
+    de::DEOptions options = deOptions();
 
-    // for percentage expressed
-    std::vector<std::size_t> countExpressedA(numDimensions, 0);
-    std::vector<std::size_t> countExpressedB(numDimensions, 0);
-    std::vector<float> pctExpressedA(numDimensions, 0);
-    std::vector<float> pctExpressedB(numDimensions, 0);
+    std::vector<uint32_t> storageRowsA, storageRowsB;
+    const de::RowIndices rowsA = storageRows(_points, selectionA, storageRowsA);
+    const de::RowIndices rowsB = storageRows(_points, selectionB, storageRowsB);
 
-    float thr = _thresholdExpressedAction.getValue();
+    // a run that does not fit the budget is refused before anything is allocated
+    de::DEProblem problem;
+    de::DEPlan plan = planDE(rowsA, rowsB, options, problem);
 
-    // only computes extra stats if _useAdditionalCalculations is true
-    auto computeAvgHelper = [this](const std::vector<uint32_t>& selectionIDs, const float thr, std::vector<float>& means, std::vector<std::vector<float>>& valCopies, std::vector<std::size_t>& countExpressed) -> void {
-        local::visitElements(_points, selectionIDs, [&means, &valCopies, &countExpressed, thr, this](auto globalRowID, auto localRowID, auto column, auto value)
-            {
-                means[column] += value;
-                valCopies[column][localRowID] = value;// for median and SD
-
-                // count %expressed based on loaded values
-                /*if (_useAdditionalCalculations && value > thr) {
-                    countExpressed[column]++;
-                }*/
-
-                // count %expressed based on norm or not
-                if (_useAdditionalCalculations) {
-                    const float thresholdValue = _norm ? (value - _minValues[column]) * _rescaleValues[column] : value;
-                    if (thresholdValue > thr) {
-                        countExpressed[column]++;
-                    }
-                }
+    // normalization and the binned strategies need the ranges, a run that does without starts before the range scan is done
+    if (_rangeScan && (options.normalize || !plan.feasible))
+    {
+        adoptRanges();
+        options = deOptions();
+        plan = planDE(rowsA, rowsB, options, problem);
+    }
+    _planLabel->setText(QString::fromStdString(plan.describe()));
+
+    if (!plan.feasible)
+    {
+        // the plan describes why the strategy does not apply
+        qDebug() << "DifferentialExpressionPlugin:" << (plan.chosen().applicable ? "No strategy fits the memory budget," : "The strategy does not apply,") << QString::fromStdString(plan.describe());
+        return;
+    }
+
+    if (_progressiveAction.isChecked())
+    {
+        _progressiveRun.rowsA.assign(rowsA.begin(), rowsA.end());
+        _progressiveRun.rowsB.assign(rowsB.begin(), rowsB.end());
+        _progressiveRun.dimensions = _dimensionSubset;
+        _progressiveRun.options = options;
+        _progressiveRun.options.dimensions = _progressiveRun.dimensions;
+        _progressiveRun.problem = problem;
+        _progressiveRun.plan = plan;
+        _progressiveRun.sampleSizes = de::progressiveSampleSizes(selectionSizeA, selectionSizeB, de::ProgressiveOptions());
+        _progressiveRun.round = 0;
+        _progressiveRun.transposed = problem.transposedCopy ? de::StatisticsRegistry::shared().transposed(_datasetKey) : nullptr;
+
+        refineDE(_runGeneration);
+        return;
+    }
+
+    de::DEResult result = computePair(rowsA, rowsB, options, plan, problem);
+
+    // a superseded run leaves the table to the run that superseded it
+    if (_progressManager.canceled())
+    {
+        _progressManager.end();
+        _buttonProgressBar->showStatus(_tableItemModel->status());
+        return;
+    }
+
+    showResult(result);
+
+    _pairResult = std::move(result);
+    _shownRun = ShownRun::Pair;
+
+    _progressManager.end();
+    _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+}
+
+de::DEResult DifferentialExpressionPlugin::computePair(de::RowIndices rowsA, de::RowIndices rowsB, const de::DEOptions& options, const de::DEPlan& plan, const de::DEProblem& problem)
+{
+    // a Histogram run takes the selections aggregated in the background from the registry and only scans the others
+    const bool registered = plan.strategy == de::DEStrategy::Histogram;
+    if (registered)
+    {
+        waitForSelectionAggregation(0);
+        waitForSelectionAggregation(1);
+    }
+
+    _progressManager.start(registered ? static_cast<std::size_t>(_points->getNumDimensions()) : de::progressSteps(plan, problem, options), plan.chosen().exact ? "Computing statistics" : "Aggregating selections");
+
+    const std::shared_ptr<const de::MatrixData> transposed = problem.transposedCopy ? de::StatisticsRegistry::shared().transposed(_datasetKey) : nullptr;
+
+    de::DEResult result;
+    visitPointsMatrix(_points, [this, &result, &options, &plan, &transposed, registered, rowsA, rowsB](const auto& matrix) {
+        using Matrix = std::decay_t<decltype(matrix)>;
+        if (registered)
+        {
+            result = de::computeDifferentialExpressionRegistered(matrix, rowsA, rowsB, options, plan.chunks.numBins, de::StatisticsRegistry::shared(), _datasetKey,
+                &_progressManager, &_performanceTrace);
+            return;
+        }
+
+        const Matrix transposedMatrix = local::transposedView(matrix, transposed.get());
+        result = de::computeDifferentialExpressionPlanned(matrix, rowsA, rowsB, options, plan, &_progressManager, &_performanceTrace,
+            transposedMatrix.numRows > 0 ? &transposedMatrix : nullptr);
+        });
+
+    return result;
+}
+
+void DifferentialExpressionPlugin::refineDE(std::uint64_t generation)
+{
+    if (generation != _runGeneration || !_points.isValid())
+        return;
+
+    ProgressiveRun& run = _progressiveRun;
+
+    // columns shown or hidden meanwhile are computed from this round on
+    const de::DEOptions current = deOptions();
+    run.options.medians = current.medians;
+    run.options.additionalStatistics = current.additionalStatistics;
+    run.options.statisticalTests = current.statisticalTests;
+
+    const std::size_t sampleSizeA = run.sampleSizes[run.round].first;
+    const std::size_t sampleSizeB = run.sampleSizes[run.round].second;
+
+    de::DEProblem roundProblem = run.problem;
+    roundProblem.sizeA = sampleSizeA;
+    roundProblem.sizeB = sampleSizeB;
+
+    _progressManager.start(de::progressSteps(run.plan, roundProblem, run.options), run.round == 0 ? "Computing statistics" : "Refining statistics");
+
+    de::ProgressiveResult round;
+    visitPointsMatrix(_points, [this, &run, &round, sampleSizeA, sampleSizeB](const auto& matrix) {
+        using Matrix = std::decay_t<decltype(matrix)>;
+        const Matrix transposedMatrix = local::transposedView(matrix, run.transposed.get());
+        round = de::computeProgressiveRound(matrix, run.rowsA, run.rowsB, sampleSizeA, sampleSizeB, run.options, run.plan, de::ProgressiveOptions(), &_progressManager, &_performanceTrace,
+            transposedMatrix.numRows > 0 ? &transposedMatrix : nullptr);
+        });
+
+    // the first round replaces the previous table, later rounds update its rows
+    showResult(round.result, &round, run.round > 0);
+
+    const bool canceled = _progressManager.canceled();
+    _progressManager.end();
+    _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+
+    if (round.exact || canceled)
+    {
+        if (round.exact && !canceled)
+        {
+            _pairResult = std::move(round.result);
+            _shownRun = ShownRun::Pair;
+        }
+
+        _planLabel->setText(QString::fromStdString(run.plan.describe()));
+        return;
+    }
+
+    _planLabel->setText(QString("Provisional, from %1 vs. %2 items: %3 of %4 dimensions ranked stably. Refining...")
+        .arg(round.sampleSizeA).arg(round.sampleSizeB).arg(round.numStable()).arg(round.result.numDimensions()));
+
+    // the next round runs from the event loop, after pending user input
+    ++run.round;
+    QTimer::singleShot(0, this, [this, generation]() { runWhenIdle([this, generation]() { refineDE(generation); }); });
+}
+
+void DifferentialExpressionPlugin::runWhenIdle(std::function<void()> work)
+{
+    if (_computing > 0)
+    {
+        QTimer::singleShot(ProgressManager::UPDATE_INTERVAL_MS, this, [this, work = std::move(work)]() mutable { runWhenIdle(std::move(work)); });
+        return;
+    }
+
+    const QScopedValueRollback<int> computing(_computing, _computing + 1);
+    work();
+}
+
+void DifferentialExpressionPlugin::updateLiveComparison()
+{
+    if (!_liveAction.isChecked() || !_points.isValid() || _savedSelections[1].indices.empty())
+        return;
+
+    // another computation reports progress, e.g. from the event loop run by the progress report; the latest selection is compared after it
+    if (_progressManager.active() || _computing > 0)
+    {
+        _liveTimer.start();
+        return;
+    }
+
+    const QScopedValueRollback<int> computing(_computing, _computing + 1);
+
+    std::vector<uint32_t> selection = _points->getSelectionIndices();
+    std::sort(selection.begin(), selection.end());
+    selection.erase(std::unique(selection.begin(), selection.end()), selection.end());
+
+    if (selection.empty() || !updateDimensionSubset())
+        return;
+
+    // the live comparison replaces pending rounds of a progressive run and a pending group comparison
+    ++_runGeneration;
+    cancelGroupRequest();
+
+    const SavedSelection& reference = _savedSelections[1];
+
+    _performanceTrace.reset(QString("Live DE run: %1 dimensions, %2 vs. %3 items").arg(_points->getNumDimensions()).arg(selection.size()).arg(reference.indices.size()).toStdString());
+
+    // the aggregates are binned on the ranges; the reference was aggregated in the background when it was saved
+    adoptRanges();
+    waitForSelectionAggregation(1);
+
+    const de::DEOptions options = deOptions();
+    const de::AggregationOptions aggregationOptions = this->aggregationOptions(options);
+
+    std::vector<uint32_t> storageRowsA, storageRowsB;
+    const de::RowIndices rowsA = storageRows(_points, selection, storageRowsA);
+    const de::RowIndices rowsB = storageRows(_points, reference.indices, storageRowsB);
+
+    std::size_t scannedRows = 0;
+    de::DEResult result;
+    visitPointsMatrix(_points, [&](const auto& matrix) {
+        scannedRows = _liveAggregates.update(matrix, rowsA, aggregationOptions, nullptr, &_performanceTrace);
+
+        const de::RowIndices referenceRows[] = { rowsB };
+        const auto referenceAggregates = de::aggregateSelections(matrix, std::span<const de::RowIndices>(referenceRows), aggregationOptions, de::StatisticsRegistry::shared(), _datasetKey,
+            nullptr, &_performanceTrace);
+
+        de::PerformanceTrace::Scope scope(&_performanceTrace, "Statistics from aggregates", "de");
+        result = de::compareGroups(_liveAggregates.aggregates(), 0, *referenceAggregates.front(), 0, options);
+        });
+
+    // the selections are aggregated for all dimensions
+    if (!options.dimensions.empty())
+        result = de::restrictToDimensions(result, options.dimensions);
+
+    // rows are updated in place, so the sorted table keeps its order and scroll position
+    _progressManager.start(result.numDimensions(), "Live update");
+    showResult(result, nullptr, true);
+    _progressManager.end();
+
+    _pairResult = std::move(result);
+    _shownRun = ShownRun::Live;
+
+    _planLabel->setText(QString("Live: %1 selected items vs. %2 items of %3, %4 items read").arg(selection.size()).arg(reference.indices.size()).arg(reference.name).arg(scannedRows));
+    _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+}
+
+void DifferentialExpressionPlugin::computeGroupMarkers()
+{
+    if (!_points.isValid())
+        return;
+
+    ++_runGeneration;
+    cancelGroupRequest();
+
+    const auto clusters = _groupingDatasetPickerAction.getCurrentDataset<Clusters>();
+    if (!clusters.isValid() || clusters->getClusters().isEmpty())
+        return;
+
+    _tableItemModel->invalidate();
+
+    if (!updateDimensionSubset())
+        return;
+
+    const std::size_t numDimensions = _points->getNumDimensions();
+    const auto& clusterList = clusters->getClusters();
+    const std::size_t numGroups = clusterList.size();
+
+    qDebug() << "DifferentialExpressionPlugin: Computing one-vs-rest statistics for" << numGroups << "clusters.";
+
+    _performanceTrace.reset(QString("Grouped DE run: %1 dimensions, %2 clusters").arg(numDimensions).arg(numGroups).toStdString());
+
+    std::vector<std::vector<uint32_t>> groups(numGroups);
+    QStringList groupNames;
+    for (std::size_t group = 0; group < numGroups; ++group)
+    {
+        groups[group] = clusterList[group].getIndices();
+        std::sort(groups[group].begin(), groups[group].end());
+        groupNames << clusterList[group].getName();
+    }
+
+    // the aggregates are binned on the ranges
+    adoptRanges();
+
+    _progressManager.start(2 * numDimensions + numGroups, "Aggregating clusters");
+
+    requestGroupComparison(groupNames, groups, deOptions(), false);
+}
+
+void DifferentialExpressionPlugin::computeAllPairs()
+{
+    if (!_points.isValid())
+        return;
+
+    ++_runGeneration;
+    cancelGroupRequest();
+
+    // empty slots are left out
+    std::vector<std::vector<uint32_t>> groups;
+    QStringList selectionNames;
+    for (const auto& selection : _savedSelections)
+    {
+        if (selection.indices.empty())
+            continue;
+
+        groups.push_back(selection.indices);
+        selectionNames << selection.name;
+    }
+
+    const std::size_t numGroups = groups.size();
+    if (numGroups < 2)
+        return;
+
+    if (!updateDimensionSubset())
+        return;
+
+    _tableItemModel->invalidate();
+
+    const std::size_t numDimensions = _points->getNumDimensions();
+    const std::size_t numPairs = numGroups * (numGroups - 1) / 2;
+
+    qDebug() << "DifferentialExpressionPlugin: Computing statistics of" << numPairs << "pairs of selections.";
+
+    _performanceTrace.reset(QString("All-pairs DE run: %1 dimensions, %2 selections").arg(numDimensions).arg(numGroups).toStdString());
+
+    // same order as the results of de::compareAllPairs
+    QStringList pairNames;
+    for (std::size_t groupA = 0; groupA < numGroups; ++groupA)
+        for (std::size_t groupB = groupA + 1; groupB < numGroups; ++groupB)
+            pairNames << QString("%1 vs. %2").arg(selectionNames[groupA], selectionNames[groupB]);
+
+    // the aggregates are binned on the ranges
+    adoptRanges();
+
+    // selections still aggregated in the background are taken from the registry once they are done
+    for (std::size_t slot = 0; slot < _savedSelections.size(); ++slot)
+        waitForSelectionAggregation(slot);
+
+    _progressManager.start(2 * numDimensions + numPairs, "Aggregating selections");
+
+    requestGroupComparison(pairNames, groups, deOptions(), true);
+}
+
+void DifferentialExpressionPlugin::requestGroupComparison(const QStringList& names, const std::vector<std::vector<uint32_t>>& groups, const de::DEOptions& options, bool allPairs, bool complete)
+{
+    const std::size_t numGroups = groups.size();
+
+    // kept to compute the statistics of the columns shown later
+    if (!complete)
+        _groupRun = { names, groups, allPairs };
+
+    const de::AggregationOptions aggregationOptions = this->aggregationOptions(options);
+
+    // group indices refer to the items of the points dataset, translate them to rows of the storage
+    de::ScanBatcher::Selections groupRows(numGroups);
+    for (std::size_t group = 0; group < numGroups; ++group)
+    {
+        std::vector<uint32_t> indices = groups[group];
+        indices.erase(std::remove_if(indices.begin(), indices.end(), [numPoints = _points->getNumPoints()](uint32_t index) { return index >= numPoints; }), indices.end());
+
+        if (_points->isFull())
+            groupRows[group] = std::move(indices);
+        else
+            storageRows(_points, indices, groupRows[group]);
+    }
+
+    // groups aggregated before, by this or another view, are taken from the registry; the others are aggregated in one scan
+    // together with the groups other views request within the batch window
+    auto scan = [this, aggregationOptions](std::span<const de::RowIndices> selections, de::ProgressSink* progress) {
+        de::ScanBatcher::Aggregates aggregates;
+        visitPointsMatrix(_points, [&](const auto& matrix) {
+            aggregates = de::aggregateSelections(matrix, selections, aggregationOptions, de::StatisticsRegistry::shared(), _datasetKey, progress, &_performanceTrace);
             });
+        return aggregates;
         };
 
-    auto computeMedian = [](std::vector<float>& vec) -> float {
-        std::nth_element(vec.begin(), vec.begin() + vec.size() / 2, vec.end());
-        return vec[vec.size() / 2];
-        };
+    // the dimensions of the toolbar may change before the request is served
+    auto compare = [this, generation = _runGeneration, names, options, dimensions = complete ? _groupResults.front().dimensions : _dimensionSubset, allPairs, complete](de::ScanBatcher::Aggregates selections, bool canceled) mutable {
+        // a run that started while the scan reported progress owns the progress bar
+        if (generation != _runGeneration)
+            return;
 
-    // sample standard deviation
-    auto computeSD = [](const std::vector<float>& vec, float mean) -> float {
-        if (vec.size() < 2) 
-            return 0.0f;
+        _groupRequest = 0;
 
-        float sum = 0.0f;
-        for (const float& val : vec) 
+        if (canceled)
         {
-            const float diff = val - mean;
-            sum += diff * diff;
+            _progressManager.end();
+            _buttonProgressBar->showStatus(_tableItemModel->status());
+            return;
+        }
+
+        options.dimensions = dimensions;
+        const de::GroupAggregates aggregates = de::joinAggregates(selections);
+
+        _progressManager.setLabelText(allPairs ? "Comparing selections" : "Comparing clusters");
+        std::vector<de::DEResult> results = allPairs ? de::compareAllPairs(aggregates, options, &_progressManager, &_performanceTrace) : de::compareOneVsRest(aggregates, options, &_progressManager, &_performanceTrace);
+
+        // the groups are aggregated for all dimensions
+        if (!options.dimensions.empty())
+        {
+            de::PerformanceTrace::Scope scope(&_performanceTrace, "Restrict to dimension subset", "de");
+            for (de::DEResult& result : results)
+                result = de::restrictToDimensions(result, options.dimensions);
+        }
+
+        if (complete)
+        {
+            // the results of the same groups, updated in place
+            bool merged = results.size() == _groupResults.size();
+            for (std::size_t group = 0; merged && group < results.size(); ++group)
+                merged = de::mergeStatistics(_groupResults[group], std::move(results[group]));
+
+            const int shown = _groupResultAction.getCurrentIndex();
+            if (merged && shown >= 0 && static_cast<std::size_t>(shown) < _groupResults.size())
+                showResult(_groupResults[shown], nullptr, true);
+        }
+        else
+        {
+            showGroupResults(names, std::move(results));
+            _shownRun = ShownRun::Groups;
         }
-        return std::sqrt(sum / (static_cast<float>(vec.size()) - 1.0f));
+
+        _progressManager.end();
+        _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
         };
 
-    auto normAvg = [&](const std::vector<float>& avgs, const std::ptrdiff_t dim) -> float {
-        return (avgs[dim] - _minValues[dim]) * _rescaleValues[dim];
+    // the batch may also be served from the timer of another view, while this view computes and processes events in its progress report
+    auto done = [this, compare = std::move(compare)](de::ScanBatcher::Aggregates selections, bool canceled) mutable {
+        if (_servingBatch)
+            compare(std::move(selections), canceled);
+        else
+            runWhenIdle([compare, selections = std::move(selections), canceled]() mutable { compare(std::move(selections), canceled); });
         };
 
-    // first compute the sum of values per dimension for _selectionA and _selectionB
-    // and copy the respective expresion values for median computation (requires sorting)
-    computeAvgHelper(_selectionA, thr, meansA, valuesA, countExpressedA);
-    computeAvgHelper(_selectionB, thr, meansB, valuesB, countExpressedB);
+    _groupRequest = de::ScanBatcher::shared().submit(_datasetKey, aggregationOptions, std::move(groupRows), std::move(scan), &_progressManager, std::move(done));
+
+    QTimer::singleShot(local::scanBatchWindowMs, this, [this]() {
+        runWhenIdle([this]() {
+            const QScopedValueRollback<bool> serving(_servingBatch, true);
+            de::ScanBatcher::shared().run();
+            });
+        });
+}
 
-#pragma omp parallel for schedule(dynamic,1)
-    for (std::ptrdiff_t d = 0; d < numDimensions; d++)
+void DifferentialExpressionPlugin::cancelGroupRequest()
+{
+    if (_groupRequest == 0)
+        return;
+
+    de::ScanBatcher::shared().cancel(_groupRequest);
+    _groupRequest = 0;
+
+    _progressManager.end();
+}
+
+void DifferentialExpressionPlugin::showGroupResults(const QStringList& names, std::vector<de::DEResult>&& results)
+{
+    // without results, the index changes below do not rebuild the table
+    _groupResults.clear();
+    _groupResultAction.setOptions(names);
+    _groupResultAction.setCurrentIndex(0);
+    _groupResults = std::move(results);
+
+    showResult(_groupResults.front());
+}
+
+de::DEPlan DifferentialExpressionPlugin::planDE(de::RowIndices rowsA, de::RowIndices rowsB, const de::DEOptions& options, de::DEProblem& problem) const
+{
+    visitPointsMatrix(_points, [&problem, rowsA, rowsB](const auto& matrix) {
+        problem = de::describeProblem(matrix, rowsA, rowsB);
+        });
+
+    problem.transposedCopy = _transposedCopyAction.isChecked() && de::StatisticsRegistry::shared().containsTransposed(_datasetKey);
+
+    const auto memoryBudget = static_cast<std::uint64_t>(_memoryBudgetAction.getValue() * (1ull << 30));
+    return de::planDifferentialExpression(problem, options, memoryBudget, static_cast<de::DEStrategy>(_strategyAction.getCurrentIndex()));
+}
+
+void DifferentialExpressionPlugin::updatePlan()
+{
+    if (!_points.isValid() || _savedSelections.size() < 2 || _savedSelections[0].indices.empty() || _savedSelections[1].indices.empty())
     {
-        meansA[d] /= selectionSizeA;
-        meansB[d] /= selectionSizeB;
-        mediansA[d] = computeMedian(valuesA[d]);
-        mediansB[d] = computeMedian(valuesB[d]);
+        _planLabel->clear();
+        return;
+    }
 
-        if (_useAdditionalCalculations) {
-            SDA[d] = computeSD(valuesA[d], meansA[d]);
-            SDB[d] = computeSD(valuesB[d], meansB[d]);
-            pctExpressedA[d] = 100.0f * countExpressedA[d] / static_cast<float>(selectionSizeA);
-            pctExpressedB[d] = 100.0f * countExpressedB[d] / static_cast<float>(selectionSizeB);
+    if (!updateDimensionSubset())
+    {
+        _planLabel->setText("No dimensions in the gene list or matching the ID filter");
+        return;
+    }
+
+    std::vector<uint32_t> storageRowsA, storageRowsB;
+    const de::RowIndices rowsA = storageRows(_points, _savedSelections[0].indices, storageRowsA);
+    const de::RowIndices rowsB = storageRows(_points, _savedSelections[1].indices, storageRowsB);
+
+    de::DEProblem problem;
+    const de::DEPlan plan = planDE(rowsA, rowsB, deOptions(), problem);
+    _planLabel->setText(QString::fromStdString(plan.describe()));
+}
+
+de::DEOptions DifferentialExpressionPlugin::deOptions(bool allColumns) const
+{
+    de::DEOptions options;
+    options.medians                 = false;
+    options.normalize               = _norm;
+    options.expressedThreshold      = _thresholdExpressedAction.getValue();
+    options.minValues               = _minValues;
+    options.rescaleValues           = _rescaleValues;
+    options.maxValues               = _maxValues;
+    options.integralDimensions      = _integralDimensions;
+    options.dimensions              = _dimensionSubset;
+    options.scratch                 = &_scratchArena;
+
+    for (const de::ResultColumn& column : tableColumns())
+        if (allColumns || !_hiddenColumns.contains(QString::fromStdString(column.name)))
+            de::requestStatistics(options, column.statistics);
+
+    return options;
+}
+
+std::vector<de::ResultColumn> DifferentialExpressionPlugin::tableColumns() const
+{
+    return de::resultColumns(_useAdditionalCalculations, _useStatisticalTests);
+}
+
+void DifferentialExpressionPlugin::showColumnMenu(const QPoint& position)
+{
+    QMenu menu;
+    for (const de::ResultColumn& column : tableColumns())
+    {
+        const QString name = QString::fromStdString(column.name);
+
+        QAction* action = menu.addAction(name);
+        action->setCheckable(true);
+        action->setChecked(!_hiddenColumns.contains(name));
+        connect(action, &QAction::toggled, this, [this, name](bool checked) { setColumnVisible(name, checked); });
+    }
+
+    menu.exec(_tableView->horizontalHeader()->mapToGlobal(position));
+}
+
+void DifferentialExpressionPlugin::setColumnVisible(const QString& name, bool visible)
+{
+    if (visible)
+        _hiddenColumns.removeAll(name);
+    else if (!_hiddenColumns.contains(name))
+        _hiddenColumns << name;
+
+    applyColumnVisibility();
+
+    // the estimate of the next run depends on the statistics it computes
+    updatePlan();
+
+    if (visible)
+        computeMissingStatistics(false);
+}
+
+void DifferentialExpressionPlugin::applyColumnVisibility()
+{
+    const std::vector<de::ResultColumn> columns = tableColumns();
+    if (_tableView == nullptr || _totalTableColumns != static_cast<int>(columns.size()) + 1)
+        return;
+
+    // the first column holds the IDs
+    for (std::size_t column = 0; column < columns.size(); ++column)
+        _tableView->horizontalHeader()->setSectionHidden(static_cast<int>(column) + 1, _hiddenColumns.contains(QString::fromStdString(columns[column].name)));
+}
+
+void DifferentialExpressionPlugin::computeMissingStatistics(bool allColumns)
+{
+    // an outdated table is replaced by the next run, which computes the statistics of the visible columns
+    if (!_points.isValid() || _progressManager.active() || _tableItemModel->status() != TableModel::Status::UpToDate)
+        return;
+
+    const QScopedValueRollback<int> computing(_computing, _computing + 1);
+
+    const de::DEResult* shown = nullptr;
+    if (_shownRun == ShownRun::Pair || _shownRun == ShownRun::Live)
+        shown = &_pairResult;
+    else if (_shownRun == ShownRun::Groups && !_groupResults.empty())
+        shown = &_groupResults.front();
+
+    if (shown == nullptr)
+        return;
+
+    // only the statistics the shown results lack
+    de::DEOptions options = deOptions(allColumns);
+    options.medians = options.medians && !shown->hasMedians();
+    options.additionalStatistics = options.additionalStatistics && !shown->hasAdditionalStatistics();
+    options.statisticalTests = options.statisticalTests && !shown->hasStatisticalTests();
+
+    if (!options.medians && !options.additionalStatistics && !options.statisticalTests)
+        return;
+
+    _performanceTrace.reset("Missing statistics");
+
+    if (_shownRun == ShownRun::Groups)
+    {
+        _progressManager.start(2 * _points->getNumDimensions() + _groupRun.groups.size(), "Computing statistics");
+        requestGroupComparison(_groupRun.names, _groupRun.groups, options, _groupRun.allPairs, true);
+
+        // an export writes the statistics right after, the aggregates are in the registry and the request is served at once
+        if (allColumns)
+            de::ScanBatcher::shared().run();
+
+        return;
+    }
+
+    const SavedSelection& reference = _savedSelections[1];
+    std::vector<uint32_t> storageRowsB;
+    const de::RowIndices rowsB = storageRows(_points, reference.indices, storageRowsB);
+
+    // the rows of the shown result, also if the subset of the toolbar changed since
+    options.dimensions = _pairResult.dimensions;
+
+    de::DEResult result;
+    if (_shownRun == ShownRun::Live)
+    {
+        // the reference was aggregated when it was saved, the current selection is in the live aggregates
+        const auto referenceAggregates = de::StatisticsRegistry::shared().aggregates(_datasetKey, rowsB, aggregationOptions(options));
+        if (!referenceAggregates || _liveAggregates.empty())
+            return;
+
+        _progressManager.start(_pairResult.numDimensions(), "Computing statistics");
+
+        {
+            de::PerformanceTrace::Scope scope(&_performanceTrace, "Statistics from aggregates", "de");
+            result = de::compareGroups(_liveAggregates.aggregates(), 0, *referenceAggregates, 0, options);
         }
 
-        // Optional normalization
-        if (_norm) {
-            meansA[d] = normAvg(meansA, d);
-            meansB[d] = normAvg(meansB, d);
-            mediansA[d] = normAvg(mediansA, d);
-            mediansB[d] = normAvg(mediansB, d);
+        if (!options.dimensions.empty())
+            result = de::restrictToDimensions(result, options.dimensions);
+    }
+    else
+    {
+        std::vector<uint32_t> storageRowsA;
+        const de::RowIndices rowsA = storageRows(_points, _savedSelections[0].indices, storageRowsA);
 
-            if (_useAdditionalCalculations) {
-                SDA[d] = SDA[d] * _rescaleValues[d];
-                SDB[d] = SDB[d] * _rescaleValues[d];
-            }
+        de::DEProblem problem;
+        const de::DEPlan plan = planDE(rowsA, rowsB, options, problem);
+        if (!plan.feasible)
+            return;
+
+        result = computePair(rowsA, rowsB, options, plan, problem);
+
+        if (_progressManager.canceled())
+        {
+            _progressManager.end();
+            _buttonProgressBar->showStatus(_tableItemModel->status());
+            return;
         }
     }
 
-    const auto& dimensionNames = _points->getDimensionNames();
-    _tableItemModel->startModelBuilding(_totalTableColumns, numDimensions);
+    // rows are updated in place, so the sorted table keeps its order and scroll position
+    if (de::mergeStatistics(_pairResult, std::move(result)))
+        showResult(_pairResult, nullptr, true);
+
+    _progressManager.end();
+    _buttonProgressBar->setToolTip(QString::fromStdString(_performanceTrace.summary()));
+}
+
+de::AggregationOptions DifferentialExpressionPlugin::aggregationOptions(const de::DEOptions& options) const
+{
+    de::AggregationOptions aggregationOptions;
+    aggregationOptions.minValues            = _minValues;
+    aggregationOptions.rescaleValues        = _rescaleValues;
+    aggregationOptions.expressedThreshold   = options.expressedThreshold;
+    aggregationOptions.normalizedThreshold  = options.normalize;
+    return aggregationOptions;
+}
+
+bool DifferentialExpressionPlugin::updateDimensionSubset()
+{
+    _dimensionSubset.clear();
+
+    switch (_dimensionSubsetAction.getCurrentIndex())
+    {
+    case local::GeneList:
+        _dimensionSubset = _geneList;
+        break;
 
-    _tableItemModel->setHorizontalHeader(0, QString("ID"));
-    _tableItemModel->setHorizontalHeader(1, QString("DE"));
-    _tableItemModel->setHorizontalHeader(2, QString("Mean (Sel. 1)"));
-    _tableItemModel->setHorizontalHeader(3, QString("Mean (Sel. 2)"));
-    _tableItemModel->setHorizontalHeader(4, QString("Median (Sel. 1)"));
-    _tableItemModel->setHorizontalHeader(5, QString("Median (Sel. 2)"));
+    case local::IdFilter:
+    {
+        // the same matching as the table filter
+        const QString filter = _filterOnIdAction.getString();
+        if (filter.isEmpty())
+            return true;
+
+        const QRegularExpression expression(filter, QRegularExpression::CaseInsensitiveOption);
+        const auto& dimensionNames = _points->getDimensionNames();
+        for (std::size_t dimension = 0; dimension < dimensionNames.size(); ++dimension)
+            if (dimensionNames[dimension].contains(expression))
+                _dimensionSubset.push_back(static_cast<uint32_t>(dimension));
+        break;
+    }
 
-    if (_useAdditionalCalculations) {
-        _tableItemModel->setHorizontalHeader(6, QString("SD (Sel. 1)"));
-        _tableItemModel->setHorizontalHeader(7, QString("SD (Sel. 2)"));
-        _tableItemModel->setHorizontalHeader(8, QString("% Expressed (Sel. 1)"));
-        _tableItemModel->setHorizontalHeader(9, QString("% Expressed (Sel. 2)"));
+    default:
+        return true;
     }
 
-#pragma omp parallel for schedule(dynamic,1)
-    for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+    return !_dimensionSubset.empty();
+}
+
+void DifferentialExpressionPlugin::loadGeneList()
+{
+    if (!_points.isValid())
+        return;
+
+    QSettings settings(QLatin1String{ "ManiVault" }, QLatin1String{ "Plugins/" } + getKind());
+    const QLatin1String directoryPathKey("directoryPath");
+    const auto directoryPath = settings.value(directoryPathKey).toString() + "/";
+
+    const QString fileName = QFileDialog::getOpenFileName(nullptr, tr("Load gene list"), directoryPath, tr("Text file (*.txt *.csv);;All Files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    settings.setValue(directoryPathKey, QFileInfo(fileName).absolutePath());
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return;
+
+    const auto& dimensionNames = _points->getDimensionNames();
+    QHash<QString, uint32_t> dimensions;
+    for (std::size_t dimension = 0; dimension < dimensionNames.size(); ++dimension)
+        dimensions.insert(dimensionNames[dimension], static_cast<uint32_t>(dimension));
+
+    _geneList.clear();
+    std::size_t numUnknown = 0;
+
+    QTextStream input(&file);
+    while (!input.atEnd())
     {
+        const QString name = input.readLine().trimmed();
+        if (name.isEmpty())
+            continue;
+
+        const auto found = dimensions.constFind(name);
+        if (found == dimensions.constEnd())
+            ++numUnknown;
+        else
+            _geneList.push_back(found.value());
+    }
+
+    std::sort(_geneList.begin(), _geneList.end());
+    _geneList.erase(std::unique(_geneList.begin(), _geneList.end()), _geneList.end());
+
+    qDebug() << "DifferentialExpressionPlugin: Loaded a gene list of" << _geneList.size() << "dimensions," << numUnknown << "names not found";
+
+    _loadGeneListAction.setToolTip(QString("%1 dimensions of %2 loaded, %3 names not found").arg(_geneList.size()).arg(QFileInfo(fileName).fileName()).arg(numUnknown));
+
+    if (_dimensionSubsetAction.getCurrentIndex() == local::GeneList)
+        updatePlan();
+    else
+        _dimensionSubsetAction.setCurrentIndex(local::GeneList);
+}
+
+void DifferentialExpressionPlugin::showResult(const de::DEResult& result, const de::ProgressiveResult* round, bool inPlace)
+{
+    // only the rows of the largest |DE| are added to the model, selected without sorting all of them
+    const std::size_t topK = static_cast<std::size_t>(_topKAction.getValue());
+    const std::vector<uint32_t> topRows = topK > 0 && topK < result.numDimensions() ? de::topRows(result, topK) : std::vector<uint32_t>{};
+
+    const std::ptrdiff_t numDimensions = topRows.empty() ? result.numDimensions() : topRows.size();
+
+    // the columns are those enabled in the toolbar, those of statistics the result lacks are hidden and left empty
+    const std::vector<de::ResultColumn> columns = tableColumns();
+    std::vector<std::uint8_t> held(columns.size());
+    for (std::size_t column = 0; column < columns.size(); ++column)
+        held[column] = de::hasStatistics(result, columns[column].statistics);
+
+    inPlace = inPlace && _tableItemModel->rowCount() == numDimensions && _totalTableColumns == static_cast<int>(columns.size()) + 1;
+    _totalTableColumns = static_cast<int>(columns.size()) + 1;
+
+    const auto& dimensionNames = _points->getDimensionNames();
+    const bool provisional = round && !round->exact;
+
+    _progressManager.setLabelText("Building table");
+
+    const auto tableBuildingStart = de::PerformanceTrace::Clock::now();
+
+    // the rows are built off the model, advance() processes events and the view reads the model meanwhile
+    std::vector<std::vector<QVariant>> rows(numDimensions);
+    de::TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t row) {
+        // row of the result shown in this row of the table
+        const std::size_t dimension = topRows.empty() ? row : topRows[row];
+        const QString& dimensionName = dimensionNames[result.dimension(dimension)];
+
         std::vector<QVariant> dataVector;
         dataVector.reserve(_totalTableColumns);
 
-        dataVector.push_back(dimensionNames[dimension]);
-        dataVector.push_back(local::fround(meansA[dimension] - meansB[dimension], 3));
-        dataVector.push_back(local::fround(meansA[dimension], 3));
-        dataVector.push_back(local::fround(meansB[dimension], 3));
-        dataVector.push_back(local::fround(mediansA[dimension], 3));
-        dataVector.push_back(local::fround(mediansB[dimension], 3));
-
-        if (_useAdditionalCalculations) {
-            dataVector.push_back(local::fround(SDA[dimension], 3));
-            dataVector.push_back(local::fround(SDB[dimension], 3));
-            dataVector.push_back(local::fround(pctExpressedA[dimension], 3));
-            dataVector.push_back(local::fround(pctExpressedB[dimension], 3));
+        if (provisional && !round->rankStable[dimension])
+            dataVector.push_back(local::roleMap({ { Qt::DisplayRole, dimensionName }, { Qt::ForegroundRole, QBrush(Qt::gray) }, { Qt::ToolTipRole, "Ranking not yet stable" } }));
+        else
+            dataVector.push_back(dimensionName);
+
+        for (std::size_t column = 0; column < columns.size(); ++column)
+        {
+            if (!held[column])
+            {
+                dataVector.emplace_back();
+                continue;
+            }
+
+            // p-values are not rounded, small ones would all become zero
+            const float value = columns[column].value(result, dimension);
+            const QVariant cell = columns[column].probability ? QVariant(value) : QVariant(local::fround(value, 3));
+
+            // the DE column
+            if (provisional && columns[column].values == nullptr)
+            {
+                const QString interval = QString("95% confidence interval: %1 to %2").arg(round->deLow[dimension], 0, 'f', 3).arg(round->deHigh[dimension], 0, 'f', 3);
+                dataVector.push_back(local::roleMap({ { Qt::DisplayRole, cell }, { Qt::ToolTipRole, interval } }));
+            }
+            else
+            {
+                dataVector.push_back(cell);
+            }
         }
 
         assert(dataVector.size() == _totalTableColumns);
-        _tableItemModel->setRow(dimension, dataVector, Qt::Unchecked, true);
+        rows[row] = std::move(dataVector);
+
+        _progressManager.advance();
+        });
+
+    _performanceTrace.record("Table rows (fround, QVariant)", "de", tableBuildingStart, de::PerformanceTrace::Clock::now(), numDimensions * _totalTableColumns * sizeof(QVariant));
+
+    // the model is written on the GUI thread without processing events in between
+    if (!inPlace)
+    {
+        _tableItemModel->startModelBuilding(_totalTableColumns, numDimensions);
+
+        _tableItemModel->setHorizontalHeader(0, "ID");
+        for (std::size_t column = 0; column < columns.size(); ++column)
+            _tableItemModel->setHorizontalHeader(column + 1, QString::fromStdString(columns[column].name));
+    }
+
+    for (std::ptrdiff_t row = 0; row < numDimensions; ++row)
+        _tableItemModel->setRow(row, rows[row], Qt::Unchecked, true);
+
+    if (inPlace)
+        _tableItemModel->endRowUpdates();
+    else
+    {
+        _tableItemModel->endModelBuilding();
+        applyColumnVisibility();
     }
-    _tableItemModel->endModelBuilding();
 }
 
 void DifferentialExpressionPlugin::tableView_clicked(const QModelIndex& index)
@@ -848,6 +2121,9 @@ void DifferentialExpressionPlugin::fromVariantMap(const QVariantMap& variantMap)
                 _headerState = state;
             }
         }
+
+        _hiddenColumns = propertiesMap.value("HiddenColumns").toStringList();
+        applyColumnVisibility();
     }
 
     setPositionDataset(_points);
@@ -870,6 +2146,7 @@ QVariantMap DifferentialExpressionPlugin::toVariantMap() const
 
     QByteArray headerState = _tableView->horizontalHeader()->saveState();
     propertiesMap["TableViewHeaderState"] = QString::fromUtf8(headerState.toBase64()); // encode the state with toBase64() and put it in a Utf8 QString since it will do that anyway. Best to be explicit in case it changes in the future
+    propertiesMap["HiddenColumns"] = _hiddenColumns;
     variantMap["#Properties"] = propertiesMap;
 
 
@@ -4,24 +4,44 @@
 #include <ViewPlugin.h>
 #include <PointData/DimensionPickerAction.h>
 #include <PointData/PointData.h>
+#include <actions/DatasetPickerAction.h>
+#include <actions/IntegralAction.h>
+#include <actions/OptionAction.h>
 #include <widgets/DropWidget.h>
 
 #include "AdditionalSettings.h"
 #include "ButtonProgressBar.h"
 #include "LoadedDatasetsAction.h"
 #include "MultiTriggerAction.h"
+#include "ProgressManager.h"
 #include "TableModel.h"
 #include "TableSortFilterProxyModel.h"
 #include "TableView.h"
 
-#include <array>
+#include "engine/DifferentialExpression.h"
+#include "engine/IncrementalAggregates.h"
+#include "engine/PerformanceTrace.h"
+#include "engine/ProgressiveStatistics.h"
+#include "engine/ResultTable.h"
+#include "engine/StatisticsRegistry.h"
+#include "engine/StrategyPlanner.h"
+#include "engine/TransposedMatrix.h"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <QTableWidget>
+#include <QTimer>
 
 using namespace mv::plugin;
 using namespace mv::gui;
 using namespace mv::util;
 
+class QGridLayout;
 class QLabel;
 
 class DifferentialExpressionPlugin : public ViewPlugin
@@ -36,8 +56,8 @@ public:
      */
     DifferentialExpressionPlugin(const PluginFactory* factory);
 
-    /** Destructor */
-    ~DifferentialExpressionPlugin() override = default;
+    /** Destructor, waits for a dimension-major copy that is still being built */
+    ~DifferentialExpressionPlugin() override;
     
     /** This function is called by the core after the view plugin has been created */
     void init() override;
@@ -66,15 +86,209 @@ public: // Serialization
  
 
 protected slots:
-    void writeToCSV() const;
+    void writeToCSV();
+    void writePerformanceTrace() const;
     void computeDE();
+
+    /** Recomputes the table with the latest settings once their changes stop for a moment, see recompute */
+    void scheduleRecompute();
+
+    /** Runs computeDE for a scheduled change, canceling a run of older settings that is still in progress */
+    void recompute();
+
+    /** One-vs-rest statistics of every cluster of the picked clusters dataset, aggregated in one scan */
+    void computeGroupMarkers();
+
+    /** Statistics of every pair of saved selections, aggregated in one scan */
+    void computeAllPairs();
     
     void tableView_clicked(const QModelIndex& index);
     void tableView_selectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
 
 
 protected:
-    using QLabelArray2 = std::array<QLabel, MultiTriggerAction::Size>;
+    /** Ranges of the points stored in the dataset properties, empty if none are stored */
+    de::DimensionRanges loadDimensionRanges() const;
+
+    /** Stores \p ranges in the dataset properties */
+    void storeDimensionRanges(const de::DimensionRanges& ranges);
+
+    /** Takes the ranges and normalization factors of the points from \p rangeStatistics */
+    void setDimensionRanges(const de::RangeStatistics& rangeStatistics);
+
+    /** Clears the ranges of the points and starts scanning them in the background */
+    void startRangeScan();
+
+    /** Waits for the range scan, if one runs, and registers, stores and takes its ranges */
+    void adoptRanges();
+
+    /*  Adopts the ranges of the range scan once it is done and aggregates the selections saved meanwhile
+        A running computation reads the ranges through its options, they are adopted once its progress ends.
+    */
+    void rangeScanFinished();
+
+    /*  Options of the next computation, as set in the toolbar; the dimensions are those of the last updateDimensionSubset
+        Only the statistics of the visible columns are computed, or those of all columns with \p allColumns, e.g. for an export.
+    */
+    de::DEOptions deOptions(bool allColumns = false) const;
+
+    /** The statistic columns of the table, as enabled in the toolbar, following the ID column */
+    std::vector<de::ResultColumn> tableColumns() const;
+
+    /** Lets the user show or hide the statistic columns from the context menu of the table header */
+    void showColumnMenu(const QPoint& position);
+
+    /** Shows or hides column \p name, computing its statistics if the shown results lack them */
+    void setColumnVisible(const QString& name, bool visible);
+
+    /** Hides the sections of the hidden columns, e.g. after the model was rebuilt */
+    void applyColumnVisibility();
+
+    /*  Computes the statistics of the visible columns, or of all columns with \p allColumns, that the shown results lack
+        Only those statistics are computed and added to the results: a pair by the strategy of the plan, from the aggregates
+        in the statistics registry with the Histogram strategy, groups and the live comparison from the aggregates in the
+        registry. Does nothing while another computation runs or if the table is outdated, the next run computes them.
+    */
+    void computeMissingStatistics(bool allColumns);
+
+    /** Binning of the aggregates of selections and clusters for \p options, as the group comparisons and the Histogram strategy take them from the registry */
+    de::AggregationOptions aggregationOptions(const de::DEOptions& options) const;
+
+    /** Aggregates the items of \p slot in the background into the statistics registry, replacing the aggregation of its previous items */
+    void startSelectionAggregation(std::size_t slot);
+
+    /** Waits for the background aggregation of \p slot, e.g. before a computation that takes it from the registry */
+    void waitForSelectionAggregation(std::size_t slot);
+
+    /** Cancels the background aggregation of \p slot and waits for it */
+    void stopSelectionAggregation(std::size_t slot);
+
+    /** Cancels the background aggregations of all slots, e.g. before the points change */
+    void stopSelectionAggregations();
+
+    /** Restricts the next computation to the dimensions of the gene list or the ID filter, false if a subset is requested but empty */
+    bool updateDimensionSubset();
+
+    /** Asks for a text file with one dimension name per line and restricts the computations to those dimensions */
+    void loadGeneList();
+
+    /** Plans the comparison of the rows \p rowsA and \p rowsB of the points storage, within the memory budget */
+    de::DEPlan planDE(de::RowIndices rowsA, de::RowIndices rowsB, const de::DEOptions& options, de::DEProblem& problem) const;
+
+    /** Shows the plan of comparing the first two saved selections, before it is run */
+    void updatePlan();
+
+    /** Builds the dimension-major copy of the points storage in the background, unless it is registered or does not fit the cap */
+    void startTranspose();
+
+    /** Cancels the copy being built and waits for it */
+    void stopTranspose();
+
+    /*  Computes the statistics of \p options of the storage rows \p rowsA and \p rowsB as planned, which the caller shows
+        Starts the progress report, the caller ends it.
+    */
+    de::DEResult computePair(de::RowIndices rowsA, de::RowIndices rowsB, const de::DEOptions& options, const de::DEPlan& plan, const de::DEProblem& problem);
+
+    /** Runs the next round of the progressive run started by computeDE, unless another run started since */
+    void refineDE(std::uint64_t generation);
+
+    /*  Runs \p work, deferred from the event loop, as a computation of the GUI thread
+        The progress reports of a computation process events, from which timers and queued calls fire; their work is
+        retried after the running computations returned instead of interleaving with them.
+    */
+    void runWhenIdle(std::function<void()> work);
+
+    /** Compares the current selection of the points to saved selection B, scanning only the items that changed since the last update */
+    void updateLiveComparison();
+
+    /*  Fill the table with \p result, advancing the progress per row
+        Rows of a provisional \p round show the confidence interval of the DE and are grayed out while
+        their ranking is not stable. With \p inPlace the rows are updated without resetting the model.
+        With a top K only the K rows of the largest |DE| are added.
+    */
+    void showResult(const de::DEResult& result, const de::ProgressiveResult* round = nullptr, bool inPlace = false);
+
+    /*  Queues the aggregation of the items of every group in the scan batcher shared by all DE views, then compares them
+        one-vs-rest or pairwise and shows the results under \p names. Groups requested by other views within a short window
+        are aggregated in the same scan. Progress must be started by the caller, it ends when the results are shown.
+        With \p complete the statistics of \p options are added to the shown results of the same groups instead.
+    */
+    void requestGroupComparison(const QStringList& names, const std::vector<std::vector<uint32_t>>& groups, const de::DEOptions& options, bool allPairs, bool complete = false);
+
+    /** Drops the group comparison that was requested but not served yet, and ends its progress */
+    void cancelGroupRequest();
+
+    /** Makes \p results selectable under \p names and shows the first one */
+    void showGroupResults(const QStringList& names, std::vector<de::DEResult>&& results);
+
+protected: // Saved selections
+
+    /** Appends a selection slot with its set and highlight triggers */
+    void addSelectionSlot();
+
+    /** Removes the last selection slot, the first two are always kept */
+    void removeSelectionSlot();
+
+    /** Save the current selection of the points (and the mapping source) in \p slot */
+    void saveSelection(std::size_t slot);
+
+    /** Select the items saved in \p slot */
+    void highlightSelection(std::size_t slot);
+
+    /** Shows the number of items of the first two slots, and how many of them are in both */
+    void updateSelectionLabels();
+
+protected:
+    /** Stops a background transpose or aggregation when the dataset changes or the plugin is destroyed */
+    struct CancelFlag : de::ProgressSink
+    {
+        void advance(std::uint64_t) override {}
+        bool canceled() const override { return stop; }
+
+        std::atomic<bool> stop = false;
+    };
+
+    /** A selection of items, saved under a name to compare it to the other saved selections */
+    struct SavedSelection
+    {
+        QString                         name;               // "A", "B", ...
+        std::vector<uint32_t>           indices;            // sorted and unique
+        QLabel*                         label = nullptr;    // number of saved items
+        std::future<void>               aggregation;        // aggregates the items into the statistics registry while the next selection is drawn
+        std::unique_ptr<CancelFlag>     aggregationCancel;
+    };
+
+    static constexpr std::size_t maxSavedSelections = 26;
+
+    /** The computation whose results the table shows, which computes the statistics of the columns shown later */
+    enum class ShownRun
+    {
+        None,       // none, or provisional rounds of a progressive run
+        Pair,       // _pairResult of the first two saved selections
+        Groups,     // _groupResults of _groupRun
+        Live        // _pairResult of the current selection and saved selection B
+    };
+
+    /** The groups of the shown group comparison */
+    struct GroupRun
+    {
+        QStringList                         names;
+        std::vector<std::vector<uint32_t>>  groups;     // items per group
+        bool                                allPairs = false;
+    };
+
+    /** A progressive comparison of the first two saved selections, refined one round at a time from the event loop */
+    struct ProgressiveRun
+    {
+        std::vector<uint32_t>                               rowsA, rowsB;   // storage rows
+        std::vector<uint32_t>                               dimensions;     // options.dimensions, kept while the subset of the toolbar changes
+        de::DEOptions                                       options;
+        de::DEProblem                                       problem;
+        de::DEPlan                                          plan;
+        std::vector<std::pair<std::size_t, std::size_t>>    sampleSizes;    // per round
+        std::size_t                                         round = 0;      // next round
+        std::shared_ptr<const de::MatrixData>               transposed;     // dimension-major copy the run started with, if any
+    };
 
     DropWidget*                             _dropWidget;                /** Widget for drag and drop behavior */
     mv::Dataset<Points>                     _points;                    /** Points smart pointer */
@@ -89,15 +303,18 @@ protected:
     TriggerAction                           _copyToClipboardAction;
     TriggerAction                           _saveToCsvAction;
     TriggerAction                           _openAdditionalSettingsAction;
+    TriggerAction                           _savePerformanceTraceAction;
     DimensionPickerAction                   _currentSelectedDimension;
     AdditionalSettingsDialog                _additionalSettingsDialog;
 
-    QLabelArray2                            _selectedCellsLabel;
     int                                     _totalTableColumns;
     QSharedPointer<TableModel>              _tableItemModel;
     QPointer<TableSortFilterProxyModel>     _sortFilterProxyModel;
     TableView*                              _tableView;
     QPointer<ButtonProgressBar>             _buttonProgressBar;
+    ProgressManager                         _progressManager;           /** Reports progress of range scans, DE runs and exports */
+    de::PerformanceTrace                    _performanceTrace;          /** Per-phase timings of the last dataset load or DE run */
+    mutable de::ScratchArena                _scratchArena;              /** Working buffers of the DE runs, kept until the dataset changes */
 
     QVector<WidgetAction*>                  _serializedActions;
     QByteArray                              _headerState;
@@ -105,11 +322,19 @@ protected:
     std::vector<QTableWidgetItem*>          _geneTableItems;
     std::vector<QTableWidgetItem*>          _diffTableItems;
 
+    de::DatasetKey                          _datasetKey;                /** The points in the statistics registry shared by all DE views */
     std::vector<float>                      _minValues;
+    std::vector<float>                      _maxValues;
     std::vector<float>                      _rescaleValues;
+    std::vector<std::uint8_t>               _integralDimensions;        /** 1 for dimensions of whole numbers, which the Counts strategy can count */
+    std::unique_ptr<de::BackgroundRangeScan> _rangeScan;                /** Scans the ranges after loading, until adoptRanges takes them */
+    bool                                    _rangesPending = false;     /** The range scan finished during a computation, its ranges are adopted after it */
 
-    std::vector<uint32_t>                   _selectionA;
-    std::vector<uint32_t>                   _selectionB;
+    std::vector<SavedSelection>             _savedSelections;           /** The first two are compared by computeDE */
+    QGridLayout*                            _selectionLayout;           /** One column of triggers per saved selection */
+    TriggerAction                           _addSelectionAction;
+    TriggerAction                           _removeSelectionAction;
+    TriggerAction                           _computeAllPairsAction;
 
     // additional calculations
     ToggleAction                            _additionalCalculationsAction; // able or disable additional calculations (SD, %expressed)
@@ -117,6 +342,55 @@ protected:
     ToggleAction                            _normAction; // min max normalization
     bool                                    _norm = false;
     DecimalAction                           _thresholdExpressedAction; // threshold for % expressed
+
+    // statistical tests
+    ToggleAction                            _statisticalTestsAction; // Welch's t-test, Wilcoxon rank-sum test with AUROC, BH adjusted p-values
+    bool                                    _useStatisticalTests = false;
+
+    // strategy planning
+    OptionAction                            _strategyAction;        // de::DEStrategy, Automatic picks the fastest within the memory budget
+    DecimalAction                           _memoryBudgetAction;    // in GB, working memory of a run on top of the data
+    IntegralAction                          _threadsAction;         // concurrency of the task pool shared by all DE views
+    QLabel*                                 _planLabel;             // strategy and estimate of the next run, or the state of a progressive run
+
+    // dimension subset and top K
+    OptionAction                            _dimensionSubsetAction; // all dimensions, those of the gene list or those matching the ID filter
+    TriggerAction                           _loadGeneListAction;
+    std::vector<uint32_t>                   _geneList;              // sorted dimension indices of the loaded gene list
+    std::vector<uint32_t>                   _dimensionSubset;       // sorted dimension indices of the next computation, empty for all
+    IntegralAction                          _topKAction;            // rows of the largest |DE| shown, 0 for all
+
+    // dimension-major copy
+    ToggleAction                            _transposedCopyAction;          // keep a transposed copy of the points for the Transposed strategy
+    DecimalAction                           _transposedCacheLimitAction;    // in GB, memory of the copies in the statistics registry, least recently used evicted first
+    std::future<void>                       _transposeTask;                 // builds the copy of the current dataset
+    CancelFlag                              _transposeCancel;
+
+    // progressive mode
+    ToggleAction                            _progressiveAction;     // provisional results from growing samples first
+    ProgressiveRun                          _progressiveRun;
+    std::uint64_t                           _runGeneration = 0;     // incremented by every run, pending rounds of older runs are dropped
+    int                                     _computing = 0;         // computations running on the GUI thread, nested in the events their progress reports process
+    QTimer                                  _recomputeTimer;        // restarted by every change of the settings, runs the latest ones once it expires
+
+    // live mode
+    ToggleAction                            _liveAction;            // compare the current selection of the points to saved selection B while brushing
+    QTimer                                  _liveTimer;             // coalesces the selection changes within its interval, the latest selection is compared
+    de::IncrementalAggregates               _liveAggregates;        // of the current selection, updated by the items that entered or left it
+
+    // grouped one-vs-rest mode
+    DatasetPickerAction                     _groupingDatasetPickerAction;   /** Clusters of the points dataset to find markers for */
+    TriggerAction                           _computeGroupMarkersAction;
+    OptionAction                            _groupResultAction;             /** Cluster or pair of selections whose result is shown */
+    std::vector<de::DEResult>               _groupResults;
+    std::uint64_t                           _groupRequest = 0;              /** Id of the comparison queued in the scan batcher, 0 if none */
+    bool                                    _servingBatch = false;          /** The scan batcher serves a batch from the timer of this view, whose comparisons run directly */
+    GroupRun                                _groupRun;
+
+    // lazily computed columns
+    QStringList                             _hiddenColumns;                 // titles of the statistic columns the user hid, whose statistics are not computed
+    ShownRun                                _shownRun = ShownRun::None;
+    de::DEResult                            _pairResult;                    // shown result of a pair or the live comparison, before the top K
 };
 
 
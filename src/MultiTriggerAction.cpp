@@ -2,17 +2,13 @@
 
 #include <QMenu>
 
-MultiTriggerAction::MultiTriggerAction(QObject* object, const QString& title, const QString& trigger_title):
+MultiTriggerAction::MultiTriggerAction(QObject* object, const QString& title, const QString& trigger_title, std::size_t size):
     GroupAction(object,title,true),
+    _triggerTitle(trigger_title),
     _triggerAction()
 {
-    int id = 1;
-    for (auto &action : _triggerAction)
-    {
-        action.reset(new TriggerAction(this, trigger_title.arg(id++)));
-        action->setCheckable(false);
-        action->setChecked(false);
-    }
+    for (std::size_t id = 0; id < size; ++id)
+        addTriggerAction();
 }
 
 MultiTriggerAction::~MultiTriggerAction()
@@ -30,13 +26,27 @@ QMenu* MultiTriggerAction::getContextMenu(QWidget* parent)
     return menu;
 }
 
-TriggerAction* MultiTriggerAction::getTriggerAction(uint8_t id)
+TriggerAction* MultiTriggerAction::getTriggerAction(std::size_t id)
 {
     if (id < _triggerAction.size())
         return _triggerAction[id].get();
     return nullptr;
 }
 
+TriggerAction* MultiTriggerAction::addTriggerAction()
+{
+    auto& action = _triggerAction.emplace_back(new TriggerAction(this, _triggerTitle.arg(_triggerAction.size() + 1)));
+    action->setCheckable(false);
+    action->setChecked(false);
+    return action.get();
+}
+
+void MultiTriggerAction::removeLastTriggerAction()
+{
+    if (!_triggerAction.empty())
+        _triggerAction.pop_back();
+}
+
 
 void MultiTriggerAction::fromVariantMap(const QVariantMap& variantMap) 
 {
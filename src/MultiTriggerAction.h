@@ -1,7 +1,7 @@
 #pragma once
 #include "actions/GroupAction.h"
 #include "actions/TriggerAction.h"
-#include <array>
+#include <vector>
 
 using namespace mv;
 using namespace mv::gui;
@@ -18,13 +18,15 @@ class MultiTriggerAction: public GroupAction
 
     
 public:
-    enum { Size = 2 };
+    enum { DefaultSize = 2 };
     /**
      * Constructor
      * @param parent Pointer to parent object
+     * @param trigger_title Title of the triggers, %1 is replaced by their number
+     * @param size Number of triggers to start with
      */
 
-    MultiTriggerAction(QObject* object, const QString& title, const QString& trigger_title);
+    MultiTriggerAction(QObject* object, const QString& title, const QString& trigger_title, std::size_t size = DefaultSize);
     ~MultiTriggerAction();
 
     /**
@@ -34,7 +36,15 @@ public:
      */
     QMenu* getContextMenu(QWidget* parent = nullptr) override;
 
-    TriggerAction* getTriggerAction(uint8_t id);
+    TriggerAction* getTriggerAction(std::size_t id);
+
+    /** Appends a trigger numbered after the existing ones */
+    TriggerAction* addTriggerAction();
+
+    /** Removes the last trigger */
+    void removeLastTriggerAction();
+
+    std::size_t getNumTriggerActions() const { return _triggerAction.size(); }
 
     
 public:// Serialization
@@ -53,5 +63,6 @@ public:// Serialization
 
 
 private:
-    std::array<QSharedPointer<TriggerAction>,Size> _triggerAction;
+    QString _triggerTitle;
+    std::vector<QSharedPointer<TriggerAction>> _triggerAction;
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <PointData/PointData.h>
+
+#include "engine/MatrixView.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+//
+// Adapters between mv::Dataset<Points> and the Qt-free DE engine
+//
+
+// Engine element type for a Points storage type, bfloat16 storage is layout-compatible
+template <typename StorageType>
+struct EngineElementType { using type = StorageType; };
+
+template <>
+struct EngineElementType<biovault::bfloat16_t> { using type = de::BFloat16; };
+
+/*  Calls functionObject with a de::DenseMatrixView over the raw storage of points
+    For subsets (non-full datasets) the view covers the raw data of the full dataset,
+    use storageRows() to translate row indices of points into rows of the view.
+*/
+template <typename FunctionObject>
+void visitPointsMatrix(const mv::Dataset<Points>& points, FunctionObject functionObject)
+{
+    const std::size_t numDimensions = points->getNumDimensions();
+
+    points->visitFromBeginToEnd([&functionObject, numDimensions](auto begin, auto end) -> void {
+        using StorageType = std::remove_cv_t<std::remove_reference_t<decltype(*begin)>>;
+        using ElementType = typename EngineElementType<StorageType>::type;
+        static_assert(sizeof(ElementType) == sizeof(StorageType));
+
+        const auto* data = reinterpret_cast<const ElementType*>(std::to_address(begin));
+        const std::size_t numRows = numDimensions == 0 ? 0 : static_cast<std::size_t>(end - begin) / numDimensions;
+
+        functionObject(de::DenseMatrixView<ElementType>{ data, numRows, numDimensions });
+        });
+}
+
+// Rows of points as rows of the view passed by visitPointsMatrix, buffer holds them if they need translation
+inline de::RowIndices storageRows(const mv::Dataset<Points>& points, const std::vector<std::uint32_t>& rows, std::vector<std::uint32_t>& buffer)
+{
+    if (points->isFull())
+        return rows;
+
+    buffer.resize(rows.size());
+    std::transform(rows.cbegin(), rows.cend(), buffer.begin(), [&points](std::uint32_t row) { return points->indices[row]; });
+    std::sort(buffer.begin(), buffer.end());
+
+    return buffer;
+}
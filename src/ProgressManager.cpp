@@ -1,376 +1,144 @@
 #include "ProgressManager.h"
 
-#include <iostream>
-#include <iomanip>
-#include <cassert>
-#include <stdexcept>
+#include "ButtonProgressBar.h"
 
-#include <QProgressDialog>
-#include <QProgressBar>
-#include <QApplication>
-#include <QLabel>
-#include <QMainWindow>
+#include <QCoreApplication>
 
-#include <omp.h>
+#include <algorithm>
+#include <cmath>
 
-namespace local
-{
-    static QMainWindow* getMainWindow()
-    {
-        foreach(QWidget * widget, qApp->topLevelWidgets())
-            if (QMainWindow* mainWindow = qobject_cast<QMainWindow*>(widget))
-                return mainWindow;
-        return nullptr;
-    }
-}
-
-ProgressManager::ProgressManager()
-	:m_available(true)
-	, m_progressDialog(nullptr)
-	, m_progressBar(nullptr)
-	, m_progressBarLabel(nullptr)
-	, m_noProgressDialog(false)
+ProgressManager::ProgressManager(QObject* parent)
+	: QObject(parent)
+	, m_done(0)
+	, m_total(0)
+	, m_lastFlushMs(0)
+	, m_active(false)
 	, m_cancelled(false)
-	, m_autoRaise(true)
-	, m_scaleFactor(0)
-	, m_maxRange(0)
+	, m_guiThreadId(std::this_thread::get_id())
+	, m_timer(this)
+	, m_progressBar(nullptr)
 {
-	
+	m_timer.setInterval(UPDATE_INTERVAL_MS);
+	m_timer.setTimerType(Qt::CoarseTimer);
+	connect(&m_timer, &QTimer::timeout, this, &ProgressManager::flush);
 }
 
 ProgressManager::~ProgressManager()
 {
-	m_cancelled = true;
-	m_available = false;
-	if (m_progressDialog)
-	{
-		while (!m_progressDialog->wasCanceled());
-		delete m_progressDialog;
-		m_progressDialog = nullptr;
-	}
-	else
-	{
-		m_progressBarLabel = nullptr;
-		m_progressBar = nullptr;
-	}
+	m_timer.stop();
 }
 
-bool ProgressManager::available() const
+void ProgressManager::setProgressBar(ButtonProgressBar* progressBar)
 {
-	return m_available;
-}
-
-bool ProgressManager::autoRaise() const
-{
-	return m_autoRaise;
+	m_progressBar = progressBar;
 }
 
-void ProgressManager::start(std::size_t size, const std::string &mesg)
+void ProgressManager::start(std::uint64_t total, const QString& labelText)
 {
+	m_done.store(0, std::memory_order_relaxed);
+	m_total.store(total, std::memory_order_relaxed);
+	m_cancelled.store(false, std::memory_order_relaxed);
+	m_lastFlushMs.store(0, std::memory_order_relaxed);
+	m_labelText = labelText;
+	m_elapsed.start();
+	m_active.store(true, std::memory_order_release);
 
-	while (!m_available);
-
-	m_available = false;
-	
-	if (m_progressBar)
-	{
-		
-	}
-	else if (!m_noProgressDialog)
-	{
-		if (omp_get_thread_num() == 0)
-		{
-			if (m_progressDialog == nullptr)
-				m_progressDialog = new QProgressDialog(local::getMainWindow(), Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint);
-			if (m_cancelled == false)
-				m_progressDialog->setLabelText(mesg.c_str());
-			m_progressDialog->setWindowModality(Qt::WindowModal);
-			m_progressDialog->setCancelButton(nullptr);
-			m_progressDialog->setMinimumDuration(150);
-			m_progressDialog->show();
-			if (m_autoRaise)
-			{
-				m_progressDialog->raise();
-			}
-			
-		}
-	}
-
-	setLabelText(mesg.c_str());
-	setRange(size);
-	qApp->processEvents();
-}
-
-void ProgressManager::setRange( std::size_t size)
-{
-	m_maxRange = size;
-	if (m_maxRange)
-		m_scaleFactor = static_cast<float>(MAX_RANGE) / m_maxRange;
-	else
-		m_scaleFactor = 0;
-	m_progress.assign(size, 0);
-	if (m_progressBar)
-	{
-		if(size)
-			m_progressBar->setRange(0, MAX_RANGE);
-		else
-			m_progressBar->setRange(0, 0);
-		m_progressBar->setValue(0);
-		m_progressBar->update();
-	}
-	else if (m_progressDialog)
-	{
-		if(size)
-			m_progressDialog->setRange(0, MAX_RANGE);
-		else
-			m_progressDialog->setRange(0, 0);
-		m_progressDialog->setValue(0);
-		m_progressDialog->update();
-	}
+	flush();
+	m_timer.start();
 }
 
-void ProgressManager::setAutoRaise(bool value)
+void ProgressManager::advance(std::uint64_t steps)
 {
-	m_autoRaise = value;
-}
+	const std::uint64_t previous = m_done.fetch_add(steps, std::memory_order_relaxed);
 
-void ProgressManager::setProgressBar(QProgressBar *progressBar)
-{
-	
-	if (progressBar == m_progressBar)
+	// Everything below only concerns the GUI thread doing the work itself: it cannot serve
+	// the timer, so it flushes on its own. Only look at the clock every 256 items.
+	if (((previous ^ (previous + steps)) >> 8) == 0)
+		return;
+	if (std::this_thread::get_id() != m_guiThreadId)
 		return;
-	while (!m_available);
-	m_progressBar = progressBar;
-	
-}
-
-void ProgressManager::setProgressBarLabel(QLabel* label)
-{
-	m_progressBarLabel = label;
-}
 
-void ProgressManager::setNoProgressDialog(bool value)
-{
-	while (!m_available);
-	if (value)
-	{
-		delete  m_progressDialog;
-	}
-	m_noProgressDialog = value;
-}
+	const std::int64_t now = m_elapsed.elapsed();
+	if (now - m_lastFlushMs.load(std::memory_order_relaxed) < UPDATE_INTERVAL_MS)
+		return;
 
-void ProgressManager::setValue(std::size_t value)
-{
-	const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
-	if (m_progressBar)
-	{
-		m_progressBar->setValue(progressValue);
-		m_progressBar->update();
-	}
-	else if (m_progressDialog)
-	{
-		m_progressDialog->setValue(progressValue);
-		m_progressDialog->update();
-	}
-	qApp->processEvents();
+	flush();
+	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
-void ProgressManager::print(long long i)
+void ProgressManager::setLabelText(const QString& labelText)
 {
-    assert(m_progress[i] == 0);
-    if (m_progress[i] > 0)
-        throw std::out_of_range("ProgressManager - Out Of Range\n");
-	m_progress[i] = 1;
-	if (omp_get_thread_num() == 0)
-	{
-		int64_t zero = 0;
-		int64_t value = std::accumulate(m_progress.cbegin(), m_progress.cend(), zero);
-		const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
-
-      
-		if (m_progressBar || m_progressDialog)
-		{
-			
-			if (m_progressBar)
-			{
-				m_progressBar->setValue(progressValue);
-			}
-			else if (m_progressDialog)
-			{
-				m_progressDialog->setValue(progressValue);
-				if (m_autoRaise)
-				{
-					m_progressDialog->update();
-					m_progressDialog->raise();
-				}
-			}
-		}		
-
-	//	else
-	//		qDebug << "  print:: progressbar&m_progressDialog not set";
-	}
-	qApp->processEvents();
+	m_labelText = labelText;
+	flush();
 }
 
 void ProgressManager::end()
 {
-	m_available = true;
-	
-	if (omp_get_thread_num() == 0)
-	{
-
-	}
-
-	if (m_progressBar)
-	{
-		m_progressBar->setValue(m_progressBar->maximum());
-	}
-	else if (m_progressDialog)
-	{
-		m_progressDialog->cancel();
-		m_progressDialog->hide();
-	}
-	
+	m_timer.stop();
+	m_done.store(m_total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	flush();
+	m_active.store(false, std::memory_order_release);
+	emit ended();
 }
 
-void ProgressManager::setLabelText(const QString& mesg)
+bool ProgressManager::active() const
 {
-	m_labelText = mesg;
-	if (m_progressBar)
-	{
-		if (m_progressBarLabel)
-		{
-			m_progressBarLabel->setText(m_labelText);
-			m_progressBarLabel->update();
-		}
-		else
-		{
-			//m_labelText += " %p%";
-			m_progressBar->setFormat(m_labelText);
-			m_progressBar->update();
-		}
-	}
-	else if (m_progressDialog)
-	{
-		m_progressDialog->setLabelText(m_labelText);
-		m_progressDialog->update();
-	}
+	return m_active.load(std::memory_order_acquire);
 }
 
-void ProgressManager::update()
+bool ProgressManager::canceled() const
 {
-	if (m_progressBar)
-		m_progressBar->update();
-	else if (m_progressDialog)
-	{
-		m_progressDialog->update();
-	}
+	return m_cancelled.load(std::memory_order_relaxed);
 }
 
-void ProgressManager::setMaximum(int value)
+void ProgressManager::setCanceled(bool value)
 {
-	if (m_progressBar)
-		m_progressBar->setMaximum(value);
-	else if (m_progressDialog)
-		m_progressDialog->setMaximum(value);
+	m_cancelled.store(value, std::memory_order_relaxed);
 }
 
-void ProgressManager::setMinimum(int value)
+std::uint64_t ProgressManager::done() const
 {
-	if (m_progressBar)
-		m_progressBar->setMinimum(value);
-	else if (m_progressDialog)
-		m_progressDialog->setMinimum(value);
+	return m_done.load(std::memory_order_relaxed);
 }
 
-int ProgressManager::maximum() const
+std::uint64_t ProgressManager::total() const
 {
-	if (m_progressBar)
-		return m_progressBar->maximum();
-	if(m_progressDialog)
-		return m_progressDialog->maximum();
-	return 0;
+	return m_total.load(std::memory_order_relaxed);
 }
 
-int ProgressManager::minimum() const
+double ProgressManager::fraction() const
 {
-	if (m_progressBar)
-		return m_progressBar->minimum();
-	if (m_progressDialog)
-		return m_progressDialog->minimum();
-	return 0;
+	const std::uint64_t total = m_total.load(std::memory_order_relaxed);
+	if (total == 0)
+		return 0.0;
+	return std::min(1.0, static_cast<double>(m_done.load(std::memory_order_relaxed)) / total);
 }
 
-void ProgressManager::setTextVisible(bool value)
+double ProgressManager::etaSeconds() const
 {
-	if (m_progressBar)
-		m_progressBar->setTextVisible(value);
+	const double progress = fraction();
+	const double elapsedSeconds = m_elapsed.isValid() ? m_elapsed.elapsed() / 1000.0 : 0.0;
+	// the first few percent are dominated by setup costs and give wild estimates
+	if (progress < 0.02 || elapsedSeconds < 0.25)
+		return -1.0;
+	return elapsedSeconds * (1.0 - progress) / progress;
 }
 
-int ProgressManager::value() const
+QString ProgressManager::progressText() const
 {
-	if (m_progressBar)
-		if (m_scaleFactor)
-			return m_progressBar->value() / m_scaleFactor;
-		else
-			return m_progressBar->value();
-	if (m_progressDialog)
-		if (m_scaleFactor)
-			return m_progressDialog->value() / m_scaleFactor;
-		else
-			return m_progressDialog->value();
-	return -1;
-}
+	QString text = QString("%1 %2%").arg(m_labelText).arg(static_cast<int>(std::floor(100.0 * fraction())));
 
+	const double eta = etaSeconds();
+	if (eta >= 0.0 && fraction() < 1.0)
+		text += QString(" (ETA %1 s)").arg(std::ceil(eta), 0, 'f', 0);
 
-int  ProgressManager::currentProgress() const
-{
-    if (omp_get_thread_num() == 0)
-    {
-        int64_t zero = 0;
-        int64_t value = std::accumulate(m_progress.cbegin(), m_progress.cend(), zero);
-        const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
-        return progressValue;
-    }
-    return 0;
+	return text;
 }
 
-bool ProgressManager::canceled() const
+void ProgressManager::flush()
 {
-	
-	return m_cancelled;
-}
+	m_lastFlushMs.store(m_elapsed.isValid() ? m_elapsed.elapsed() : 0, std::memory_order_relaxed);
 
-void ProgressManager::setCanceled(bool value)
-{
-	if (value == m_cancelled)
-		return;
-	m_cancelled = value;
-	if (omp_get_thread_num() == 0)
-	{
-		//std::cout << "ProgressManager::setCanceled(" << (value ? "true" : "false") << ")\n";
-		m_labelText = "Canceling... ";
-		if (m_cancelled)
-		{
-			if (m_progressBar)
-			{
-				m_progressBar->setFormat(m_labelText);
-			}
-// 			else if (m_progressDialog)
-// 			{
-// 				m_progressDialog->setLabelText(m_mesg.c_str());
-// 			}
-		}
-		else
-		{
-			if (m_progressBar)
-			{
-				m_progressBar->setFormat("");
-			}
-			else if (m_progressDialog)
-			{
-				m_progressDialog->setLabelText("");
-			}
-		}
-	}
+	if (m_progressBar)
+		m_progressBar->setProgress(fraction(), progressText());
 }
@@ -2,56 +2,79 @@
 
 #include <atomic>
 #include <cstdint>
-#include <string>
-#include <vector>
+#include <thread>
 
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
 #include <QString>
+#include <QTimer>
 
-class QProgressDialog;
-class QProgressBar;
-class QLabel;
-class QWidgetAction;
+#include "engine/ProgressSink.h"
 
-class ProgressManager
-{
-private:
-    static constexpr int MAX_RANGE = 1000;
-
-	std::vector<int8_t> m_progress;
-	QString m_labelText;
-	QProgressDialog *m_progressDialog;
-	std::atomic<bool> m_available;
-	QProgressBar *m_progressBar;
-	QLabel* m_progressBarLabel;
-	std::atomic<bool> m_cancelled;
-	bool m_noProgressDialog;
-	bool m_autoRaise;
-	float m_scaleFactor;
-	std::size_t m_maxRange;
+class ButtonProgressBar;
 
+/*  Lock-free progress channel
+    Worker threads (e.g. of the task pool running the DE engine) only bump an atomic counter
+    with advance(), which is safe and cheap to call from any thread.
+    The GUI is refreshed at most every UPDATE_INTERVAL_MS (~30 Hz): by a timer when the work
+    runs on another thread, or by the GUI thread itself when it is busy doing the work.
+*/
+class ProgressManager : public QObject, public de::ProgressSink
+{
+	Q_OBJECT
 public:
-	ProgressManager();
-	~ProgressManager();
-	bool available() const;
-	bool autoRaise() const;
-	bool canceled() const;
-	void setCanceled(bool value);
-	void start(std::size_t, const std::string &mesg);
-	void setRange(std::size_t size);
-	void setAutoRaise(bool value);
-	void setProgressBar(QProgressBar *progressBar);
-	void setProgressBarLabel(QLabel* label);
-	void setNoProgressDialog(bool value);
-	void setValue(std::size_t value);
-	void print(long long i);
+	static constexpr int UPDATE_INTERVAL_MS = 33;
+
+	ProgressManager(QObject* parent = nullptr);
+	~ProgressManager() override;
+
+	void setProgressBar(ButtonProgressBar* progressBar);
+
+	/** Reset the counters and start reporting, call from the GUI thread */
+	void start(std::uint64_t total, const QString& labelText);
+
+	/** Mark a number of work items as done, may be called from any thread */
+	void advance(std::uint64_t steps = 1) override;
+
+	/** Update the label shown in front of the percentage, call from the GUI thread */
+	void setLabelText(const QString& labelText);
+
+	/** Stop reporting, call from the GUI thread */
 	void end();
-	void setLabelText(const QString& mesg);
-	void update();
-	void setMaximum(int value);
-	void setMinimum(int value);
-	int maximum() const;
-	int minimum() const;
-	void setTextVisible(bool value);
-	int value() const;
-    int currentProgress() const;
+
+	bool active() const;
+	bool canceled() const override;
+	void setCanceled(bool value);
+
+	std::uint64_t done() const;
+	std::uint64_t total() const;
+
+	/** Fraction of work done in [0, 1] */
+	double fraction() const;
+
+	/** Estimated remaining time in seconds, negative if unknown */
+	double etaSeconds() const;
+
+	/** Percentage and ETA, e.g. "Computing DE 42% (ETA 3 s)" */
+	QString progressText() const;
+
+signals:
+	/** Emitted by end(), e.g. to resume work that waited for the computation */
+	void ended();
+
+private slots:
+	void flush();
+
+private:
+	std::atomic<std::uint64_t>	m_done;
+	std::atomic<std::uint64_t>	m_total;
+	std::atomic<std::int64_t>	m_lastFlushMs;
+	std::atomic<bool>			m_active;
+	std::atomic<bool>			m_cancelled;
+	std::thread::id				m_guiThreadId;
+	QElapsedTimer				m_elapsed;
+	QTimer						m_timer;
+	QString						m_labelText;
+	QPointer<ButtonProgressBar>	m_progressBar;
 };
@@ -1,5 +1,7 @@
 #include "TableModel.h"
 
+#include "ProgressManager.h"
+
 #include <QApplication>
 #include <QClipboard>
 #include <QMetaType>
@@ -32,6 +34,7 @@ TableModel::TableModel(QObject *parent /*= Q_NULLPTR*/, bool checkable)
 	, m_columns(0)
 	, m_status(Status::Undefined)
 	, m_headerStatus(Status::Undefined)
+	, m_performanceTrace(nullptr)
 {
 	
 }
@@ -234,6 +237,7 @@ void TableModel::clear()
 
 void TableModel::startModelBuilding(qsizetype columns, qsizetype rows)
 {
+	m_buildingStart = de::PerformanceTrace::Clock::now();
 	beginResetModel();
 	resize(rows, columns);
 
@@ -267,8 +271,28 @@ void TableModel::endModelBuilding()
 		emit headerDataChanged(Qt::Horizontal, 0, m_columns - 1);
 		m_headerStatus = Status::UpToDate;
 	}
-	endResetModel();
-	emit dataChanged(index(0, 0), index(m_data.size(), m_columns));
+
+	{
+		// connected views and proxies (re-)sort and filter in response to the reset
+		de::PerformanceTrace::Scope scope(m_performanceTrace, "Model reset and proxy re-sort", "model");
+		endResetModel();
+		emit dataChanged(index(0, 0), index(m_data.size(), m_columns));
+	}
+
+	if (m_performanceTrace)
+		m_performanceTrace->record("Table model building", "model", m_buildingStart, de::PerformanceTrace::Clock::now(), m_data.size() * m_columns * sizeof(QVariant));
+}
+
+void TableModel::endRowUpdates()
+{
+	setStatus(Status::UpToDate);
+
+	if (!m_data.empty() && m_columns > 0)
+	{
+		// views and proxies keep their selection and scroll position, proxies re-sort the changed range
+		de::PerformanceTrace::Scope scope(m_performanceTrace, "Model update and proxy re-sort", "model");
+		emit dataChanged(index(0, 0), index(static_cast<int>(m_data.size()) - 1, static_cast<int>(m_columns) - 1));
+	}
 }
 
 QVariant TableModel::getHorizontalHeader(int index) const
@@ -310,7 +334,7 @@ bool TableModel::setHeaderData(int section, Qt::Orientation orientation, const Q
 	return false;
 }
 
-QString TableModel::createCSVString(const QChar separatorChar) const
+QString TableModel::createCSVString(const QChar separatorChar, ProgressManager* progress) const
 {
 	const QString DisplayRoleKey = QString::number(Qt::DisplayRole);
 
@@ -417,14 +441,17 @@ QString TableModel::createCSVString(const QChar separatorChar) const
 			
 		}
 		result += "\n";
+
+		if (progress)
+			progress->advance();
 	}
 
 	return result;
 }
 
-void TableModel::copyToClipboard(const QChar separatorChar) const
+void TableModel::copyToClipboard(const QChar separatorChar, ProgressManager* progress) const
 {
-	QString result = createCSVString(separatorChar);
+	QString result = createCSVString(separatorChar, progress);
 	QClipboard *clipboard = QApplication::clipboard();
 	clipboard->setText(result);
 }
@@ -454,6 +481,11 @@ void TableModel::setHeaderStatus(TableModel::Status status)
 	}
 }
 
+void TableModel::setPerformanceTrace(de::PerformanceTrace* trace)
+{
+	m_performanceTrace = trace;
+}
+
 TableModel::Status TableModel::status()
 {
 	return m_status;
@@ -4,8 +4,12 @@
 #include <QAbstractTableModel>
 #include <vector>
 
+#include "engine/PerformanceTrace.h"
+
 //#include "QStandardItemModel"
 
+class ProgressManager;
+
 
 class TableModel : public QAbstractTableModel
 {
@@ -52,20 +56,26 @@ public:
 	void startModelBuilding(qsizetype columns, qsizetype rows);
 
 	void endModelBuilding();
+
+	/** Notify views of the rows set silently since, in place of a model reset; row and column counts are unchanged */
+	void endRowUpdates();
 	QVariant getHorizontalHeader(int index) const;
 	void setHorizontalHeader(int index, QVariant &value);
 	void setHorizontalHeader(int index, const QString& value);
 	
 	bool setHeaderData(int section, Qt::Orientation orientation, const QVariant& value, int role = Qt::EditRole) override;
 
-	QString createCSVString(const QChar separatorChar = '\t') const;
-	void copyToClipboard(const QChar separatorChar='\t') const;
+	QString createCSVString(const QChar separatorChar = '\t', ProgressManager* progress = nullptr) const;
+	void copyToClipboard(const QChar separatorChar='\t', ProgressManager* progress = nullptr) const;
 	
 	void invalidate();
 
 	void setStatus(Status status);
 	void setHeaderStatus(Status status);
 
+	/** Record model building and the resulting (proxy) reset in \p trace, may be nullptr */
+	void setPerformanceTrace(de::PerformanceTrace* trace);
+
 public:
 	Status status();
 
@@ -81,6 +91,8 @@ private:
 	std::size_t m_columns;
 	Status m_status;
 	Status m_headerStatus;
+	de::PerformanceTrace* m_performanceTrace;
+	de::PerformanceTrace::Clock::time_point m_buildingStart;
 };
 
 #endif
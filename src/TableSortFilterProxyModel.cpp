@@ -1,7 +1,10 @@
 #include "TableSortFilterProxyModel.h"
 
+#include "engine/PerformanceTrace.h"
+
 TableSortFilterProxyModel::TableSortFilterProxyModel(QObject* parent)
     :QSortFilterProxyModel(parent)
+    , m_performanceTrace(nullptr)
 {
     m_nameRegExpFilter.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
 }
@@ -39,8 +42,22 @@ bool TableSortFilterProxyModel::lessThan(const QModelIndex& source_left, const Q
     return QSortFilterProxyModel::lessThan(source_left, source_right);
 }
 
+void TableSortFilterProxyModel::sort(int column, Qt::SortOrder order)
+{
+    // only the latest sort is kept in the trace, it is recorded at every click on a header
+    de::PerformanceTrace::Scope scope(m_performanceTrace, "Proxy sort", "view", 0, true);
+    QSortFilterProxyModel::sort(column, order);
+}
+
+void TableSortFilterProxyModel::setPerformanceTrace(de::PerformanceTrace* trace)
+{
+    m_performanceTrace = trace;
+}
+
 void TableSortFilterProxyModel::nameFilterChanged(const QString& text)
 {
+    // only the latest filtering is kept in the trace, it is recorded at every key stroke
+    de::PerformanceTrace::Scope scope(m_performanceTrace, "Proxy filter", "view", 0, true);
     m_nameRegExpFilter.setPattern(text);
     invalidate();
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <QSortFilterProxyModel>
 #include <QRegularExpression>
 
+namespace de { class PerformanceTrace; }
+
 class TableSortFilterProxyModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -9,6 +11,11 @@ class TableSortFilterProxyModel : public QSortFilterProxyModel
 public:
     TableSortFilterProxyModel(QObject* parent = nullptr);
 
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    /** Record sorting and filtering in \p trace, may be nullptr */
+    void setPerformanceTrace(de::PerformanceTrace* trace);
+
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
     bool filterAcceptsColumn(int source_column, const QModelIndex& source_parent) const override;
@@ -19,4 +26,5 @@ public slots:
 
 private:
     QRegularExpression	m_nameRegExpFilter;
+    de::PerformanceTrace* m_performanceTrace;
 };
\ No newline at end of file
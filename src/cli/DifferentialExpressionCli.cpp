@@ -0,0 +1,499 @@
+// Headless driver for the DE engine: runs the same computation as the plugin on a matrix file
+
+#include "engine/ChunkedStatistics.h"
+#include "engine/DifferentialExpression.h"
+#include "engine/DimensionRanges.h"
+#include "engine/GroupStatistics.h"
+#include "engine/MatrixIO.h"
+#include "engine/PerformanceTrace.h"
+#include "engine/ProgressiveStatistics.h"
+#include "engine/ResultTable.h"
+#include "engine/StrategyPlanner.h"
+#include "engine/TaskPool.h"
+#include "engine/TransposedMatrix.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace local
+{
+    const char* usage =
+        "Usage: DifferentialExpressionCli --matrix FILE --selection1 FILE --selection2 FILE [options]\n"
+        "       DifferentialExpressionCli --matrix FILE --groups FILE [options]\n"
+        "       DifferentialExpressionCli --matrix FILE --selections FILE,FILE[,...] [options]\n"
+        "\n"
+        "  --matrix FILE        binary matrix (DEMX format, dense or sparse, rows are items)\n"
+        "  --selection1 FILE    whitespace separated row indices of the first selection\n"
+        "  --selection2 FILE    whitespace separated row indices of the second selection\n"
+        "  --groups FILE        group label per row, one per line (empty for none), for one-vs-rest statistics of all groups\n"
+        "  --selections LIST    comma separated selection files, for the statistics of every pair of selections from one scan\n"
+        "  --bins N             histogram bins per group and dimension for medians and rank tests of groups and selection pairs (default 64)\n"
+        "  --memory-limit MB    stream the matrix file in blocks of rows, never holding more than MB megabytes;\n"
+        "                       medians and rank tests are then approximated from histograms (see --bins)\n"
+        "  --strategy NAME      algorithm for two selections: auto (default), exact, sparse, counts, transposed, histogram or chunked\n"
+        "  --memory-budget MB   working memory for two selections, on top of the matrix; auto picks the fastest\n"
+        "                       exact strategy within it, else the fastest approximate one (default unlimited)\n"
+        "  --transpose          for two selections: first make a dimension-major copy of the matrix, for the transposed strategy\n"
+        "  --progressive        for two selections: first compute growing stratified samples, printing the\n"
+        "                       confidence of the DE ranking after every round to stderr\n"
+        "  --names FILE         dimension names, one per line\n"
+        "  --dimensions FILE    compute only the dimensions named in FILE, one per line (e.g. a gene panel), needs --names\n"
+        "  --top K              write only the K dimensions with the largest |DE|, in descending order\n"
+        "  --output FILE        result table, written to stdout if omitted\n"
+        "  --separator CHAR     column separator of the result table (default ',')\n"
+        "  --additional         also compute SD and % expressed\n"
+        "  --tests              also compute Welch's t-test, Wilcoxon rank-sum test, AUROC and BH adjusted p-values\n"
+        "  --normalize          min-max normalize means, medians and SDs\n"
+        "  --threshold VALUE    threshold for % expressed (default 0)\n"
+        "  --threads N          threads that compute, at most OMP_NUM_THREADS or else the hardware threads (default all)\n"
+        "  --timings            print per-phase timings to stderr\n"
+        "  --trace FILE         write per-phase timings as Chrome trace-event JSON\n";
+
+    const std::vector<std::string> flagOptions = { "--additional", "--tests", "--normalize", "--transpose", "--progressive", "--timings", "--help" };
+
+    std::map<std::string, std::string> parseArguments(int argc, char* argv[])
+    {
+        std::map<std::string, std::string> arguments;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string name = argv[i];
+            if (name.rfind("--", 0) != 0)
+                throw std::runtime_error("Unexpected argument " + name);
+
+            if (std::find(flagOptions.begin(), flagOptions.end(), name) != flagOptions.end())
+                arguments[name] = "1";
+            else if (i + 1 < argc)
+                arguments[name] = argv[++i];
+            else
+                throw std::runtime_error("Missing value for " + name);
+        }
+
+        return arguments;
+    }
+
+    std::vector<std::uint32_t> readSelection(const std::string& filePath, std::size_t numRows)
+    {
+        std::vector<std::uint32_t> selection = de::readIndices(filePath);
+
+        // ensure selection is unique and sorted, like selections saved in the plugin
+        std::sort(selection.begin(), selection.end());
+        selection.erase(std::unique(selection.begin(), selection.end()), selection.end());
+
+        if (!selection.empty() && selection.back() >= numRows)
+            throw std::runtime_error("Row index " + std::to_string(selection.back()) + " in " + filePath + " is out of range");
+        if (selection.empty())
+            throw std::runtime_error("Selection " + filePath + " is empty");
+
+        return selection;
+    }
+
+    std::vector<std::string> splitList(const std::string& list, char separator)
+    {
+        std::vector<std::string> items;
+        std::size_t begin = 0;
+        for (std::size_t end = list.find(separator); ; end = list.find(separator, begin))
+        {
+            items.push_back(list.substr(begin, end - begin));
+            if (end == std::string::npos)
+                break;
+            begin = end + 1;
+        }
+        return items;
+    }
+
+    // Group indices per row, groups are numbered in order of first appearance of their label
+    std::vector<std::int32_t> readGroupLabels(const std::string& filePath, std::size_t numRows, std::vector<std::string>& groupNames)
+    {
+        const std::vector<std::string> labels = de::readNames(filePath);
+        if (labels.size() != numRows)
+            throw std::runtime_error(filePath + " has " + std::to_string(labels.size()) + " labels for " + std::to_string(numRows) + " rows");
+
+        std::map<std::string, std::int32_t> groups;
+        std::vector<std::int32_t> rowGroups(numRows, -1);
+        for (std::size_t row = 0; row < numRows; ++row)
+        {
+            if (labels[row].empty())
+                continue;
+
+            const auto [found, inserted] = groups.try_emplace(labels[row], static_cast<std::int32_t>(groupNames.size()));
+            if (inserted)
+                groupNames.push_back(labels[row]);
+            rowGroups[row] = found->second;
+        }
+
+        return rowGroups;
+    }
+
+    // Sorted column indices of the names in filePath
+    std::vector<std::uint32_t> readDimensions(const std::string& filePath, const std::vector<std::string>& names)
+    {
+        if (names.empty())
+            throw std::runtime_error("--dimensions needs --names");
+
+        std::map<std::string, std::uint32_t> columns;
+        for (std::size_t column = 0; column < names.size(); ++column)
+            columns.try_emplace(names[column], static_cast<std::uint32_t>(column));
+
+        std::vector<std::uint32_t> dimensions;
+        for (const std::string& name : de::readNames(filePath))
+        {
+            if (name.empty())
+                continue;
+
+            const auto found = columns.find(name);
+            if (found == columns.end())
+                throw std::runtime_error("Unknown dimension " + name + " in " + filePath);
+            dimensions.push_back(found->second);
+        }
+
+        std::sort(dimensions.begin(), dimensions.end());
+        dimensions.erase(std::unique(dimensions.begin(), dimensions.end()), dimensions.end());
+
+        if (dimensions.empty())
+            throw std::runtime_error(filePath + " names no dimensions");
+
+        return dimensions;
+    }
+
+    de::DEStrategy parseStrategy(const std::string& name)
+    {
+        for (const de::DEStrategy strategy : { de::DEStrategy::Exact, de::DEStrategy::Sparse, de::DEStrategy::Counts, de::DEStrategy::Transposed, de::DEStrategy::Histogram, de::DEStrategy::Chunked })
+        {
+            std::string strategyName = de::strategyName(strategy);
+            std::transform(strategyName.begin(), strategyName.end(), strategyName.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (name == strategyName)
+                return strategy;
+        }
+
+        if (name != "auto")
+            throw std::runtime_error("Unknown strategy " + name);
+
+        return de::DEStrategy::Automatic;
+    }
+
+    enum class Comparison { Pair, OneVsRest, AllPairs };
+
+    // Two passes over blocks of the matrix file, the first for the ranges of the histograms
+    std::vector<de::DEResult> computeChunked(de::MatrixFileReader& reader, const std::vector<std::vector<std::uint32_t>>& selections, Comparison comparison,
+                                             de::DEOptions& options, std::uint64_t memoryLimit, std::size_t maxBins, std::vector<float>& minValues, std::vector<float>& rescaleValues, de::PerformanceTrace& trace)
+    {
+        const std::size_t numGroups = selections.size();
+        const std::size_t numResults = comparison == Comparison::Pair ? 1 : comparison == Comparison::OneVsRest ? numGroups : numGroups * (numGroups - 1) / 2;
+
+        const de::ChunkPlan plan = de::planChunks(numGroups, reader.numColumns(), numResults, memoryLimit, maxBins);
+        if (!plan.fits())
+            throw std::runtime_error("Memory limit too small, the aggregates alone take " + std::to_string(plan.fixedBytes) + " bytes");
+
+        de::MatrixData block;
+        auto forEachBlock = [&reader, &block, &plan](std::uint64_t bytesPerRow, auto visitBlock) {
+            for (std::size_t row = 0; row < reader.numRows(); )
+            {
+                const std::size_t numRows = reader.rowsWithin(row, plan.blockBytes, bytesPerRow);
+                if (numRows == 0)
+                    throw std::runtime_error("Memory limit too small for row " + std::to_string(row));
+
+                reader.readRows(row, numRows, block);
+                block.visit([&](const auto& view) { visitBlock(row, view); });
+                row += numRows;
+            }
+            };
+
+        {
+            de::PerformanceTrace::Scope scope(&trace, "Dimension range scan (chunked)", "de");
+            de::DimensionRanges ranges;
+            forEachBlock(0, [&ranges](std::size_t, const auto& view) { de::mergeDimensionRanges(ranges, de::computeDimensionRanges(view)); });
+            rescaleValues = de::rescaleFactors(ranges);
+            minValues = std::move(ranges.minimum);
+            options.minValues = minValues;
+            options.rescaleValues = rescaleValues;
+        }
+
+        de::AggregationOptions aggregationOptions;
+        aggregationOptions.numBins = plan.numBins;
+        aggregationOptions.minValues = minValues;
+        aggregationOptions.rescaleValues = rescaleValues;
+        aggregationOptions.expressedThreshold = options.expressedThreshold;
+        aggregationOptions.normalizedThreshold = options.normalize;
+
+        const std::vector<de::RowIndices> selectionRows(selections.begin(), selections.end());
+        de::ChunkedAggregation aggregation(selectionRows, reader.numColumns(), aggregationOptions);
+        {
+            de::PerformanceTrace::Scope scope(&trace, "Chunked aggregation", "de", de::GroupAggregates::estimateBytes(numGroups, reader.numColumns(), plan.numBins));
+            forEachBlock(de::membershipBytesPerRow(numGroups), [&aggregation](std::size_t row, const auto& view) { aggregation.addBlock(row, view); });
+        }
+        const de::GroupAggregates aggregates = aggregation.finish();
+
+        if (comparison == Comparison::OneVsRest)
+            return de::compareOneVsRest(aggregates, options, nullptr, &trace);
+        if (comparison == Comparison::AllPairs)
+            return de::compareAllPairs(aggregates, options, nullptr, &trace);
+        return { de::compareGroups(aggregates, 0, aggregates, 1, options) };
+    }
+
+    template <typename Write>
+    void writeOutput(const std::string& filePath, Write write)
+    {
+        if (filePath.empty())
+        {
+            write(std::cout);
+            return;
+        }
+
+        std::ofstream output(filePath, std::ios::trunc);
+        if (!output)
+            throw std::runtime_error("Cannot open " + filePath + " for writing");
+        write(output);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const auto arguments = local::parseArguments(argc, argv);
+
+        const bool allPairs = arguments.contains("--selections");
+        const bool grouped = arguments.contains("--groups") || allPairs;
+        if (arguments.contains("--help") || !arguments.contains("--matrix") || (!grouped && (!arguments.contains("--selection1") || !arguments.contains("--selection2"))))
+        {
+            std::cerr << local::usage;
+            return arguments.contains("--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        auto argument = [&arguments](const std::string& name, const std::string& defaultValue = {}) -> std::string {
+            const auto found = arguments.find(name);
+            return found == arguments.end() ? defaultValue : found->second;
+            };
+
+        if (arguments.contains("--threads"))
+            de::TaskPool::shared().setConcurrency(std::stoul(argument("--threads")));
+
+        de::PerformanceTrace trace;
+        trace.reset("DifferentialExpressionCli");
+
+        // with a memory limit the matrix is streamed from the file instead of read at once
+        const bool chunked = arguments.contains("--memory-limit");
+        std::unique_ptr<de::MatrixFileReader> reader;
+        de::MatrixData matrix;
+        if (chunked)
+        {
+            reader = std::make_unique<de::MatrixFileReader>(argument("--matrix"));
+            matrix.numRows = reader->numRows();
+            matrix.numColumns = reader->numColumns();
+        }
+        else
+        {
+            de::PerformanceTrace::Scope scope(&trace, "Read matrix", "io");
+            matrix = de::readMatrix(argument("--matrix"));
+            scope.addBytes(matrix.values.size() + matrix.rowOffsets.size() * sizeof(std::uint64_t) + matrix.columnIndices.size() * sizeof(std::uint32_t));
+        }
+
+        std::vector<std::uint32_t> selectionA, selectionB;
+        std::vector<std::string> groupNames;
+        std::vector<std::int32_t> rowGroups;
+        std::vector<std::vector<std::uint32_t>> selections;
+        if (allPairs)
+        {
+            const auto selectionFiles = local::splitList(argument("--selections"), ',');
+            if (selectionFiles.size() < 2)
+                throw std::runtime_error("--selections needs at least two files");
+
+            for (const auto& selectionFile : selectionFiles)
+                selections.push_back(local::readSelection(selectionFile, matrix.numRows));
+
+            // results are named by their pair of selections
+            for (std::size_t a = 0; a < selectionFiles.size(); ++a)
+                for (std::size_t b = a + 1; b < selectionFiles.size(); ++b)
+                    groupNames.push_back(selectionFiles[a] + " vs. " + selectionFiles[b]);
+        }
+        else if (grouped)
+        {
+            rowGroups = local::readGroupLabels(argument("--groups"), matrix.numRows, groupNames);
+        }
+        else
+        {
+            selectionA = local::readSelection(argument("--selection1"), matrix.numRows);
+            selectionB = local::readSelection(argument("--selection2"), matrix.numRows);
+        }
+        const auto names = arguments.contains("--names") ? de::readNames(argument("--names")) : std::vector<std::string>{};
+        const auto dimensions = arguments.contains("--dimensions") ? local::readDimensions(argument("--dimensions"), names) : std::vector<std::uint32_t>{};
+        if (!dimensions.empty() && dimensions.back() >= matrix.numColumns)
+            throw std::runtime_error("--names has more names than the matrix has dimensions");
+
+        de::DEOptions options;
+        options.additionalStatistics = arguments.contains("--additional");
+        options.statisticalTests = arguments.contains("--tests");
+        options.normalize = arguments.contains("--normalize");
+        options.expressedThreshold = std::stof(argument("--threshold", "0"));
+        options.dimensions = dimensions;
+
+        std::vector<float> minValues, rescaleValues, maxValues;
+        std::vector<std::uint8_t> integralDimensions;
+        std::vector<de::DEResult> results;
+        if (chunked)
+        {
+            const local::Comparison comparison = allPairs ? local::Comparison::AllPairs : grouped ? local::Comparison::OneVsRest : local::Comparison::Pair;
+            if (comparison == local::Comparison::Pair)
+            {
+                selections = { std::move(selectionA), std::move(selectionB) };
+            }
+            else if (comparison == local::Comparison::OneVsRest)
+            {
+                selections.assign(groupNames.size(), {});
+                for (std::size_t row = 0; row < rowGroups.size(); ++row)
+                    if (rowGroups[row] >= 0)
+                        selections[rowGroups[row]].push_back(static_cast<std::uint32_t>(row));
+            }
+
+            const std::uint64_t memoryLimit = static_cast<std::uint64_t>(std::stod(argument("--memory-limit")) * 1024 * 1024);
+            results = local::computeChunked(*reader, selections, comparison, options, memoryLimit, std::stoul(argument("--bins", "64")), minValues, rescaleValues, trace);
+        }
+        else
+        {
+            const de::DEStrategy strategy = local::parseStrategy(argument("--strategy", "auto"));
+
+            results = matrix.visit([&](const auto& view) -> std::vector<de::DEResult> {
+                // groups, counts and the histogram strategies need the ranges; the plugin has them cached, so Automatic may pick any strategy
+                if (options.normalize || grouped || (strategy != de::DEStrategy::Exact && strategy != de::DEStrategy::Sparse && strategy != de::DEStrategy::Transposed))
+                {
+                    de::PerformanceTrace::Scope scope(&trace, "Dimension range scan", "de");
+                    de::DimensionRanges ranges = de::computeDimensionRanges(view);
+                    rescaleValues = de::rescaleFactors(ranges);
+                    minValues = std::move(ranges.minimum);
+                    maxValues = std::move(ranges.maximum);
+                    integralDimensions = std::move(ranges.integral);
+                    options.minValues = minValues;
+                    options.rescaleValues = rescaleValues;
+                    options.maxValues = maxValues;
+                    options.integralDimensions = integralDimensions;
+                }
+
+                // the dimension-major copy the plugin builds in the background
+                using Matrix = std::decay_t<decltype(view)>;
+                de::MatrixData transposed;
+                if (arguments.contains("--transpose") && !grouped)
+                    transposed = de::transposeMatrix(view, nullptr, &trace);
+                const Matrix transposedView = de::transposedView<Matrix>(transposed);
+                const Matrix* transposedMatrix = arguments.contains("--transpose") ? &transposedView : nullptr;
+
+                de::DEProblem problem;
+                de::DEPlan plan;
+                if (!grouped)
+                {
+                    const std::uint64_t memoryBudget = arguments.contains("--memory-budget") ? static_cast<std::uint64_t>(std::stod(argument("--memory-budget")) * 1024 * 1024) : std::numeric_limits<std::uint64_t>::max();
+
+                    problem = de::describeProblem(view, selectionA, selectionB);
+                    problem.transposedCopy = transposedMatrix != nullptr;
+                    plan = de::planDifferentialExpression(problem, options, memoryBudget, strategy);
+
+                    if (arguments.contains("--timings"))
+                    {
+                        std::cerr << "Plan: " << plan.describe() << "\n";
+                        if (problem.overlap > 0)
+                            std::cerr << problem.overlap << " rows are in both selections\n";
+                    }
+                    // the plan describes why the strategy does not apply
+                    if (!plan.feasible)
+                        throw std::runtime_error((plan.chosen().applicable ? "No strategy fits the memory budget, " : "The strategy does not apply, ") + plan.describe());
+                }
+
+                if (grouped)
+                {
+                    de::AggregationOptions aggregationOptions;
+                    aggregationOptions.numBins = std::stoul(argument("--bins", "64"));
+                    aggregationOptions.minValues = minValues;
+                    aggregationOptions.rescaleValues = rescaleValues;
+                    aggregationOptions.expressedThreshold = options.expressedThreshold;
+                    aggregationOptions.normalizedThreshold = options.normalize;
+
+                    if (allPairs)
+                    {
+                        const std::vector<de::RowIndices> selectionRows(selections.begin(), selections.end());
+                        const auto membership = de::GroupMembership::fromSelections(view.numRows, selectionRows);
+                        const auto aggregates = de::aggregateGroups(view, membership, aggregationOptions, nullptr, &trace);
+                        return de::compareAllPairs(aggregates, options, nullptr, &trace);
+                    }
+
+                    const auto membership = de::GroupMembership::fromLabels(rowGroups, groupNames.size());
+                    const auto aggregates = de::aggregateGroups(view, membership, aggregationOptions, nullptr, &trace);
+                    return de::compareOneVsRest(aggregates, options, nullptr, &trace);
+                }
+
+                if (arguments.contains("--progressive"))
+                {
+                    const de::ProgressiveOptions progressiveOptions;
+
+                    // the rounds grow, each reuses the buffers of the previous one
+                    de::ScratchArena scratch;
+                    de::DEOptions roundOptions = options;
+                    roundOptions.scratch = &scratch;
+
+                    de::ProgressiveResult round;
+                    for (const auto& [sampleSizeA, sampleSizeB] : de::progressiveSampleSizes(selectionA.size(), selectionB.size(), progressiveOptions))
+                    {
+                        const auto roundStart = de::PerformanceTrace::Clock::now();
+                        round = de::computeProgressiveRound(view, selectionA, selectionB, sampleSizeA, sampleSizeB, roundOptions, plan, progressiveOptions, nullptr, &trace, transposedMatrix);
+                        const double roundSeconds = std::chrono::duration<double>(de::PerformanceTrace::Clock::now() - roundStart).count();
+
+                        std::cerr << "Round of " << round.sampleSizeA << " vs. " << round.sampleSizeB << " items: " << round.numStable() << " of " << round.result.numDimensions()
+                                  << " dimensions ranked stably, " << roundSeconds * 1000.0 << " ms\n";
+                    }
+                    return { std::move(round.result) };
+                }
+
+                return { de::computeDifferentialExpressionPlanned(view, selectionA, selectionB, options, plan, nullptr, &trace, transposedMatrix) };
+                });
+        }
+
+        // groups, selection pairs and streamed matrices are aggregated for all dimensions
+        if ((grouped || chunked) && !dimensions.empty())
+        {
+            for (de::DEResult& result : results)
+                result = de::restrictToDimensions(result, dimensions);
+        }
+
+        if (arguments.contains("--top"))
+        {
+            de::PerformanceTrace::Scope scope(&trace, "Top dimensions", "de");
+            const std::size_t k = std::stoul(argument("--top"));
+            for (de::DEResult& result : results)
+                result = de::selectRows(result, de::topRows(result, k));
+        }
+
+        const std::string separator = argument("--separator", ",");
+        {
+            de::PerformanceTrace::Scope scope(&trace, "Write result table", "io");
+            local::writeOutput(argument("--output"), [&](std::ostream& output) {
+                if (grouped)
+                    de::writeGroupedResultTable(output, results, groupNames, names, separator.front());
+                else
+                    de::writeResultTable(output, results.front(), names, separator.front());
+                });
+        }
+
+        if (arguments.contains("--timings"))
+            std::cerr << trace.summary() << "\n";
+
+        if (arguments.contains("--trace") && !trace.writeChromeTrace(argument("--trace")))
+            throw std::runtime_error("Cannot write trace to " + argument("--trace"));
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << "DifferentialExpressionCli: " << exception.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
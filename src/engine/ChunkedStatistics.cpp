@@ -0,0 +1,148 @@
+#include "ChunkedStatistics.h"
+
+#include "TaskPool.h"
+
+#include <algorithm>
+
+namespace de
+{
+
+namespace local
+{
+    constexpr std::size_t minimumBins = 8;
+
+    // floats of one DEResult per dimension, with all statistics and tests
+    constexpr std::uint64_t resultFloatsPerDimension = 16;
+
+    std::uint64_t fixedBytes(std::size_t numGroups, std::size_t numDimensions, std::size_t numResults, std::size_t numBins)
+    {
+        const std::uint64_t dimensions = numDimensions;
+
+        // the groups, plus all groups combined and the rest of one group for one-vs-rest statistics
+        const std::uint64_t aggregates = GroupAggregates::estimateBytes(numGroups, numDimensions, numBins) + 2 * GroupAggregates::estimateBytes(1, numDimensions, numBins);
+
+        // bin edges and widths, bin scales and thresholds, ranges with their per-thread partials
+        const std::uint64_t perDimension = dimensions * (6 * sizeof(float) + TaskPool::shared().numThreads() * (2 * sizeof(float) + sizeof(std::size_t)));
+
+        return aggregates + perDimension + numResults * dimensions * resultFloatsPerDimension * sizeof(float);
+    }
+}
+
+ChunkPlan planChunks(std::size_t numGroups, std::size_t numDimensions, std::size_t numResults, std::uint64_t memoryLimit, std::size_t maxBins)
+{
+    ChunkPlan plan;
+    plan.numBins = std::max<std::size_t>(1, maxBins);
+    plan.fixedBytes = local::fixedBytes(numGroups, numDimensions, numResults, plan.numBins);
+
+    while (plan.fixedBytes > memoryLimit / 2 && plan.numBins / 2 >= local::minimumBins)
+    {
+        plan.numBins /= 2;
+        plan.fixedBytes = local::fixedBytes(numGroups, numDimensions, numResults, plan.numBins);
+    }
+
+    plan.blockBytes = memoryLimit > plan.fixedBytes ? memoryLimit - plan.fixedBytes : 0;
+
+    return plan;
+}
+
+ChunkPlan planSingleChunk(std::size_t numGroups, std::size_t numDimensions, std::size_t numResults, std::size_t numRows, std::size_t numBins)
+{
+    ChunkPlan plan;
+    plan.numBins = std::max<std::size_t>(1, numBins);
+    plan.fixedBytes = local::fixedBytes(numGroups, numDimensions, numResults, plan.numBins);
+    plan.blockBytes = std::max<std::uint64_t>(1, numRows) * membershipBytesPerRow(numGroups);
+
+    return plan;
+}
+
+ChunkedAggregation::ChunkedAggregation(std::span<const RowIndices> selections, std::size_t numDimensions, const AggregationOptions& options) :
+    _selections(selections),
+    _options(options),
+    _aggregates(emptyGroupAggregates(selections.size(), numDimensions, options))
+{
+}
+
+template <typename Matrix>
+void ChunkedAggregation::addBlock(std::size_t firstRow, const Matrix& block)
+{
+    const GroupMembership membership = GroupMembership::fromSelections(firstRow, block.numRows, _selections);
+    accumulateGroups(block, membership, _options, _aggregates);
+}
+
+GroupAggregates ChunkedAggregation::finish()
+{
+    finishGroupAggregates(_aggregates, _options);
+    return std::move(_aggregates);
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionChunked(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, const ChunkPlan& plan, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const RowIndices selections[] = { selectionA, selectionB };
+
+    AggregationOptions aggregationOptions;
+    aggregationOptions.numBins              = plan.numBins;
+    aggregationOptions.minValues            = options.minValues;
+    aggregationOptions.rescaleValues        = options.rescaleValues;
+    aggregationOptions.expressedThreshold   = options.expressedThreshold;
+    aggregationOptions.normalizedThreshold  = options.normalize;
+
+    // the rows are in memory already, a block only needs its group membership
+    const std::size_t blockRows = std::max<std::uint64_t>(1, plan.blockBytes / membershipBytesPerRow(2));
+
+    // rows outside of both selections are skipped
+    std::size_t firstRow = matrix.numRows, lastRow = 0;
+    for (const RowIndices& selection : selections)
+    {
+        if (selection.empty())
+            continue;
+        firstRow = std::min<std::size_t>(firstRow, selection.front());
+        lastRow = std::max<std::size_t>(lastRow, selection.back() + 1);
+    }
+    lastRow = std::min(lastRow, matrix.numRows);
+
+    ChunkedAggregation aggregation(selections, matrix.numColumns, aggregationOptions);
+
+    {
+        PerformanceTrace::Scope scope(trace, "Chunked aggregation", "de", GroupAggregates::estimateBytes(2, matrix.numColumns, plan.numBins));
+
+        if (progress)
+            progress->advance(std::min(firstRow, matrix.numRows));
+
+        for (std::size_t row = firstRow; row < lastRow; row += blockRows)
+        {
+            if (progress && progress->canceled())
+                break;
+
+            const std::size_t numRows = std::min(blockRows, lastRow - row);
+            aggregation.addBlock(row, rowBlock(matrix, row, numRows));
+
+            if (progress)
+                progress->advance(numRows);
+        }
+
+        if (progress)
+            progress->advance(matrix.numRows - std::max(firstRow, lastRow));
+    }
+
+    const GroupAggregates aggregates = aggregation.finish();
+
+    PerformanceTrace::Scope scope(trace, "Statistics from aggregates", "de");
+    DEResult result = compareGroups(aggregates, 0, aggregates, 1, options);
+
+    // the blocks are aggregated for all columns, a subset is sliced from the result
+    if (!options.dimensions.empty())
+        result = restrictToDimensions(result, options.dimensions);
+
+    return result;
+}
+
+#define DE_INSTANTIATE_CHUNKED_STATISTICS(T)                                                                                                                                \
+    template void ChunkedAggregation::addBlock(std::size_t, const DenseMatrixView<T>&);                                                                                     \
+    template void ChunkedAggregation::addBlock(std::size_t, const SparseMatrixView<T>&);                                                                                    \
+    template DEResult computeDifferentialExpressionChunked(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, const ChunkPlan&, ProgressSink*, PerformanceTrace*);  \
+    template DEResult computeDifferentialExpressionChunked(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, const ChunkPlan&, ProgressSink*, PerformanceTrace*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_CHUNKED_STATISTICS)
+
+} // namespace de
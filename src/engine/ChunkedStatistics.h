@@ -0,0 +1,74 @@
+#pragma once
+
+#include "DifferentialExpression.h"
+#include "GroupStatistics.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+
+#include <cstdint>
+#include <span>
+
+namespace de
+{
+
+/*  Memory split of a chunked (out-of-core) run
+    The aggregates of all groups, the results and the per-dimension bookkeeping are allocated once,
+    rows are processed in blocks that take at most blockBytes, including their group membership.
+*/
+struct ChunkPlan
+{
+    std::size_t     numBins     = 0;    // histogram bins per group and dimension, the quantile sketch of the values
+    std::uint64_t   fixedBytes  = 0;
+    std::uint64_t   blockBytes  = 0;    // 0 if the limit leaves no room for rows
+
+    bool fits() const { return blockBytes > 0; }
+    std::uint64_t peakBytes() const { return fixedBytes + blockBytes; }
+};
+
+/** Bytes of group membership per row of a block, with the offsets used while building it */
+inline std::uint64_t membershipBytesPerRow(std::size_t numGroups)
+{
+    return 2 * sizeof(std::uint64_t) + numGroups * sizeof(std::uint32_t);
+}
+
+/*  Splits \p memoryLimit between the fixed allocations and one block of rows
+    The number of bins is halved, from \p maxBins down to 8, until the fixed part takes at most half of the limit.
+    \p numResults is the number of DEResults kept at the end, e.g. one per group for one-vs-rest statistics.
+*/
+ChunkPlan planChunks(std::size_t numGroups, std::size_t numDimensions, std::size_t numResults, std::uint64_t memoryLimit, std::size_t maxBins = 64);
+
+/** Plan of a single block covering all \p numRows rows, with \p numBins bins */
+ChunkPlan planSingleChunk(std::size_t numGroups, std::size_t numDimensions, std::size_t numResults, std::size_t numRows, std::size_t numBins = 64);
+
+/*  Aggregates sorted selections over blocks of rows, passed in increasing order of rows
+    The selections and options are referenced, not copied.
+*/
+class ChunkedAggregation
+{
+public:
+    ChunkedAggregation(std::span<const RowIndices> selections, std::size_t numDimensions, const AggregationOptions& options);
+
+    /** Adds rows firstRow ... firstRow + block.numRows - 1 */
+    template <typename Matrix>
+    void addBlock(std::size_t firstRow, const Matrix& block);
+
+    /** Aggregates of the blocks added so far, no blocks can be added afterwards */
+    GroupAggregates finish();
+
+private:
+    std::span<const RowIndices>     _selections;
+    AggregationOptions              _options;
+    GroupAggregates                 _aggregates;
+};
+
+/*  computeDifferentialExpression in bounded memory: rows are aggregated in blocks of \p plan
+    instead of gathering the selected values per dimension. options.minValues and rescaleValues are
+    required for the histograms. Medians, AUROC and rank-sum p-values are approximate, see compareGroups.
+    Progress is reported in rows of the matrix, in total matrix.numRows steps. With options.dimensions
+    all columns are still aggregated and the subset is taken from the result, see restrictToDimensions.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionChunked(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, const ChunkPlan& plan, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+} // namespace de
@@ -0,0 +1,1213 @@
+#include "DifferentialExpression.h"
+
+#include "StatisticalTests.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+namespace de
+{
+
+namespace local
+{
+    // rows handled per task while gathering, their cache lines stay hot while walking the columns
+    constexpr std::size_t gatherBlockRows = 32;
+
+    // The computed columns of a matrix: all of them, or the subset of DEOptions::dimensions
+    struct ColumnSubset
+    {
+        std::span<const std::uint32_t>  columns;        // empty for all columns
+        std::vector<std::int32_t>       positions;      // per column of the matrix its position in columns, -1 if left out; empty for all columns
+        std::size_t                     size = 0;
+
+        ColumnSubset(std::span<const std::uint32_t> subset, std::size_t numColumns) :
+            columns(subset),
+            size(subset.empty() ? numColumns : subset.size())
+        {
+            if (subset.empty())
+                return;
+
+            positions.assign(numColumns, -1);
+            for (std::size_t k = 0; k < subset.size(); ++k)
+                positions[subset[k]] = static_cast<std::int32_t>(k);
+        }
+
+        std::size_t column(std::size_t k) const { return columns.empty() ? k : columns[k]; }
+        std::ptrdiff_t position(std::size_t column) const { return positions.empty() ? static_cast<std::ptrdiff_t>(column) : positions[column]; }
+    };
+
+    // The rows of both selections merge-joined into one sorted list, so a row in both is read once for both
+    struct SelectionUnion
+    {
+        std::vector<std::uint32_t>  rows;
+        std::vector<std::int32_t>   positionA;      // per row its position in selection A, -1 if it is not in A
+        std::vector<std::int32_t>   positionB;
+        std::size_t                 sizeA = 0;
+        std::size_t                 sizeB = 0;
+
+        SelectionUnion(RowIndices selectionA, RowIndices selectionB) :
+            sizeA(selectionA.size()),
+            sizeB(selectionB.size())
+        {
+            rows.reserve(sizeA + sizeB);
+            positionA.reserve(sizeA + sizeB);
+            positionB.reserve(sizeA + sizeB);
+
+            std::size_t a = 0, b = 0;
+            while (a < sizeA || b < sizeB)
+            {
+                const bool inA = a < sizeA && (b == sizeB || selectionA[a] <= selectionB[b]);
+                const bool inB = b < sizeB && (a == sizeA || selectionB[b] <= selectionA[a]);
+
+                rows.push_back(inA ? selectionA[a] : selectionB[b]);
+                positionA.push_back(inA ? static_cast<std::int32_t>(a++) : -1);
+                positionB.push_back(inB ? static_cast<std::int32_t>(b++) : -1);
+            }
+        }
+
+        std::size_t size() const { return rows.size(); }
+
+        // selected rows among rows first ... last - 1, counting a row in both selections twice
+        std::size_t memberships(std::size_t first, std::size_t last) const
+        {
+            std::size_t count = 0;
+            for (std::size_t i = first; i < last; ++i)
+                count += (positionA[i] >= 0) + (positionB[i] >= 0);
+            return count;
+        }
+    };
+
+    // Transposes the rows of both selections into one contiguous buffer per computed column and selection:
+    // valuesA[k * rows.sizeA + i] for the i-th row of A. Every row of the union is loaded once, a row in both
+    // selections is copied to both from the same cache lines. The values keep their storage type, narrow
+    // types are copied without widening them to float.
+    template <typename T>
+    void gatherColumns(const DenseMatrixView<T>& matrix, const SelectionUnion& rows, const ColumnSubset& subset, T* valuesA, T* valuesB, ProgressSink* progress)
+    {
+        const std::size_t numRows = rows.size();
+        const std::size_t numColumns = subset.size;
+        const std::size_t numBlocks = (numRows + gatherBlockRows - 1) / gatherBlockRows;
+
+        TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            const std::size_t first = block * gatherBlockRows;
+            const std::size_t last = std::min(first + gatherBlockRows, numRows);
+
+            // the rows of each selection within the block have consecutive positions in it
+            const T* rowData[gatherBlockRows];
+            std::uint8_t rowsA[gatherBlockRows], rowsB[gatherBlockRows];
+            std::size_t numA = 0, numB = 0, firstA = 0, firstB = 0;
+            for (std::size_t i = first; i < last; ++i)
+            {
+                rowData[i - first] = matrix.row(rows.rows[i]);
+                if (rows.positionA[i] >= 0)
+                {
+                    if (numA == 0)
+                        firstA = rows.positionA[i];
+                    rowsA[numA++] = static_cast<std::uint8_t>(i - first);
+                }
+                if (rows.positionB[i] >= 0)
+                {
+                    if (numB == 0)
+                        firstB = rows.positionB[i];
+                    rowsB[numB++] = static_cast<std::uint8_t>(i - first);
+                }
+            }
+
+            for (std::size_t k = 0; k < numColumns; ++k)
+            {
+                const std::size_t column = subset.column(k);
+                T* columnA = valuesA + k * rows.sizeA + firstA;
+                T* columnB = valuesB + k * rows.sizeB + firstB;
+                for (std::size_t j = 0; j < numA; ++j)
+                    columnA[j] = rowData[rowsA[j]][column];
+                for (std::size_t j = 0; j < numB; ++j)
+                    columnB[j] = rowData[rowsB[j]][column];
+            }
+
+            if (progress)
+                progress->advance(numA + numB);
+            });
+    }
+
+    // valuesA and valuesB must be zero-initialized, only the stored elements are scattered
+    template <typename T>
+    void gatherColumns(const SparseMatrixView<T>& matrix, const SelectionUnion& rows, const ColumnSubset& subset, T* valuesA, T* valuesB, ProgressSink* progress)
+    {
+        const std::size_t numRows = rows.size();
+        const std::size_t numBlocks = (numRows + gatherBlockRows - 1) / gatherBlockRows;
+
+        TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            const std::size_t first = block * gatherBlockRows;
+            const std::size_t last = std::min(first + gatherBlockRows, numRows);
+
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const std::uint32_t row = rows.rows[i];
+                const std::int32_t positionA = rows.positionA[i];
+                const std::int32_t positionB = rows.positionB[i];
+                for (std::uint64_t k = matrix.rowOffsets[row]; k < matrix.rowOffsets[row + 1]; ++k)
+                {
+                    const std::ptrdiff_t position = subset.position(matrix.columnIndices[k]);
+                    if (position < 0)
+                        continue;
+
+                    if (positionA >= 0)
+                        valuesA[static_cast<std::size_t>(position) * rows.sizeA + positionA] = matrix.values[k];
+                    if (positionB >= 0)
+                        valuesB[static_cast<std::size_t>(position) * rows.sizeB + positionB] = matrix.values[k];
+                }
+            }
+
+            if (progress)
+                progress->advance(rows.memberships(first, last));
+            });
+    }
+
+    // Sums of integer values are exact in 64 bits, the others are summed in double
+    template <typename T>
+    using SumType = std::conditional_t<std::is_integral_v<T>, std::int64_t, double>;
+
+    template <typename T>
+    double sum(const T* values, std::size_t size)
+    {
+        SumType<T> sum = 0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if constexpr (std::is_integral_v<T>)
+                sum += values[i];
+            else
+                sum += static_cast<float>(values[i]);
+        }
+        return static_cast<double>(sum);
+    }
+
+    template <typename T>
+    float mean(const T* values, std::size_t size)
+    {
+        return static_cast<float>(sum(values, size) / size);
+    }
+
+    // reorders values
+    template <typename T>
+    float median(T* values, std::size_t size)
+    {
+        std::nth_element(values, values + size / 2, values + size);
+        return static_cast<float>(values[size / 2]);
+    }
+
+    // sample standard deviation
+    template <typename T>
+    float standardDeviation(const T* values, std::size_t size, float mean)
+    {
+        if (size < 2)
+            return 0.0f;
+
+        double sum = 0.0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            const double diff = static_cast<float>(values[i]) - mean;
+            sum += diff * diff;
+        }
+        return static_cast<float>(std::sqrt(sum / (size - 1.0)));
+    }
+
+    template <typename T>
+    float percentExpressed(const T* values, std::size_t size, float threshold, float minValue, float rescaleValue)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < size; ++i)
+            if ((static_cast<float>(values[i]) - minValue) * rescaleValue > threshold)
+                ++count;
+        return 100.0f * count / static_cast<float>(size);
+    }
+
+    bool canceled(const ProgressSink* progress)
+    {
+        return progress && progress->canceled();
+    }
+
+    // Forwards the progress of a kernel that redoes work whose first steps were already reported, e.g. by a kernel
+    // that fell back to it; those steps are dropped, so the total stays that of one run
+    class ReportedProgress : public ProgressSink
+    {
+    public:
+        ReportedProgress(ProgressSink* progress, std::uint64_t reported) : _progress(progress), _reported(reported) {}
+
+        void advance(std::uint64_t steps) override
+        {
+            const std::uint64_t previous = _done.fetch_add(steps, std::memory_order_relaxed);
+            if (previous + steps > _reported)
+                _progress->advance(previous + steps - std::max(previous, _reported));
+        }
+
+        bool canceled() const override { return _progress->canceled(); }
+
+    private:
+        ProgressSink*               _progress;
+        std::uint64_t               _reported;
+        std::atomic<std::uint64_t>  _done = 0;
+    };
+
+    DEResult emptyResult(std::size_t numDimensions, const DEOptions& options)
+    {
+        DEResult result;
+        result.dimensions.assign(options.dimensions.begin(), options.dimensions.end());
+        result.meanA.assign(numDimensions, 0.0f);
+        result.meanB.assign(numDimensions, 0.0f);
+        if (options.medians)
+        {
+            result.medianA.assign(numDimensions, 0.0f);
+            result.medianB.assign(numDimensions, 0.0f);
+        }
+        if (options.additionalStatistics)
+        {
+            result.sdA.assign(numDimensions, 0.0f);
+            result.sdB.assign(numDimensions, 0.0f);
+            result.pctExpressedA.assign(numDimensions, 0.0f);
+            result.pctExpressedB.assign(numDimensions, 0.0f);
+        }
+        if (options.statisticalTests)
+        {
+            result.welchT.assign(numDimensions, 0.0f);
+            result.welchP.assign(numDimensions, 1.0f);
+            result.auroc.assign(numDimensions, 0.5f);
+            result.wilcoxonP.assign(numDimensions, 1.0f);
+        }
+        return result;
+    }
+
+    void normalizeResult(DEResult& result, const DEOptions& options)
+    {
+        for (std::size_t d = 0; d < result.numDimensions(); d++)
+        {
+            const float minValue = options.minValues[result.dimension(d)];
+            const float rescaleValue = options.rescaleValues[result.dimension(d)];
+
+            result.meanA[d] = (result.meanA[d] - minValue) * rescaleValue;
+            result.meanB[d] = (result.meanB[d] - minValue) * rescaleValue;
+
+            if (result.hasMedians())
+            {
+                result.medianA[d] = (result.medianA[d] - minValue) * rescaleValue;
+                result.medianB[d] = (result.medianB[d] - minValue) * rescaleValue;
+            }
+
+            if (result.hasAdditionalStatistics())
+            {
+                result.sdA[d] *= rescaleValue;
+                result.sdB[d] *= rescaleValue;
+            }
+        }
+    }
+
+    // columns per task of the non-zero gathering, see aggregateGroups
+    constexpr std::size_t minimumBlockColumns = 64;
+
+    // Non-zero values of the selected rows per computed column (compressed sparse columns) in their storage type, the zeros are implicit
+    template <typename T>
+    struct NonZeroColumns
+    {
+        std::size_t                 numRows = 0;
+        std::vector<std::uint64_t>  offsets;    // subset.size + 1 entries
+        std::span<T>                values;     // from the scratch arena or ownedValues
+        std::vector<T>              ownedValues;
+
+        T* column(std::size_t d) { return values.data() + offsets[d]; }
+        std::size_t numNonZeros(std::size_t d) const { return static_cast<std::size_t>(offsets[d + 1] - offsets[d]); }
+    };
+
+    // Calls visit(i, k, value) for the non-zero values of the computed columns first ... last - 1 of rows, row by row; i is the index into rows
+    template <typename T, typename Visit>
+    void visitNonZeros(const DenseMatrixView<T>& matrix, RowIndices rows, const ColumnSubset& subset, std::size_t first, std::size_t last, Visit visit)
+    {
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            const T* rowData = matrix.row(rows[i]);
+            for (std::size_t k = first; k < last; ++k)
+            {
+                const T value = rowData[subset.column(k)];
+                if (static_cast<float>(value) != 0.0f)
+                    visit(i, k, value);
+            }
+        }
+    }
+
+    template <typename T, typename Visit>
+    void visitNonZeros(const SparseMatrixView<T>& matrix, RowIndices rows, const ColumnSubset& subset, std::size_t first, std::size_t last, Visit visit)
+    {
+        const std::size_t lastColumn = subset.column(last - 1);
+
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            const std::uint32_t row = rows[i];
+            const std::uint32_t* columnsEnd = matrix.columnIndices + matrix.rowOffsets[row + 1];
+            const std::uint32_t* columns = std::lower_bound(matrix.columnIndices + matrix.rowOffsets[row], columnsEnd, static_cast<std::uint32_t>(subset.column(first)));
+
+            for (; columns != columnsEnd && *columns <= lastColumn; ++columns)
+            {
+                const std::ptrdiff_t position = subset.position(*columns);
+                const T value = matrix.values[columns - matrix.columnIndices];
+                if (position >= 0 && static_cast<float>(value) != 0.0f)
+                    visit(i, static_cast<std::size_t>(position), value);
+            }
+        }
+    }
+
+    // Counts, then fills the non-zeros per computed column of both selections, visiting each row of the union once per pass;
+    // threads own blocks of columns. Progress is reported in columns of both selections.
+    template <typename Matrix>
+    void gatherNonZeroColumns(const Matrix& matrix, const SelectionUnion& rows, const ColumnSubset& subset, NonZeroColumns<typename Matrix::value_type>& columnsA, NonZeroColumns<typename Matrix::value_type>& columnsB, ScratchArena* scratch, ProgressSink* progress)
+    {
+        using T = typename Matrix::value_type;
+
+        const std::size_t numColumns = subset.size;
+        const std::size_t blockColumns = std::max(minimumBlockColumns, (numColumns + 4 * TaskPool::shared().concurrency() - 1) / (4 * TaskPool::shared().concurrency()));
+        const std::size_t numBlocks = (numColumns + blockColumns - 1) / blockColumns;
+
+        columnsA.numRows = rows.sizeA;
+        columnsB.numRows = rows.sizeB;
+        columnsA.offsets.assign(numColumns + 1, 0);
+        columnsB.offsets.assign(numColumns + 1, 0);
+
+        TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            const std::size_t first = block * blockColumns;
+            visitNonZeros(matrix, rows.rows, subset, first, std::min(first + blockColumns, numColumns), [&rows, &columnsA, &columnsB](std::size_t i, std::size_t column, T)
+                {
+                    columnsA.offsets[column + 1] += rows.positionA[i] >= 0;
+                    columnsB.offsets[column + 1] += rows.positionB[i] >= 0;
+                });
+            });
+
+        for (std::size_t column = 0; column < numColumns; ++column)
+        {
+            columnsA.offsets[column + 1] += columnsA.offsets[column];
+            columnsB.offsets[column + 1] += columnsB.offsets[column];
+        }
+
+        columnsA.values = scratchBuffer(scratch, columnsA.ownedValues, columnsA.offsets[numColumns]);
+        columnsB.values = scratchBuffer(scratch, columnsB.ownedValues, columnsB.offsets[numColumns]);
+
+        TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            const std::size_t first = block * blockColumns;
+            const std::size_t last = std::min(first + blockColumns, numColumns);
+
+            std::vector<std::uint64_t> nextA(columnsA.offsets.begin() + first, columnsA.offsets.begin() + last);
+            std::vector<std::uint64_t> nextB(columnsB.offsets.begin() + first, columnsB.offsets.begin() + last);
+            visitNonZeros(matrix, rows.rows, subset, first, last, [&](std::size_t i, std::size_t column, T value)
+                {
+                    if (rows.positionA[i] >= 0)
+                        columnsA.values[nextA[column - first]++] = value;
+                    if (rows.positionB[i] >= 0)
+                        columnsB.values[nextB[column - first]++] = value;
+                });
+
+            if (progress)
+                progress->advance(2 * (last - first));
+            });
+    }
+
+    // k-th smallest (from 0) of the values and \p zeros implicit zeros, reorders the values
+    template <typename T>
+    float orderStatistic(T* values, std::size_t numNonZeros, std::size_t zeros, std::size_t k)
+    {
+        T* negativeEnd = std::partition(values, values + numNonZeros, [](T value) { return static_cast<float>(value) < 0.0f; });
+        const std::size_t negatives = negativeEnd - values;
+
+        if (k < negatives)
+        {
+            std::nth_element(values, values + k, negativeEnd);
+            return static_cast<float>(values[k]);
+        }
+        if (k < negatives + zeros)
+            return 0.0f;
+
+        k -= negatives + zeros;
+        std::nth_element(negativeEnd, negativeEnd + k, values + numNonZeros);
+        return static_cast<float>(negativeEnd[k]);
+    }
+
+    // sample standard deviation, the zeros each contribute mean^2
+    template <typename T>
+    float standardDeviationNonZero(const T* values, std::size_t numNonZeros, std::size_t size, float mean)
+    {
+        if (size < 2)
+            return 0.0f;
+
+        double sum = static_cast<double>(size - numNonZeros) * mean * mean;
+        for (std::size_t i = 0; i < numNonZeros; ++i)
+        {
+            const double diff = static_cast<float>(values[i]) - mean;
+            sum += diff * diff;
+        }
+        return static_cast<float>(std::sqrt(sum / (size - 1.0)));
+    }
+
+    template <typename T>
+    float percentExpressedNonZero(const T* values, std::size_t numNonZeros, std::size_t size, float threshold, float minValue, float rescaleValue)
+    {
+        std::size_t count = (0.0f - minValue) * rescaleValue > threshold ? size - numNonZeros : 0;
+        for (std::size_t i = 0; i < numNonZeros; ++i)
+            if ((static_cast<float>(values[i]) - minValue) * rescaleValue > threshold)
+                ++count;
+        return 100.0f * count / static_cast<float>(size);
+    }
+
+    // One bin per integer value of every computed column, from the minimum to the maximum of the column
+    struct CountHistograms
+    {
+        std::vector<std::uint64_t>  offsets;            // subset.size + 1 entries
+        std::vector<std::int64_t>   minimum;            // value of the first bin per column
+        std::span<std::uint32_t>    counts;             // from the scratch arena or ownedCounts
+        std::vector<std::uint32_t>  ownedCounts;
+        bool                        valid = true;       // every value was a whole number within the bins of its column
+
+        const std::uint32_t* column(std::size_t d) const { return counts.data() + offsets[d]; }
+        std::size_t numBins(std::size_t d) const { return static_cast<std::size_t>(offsets[d + 1] - offsets[d]); }
+    };
+
+    // The bins of the columns, without counts; empty offsets if a column is not integer-valued or too wide
+    CountHistograms countBins(const DEOptions& options, const ColumnSubset& subset)
+    {
+        CountHistograms histograms;
+
+        if (options.integralDimensions.empty() || options.minValues.empty() || options.maxValues.empty())
+            return histograms;
+
+        histograms.offsets.assign(subset.size + 1, 0);
+        histograms.minimum.resize(subset.size);
+
+        for (std::size_t d = 0; d < subset.size; ++d)
+        {
+            const std::size_t column = subset.column(d);
+            const double minValue = options.minValues[column];
+            const double maxValue = options.maxValues[column];
+
+            if (!options.integralDimensions[column] || !(maxValue - minValue < maxCountBins))
+                return {};
+
+            histograms.minimum[d] = static_cast<std::int64_t>(minValue);
+            histograms.offsets[d + 1] = histograms.offsets[d] + static_cast<std::uint64_t>(maxValue - minValue) + 1;
+        }
+
+        return histograms;
+    }
+
+    // The zeros of a column are all values that were not counted; false if the range has no bin for zero
+    bool addZeros(CountHistograms& histograms, std::size_t d, std::size_t numRows)
+    {
+        std::uint32_t* counts = histograms.counts.data() + histograms.offsets[d];
+        std::uint64_t numNonZeros = 0;
+        for (std::size_t bin = 0; bin < histograms.numBins(d); ++bin)
+            numNonZeros += counts[bin];
+
+        if (numNonZeros == numRows)
+            return true;
+
+        const std::int64_t zeroBin = -histograms.minimum[d];
+        if (zeroBin < 0 || static_cast<std::uint64_t>(zeroBin) >= histograms.numBins(d))
+            return false;
+
+        counts[zeroBin] += static_cast<std::uint32_t>(numRows - numNonZeros);
+        return true;
+    }
+
+    // Counts the values of both selections per column block, from one visit of each row of the union;
+    // the implicit and skipped zeros are added per column afterwards
+    template <typename Matrix>
+    void countValues(const Matrix& matrix, const SelectionUnion& rows, const ColumnSubset& subset, CountHistograms& histogramsA, CountHistograms& histogramsB, ScratchArena* scratch, ProgressSink* progress)
+    {
+        using T = typename Matrix::value_type;
+
+        const std::size_t numColumns = subset.size;
+        const std::size_t blockColumns = std::max(minimumBlockColumns, (numColumns + 4 * TaskPool::shared().concurrency() - 1) / (4 * TaskPool::shared().concurrency()));
+        const std::size_t numBlocks = (numColumns + blockColumns - 1) / blockColumns;
+
+        // both have the bins of countBins
+        const CountHistograms& histograms = histogramsA;
+        histogramsA.counts = scratchBuffer(scratch, histogramsA.ownedCounts, histograms.offsets.back());
+        histogramsB.counts = scratchBuffer(scratch, histogramsB.ownedCounts, histograms.offsets.back());
+        std::fill(histogramsA.counts.begin(), histogramsA.counts.end(), 0u);
+        std::fill(histogramsB.counts.begin(), histogramsB.counts.end(), 0u);
+        std::vector<std::uint8_t> blockValid(numBlocks, 1);
+
+        TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+            const std::size_t first = block * blockColumns;
+            const std::size_t last = std::min(first + blockColumns, numColumns);
+
+            std::uint8_t valid = 1;
+            visitNonZeros(matrix, rows.rows, subset, first, last, [&](std::size_t i, std::size_t d, T value)
+                {
+                    std::int64_t bin;
+                    if constexpr (std::is_integral_v<T>)
+                    {
+                        bin = static_cast<std::int64_t>(value) - histograms.minimum[d];
+                    }
+                    else
+                    {
+                        const float offset = static_cast<float>(value) - static_cast<float>(histograms.minimum[d]);
+                        if (!(offset >= 0.0f && offset < static_cast<float>(maxCountBins)) || offset != std::trunc(offset))
+                        {
+                            valid = 0;
+                            return;
+                        }
+                        bin = static_cast<std::int64_t>(offset);
+                    }
+
+                    if (static_cast<std::uint64_t>(bin) >= histograms.numBins(d))
+                    {
+                        valid = 0;
+                        return;
+                    }
+
+                    const std::uint64_t index = histograms.offsets[d] + bin;
+                    histogramsA.counts[index] += rows.positionA[i] >= 0;
+                    histogramsB.counts[index] += rows.positionB[i] >= 0;
+                });
+
+            for (std::size_t d = first; d < last; ++d)
+                if (!addZeros(histogramsA, d, rows.sizeA) || !addZeros(histogramsB, d, rows.sizeB))
+                    valid = 0;
+
+            blockValid[block] = valid;
+
+            if (progress)
+                progress->advance(2 * (last - first));
+            });
+
+        histogramsA.valid = histogramsB.valid = std::all_of(blockValid.begin(), blockValid.end(), [](std::uint8_t valid) { return valid != 0; });
+    }
+
+    double countSum(const std::uint32_t* counts, std::size_t numBins, std::int64_t minimum)
+    {
+        std::int64_t sum = 0;
+        for (std::size_t bin = 0; bin < numBins; ++bin)
+            sum += static_cast<std::int64_t>(counts[bin]) * (minimum + static_cast<std::int64_t>(bin));
+        return static_cast<double>(sum);
+    }
+
+    // k-th smallest (from 0) of the counted values
+    float countOrderStatistic(const std::uint32_t* counts, std::size_t numBins, std::int64_t minimum, std::size_t k)
+    {
+        std::size_t cumulative = 0;
+        for (std::size_t bin = 0; bin < numBins; ++bin)
+        {
+            cumulative += counts[bin];
+            if (cumulative > k)
+                return static_cast<float>(minimum + static_cast<std::int64_t>(bin));
+        }
+        return static_cast<float>(minimum + static_cast<std::int64_t>(numBins) - 1);
+    }
+
+    // sample standard deviation
+    float countStandardDeviation(const std::uint32_t* counts, std::size_t numBins, std::int64_t minimum, std::size_t size, float mean)
+    {
+        if (size < 2)
+            return 0.0f;
+
+        double sum = 0.0;
+        for (std::size_t bin = 0; bin < numBins; ++bin)
+        {
+            if (counts[bin] == 0)
+                continue;
+
+            const double diff = static_cast<float>(minimum + static_cast<std::int64_t>(bin)) - mean;
+            sum += counts[bin] * diff * diff;
+        }
+        return static_cast<float>(std::sqrt(sum / (size - 1.0)));
+    }
+
+    float countPercentExpressed(const std::uint32_t* counts, std::size_t numBins, std::int64_t minimum, std::size_t size, float threshold, float minValue, float rescaleValue)
+    {
+        std::size_t count = 0;
+        for (std::size_t bin = 0; bin < numBins; ++bin)
+            if ((static_cast<float>(minimum + static_cast<std::int64_t>(bin)) - minValue) * rescaleValue > threshold)
+                count += counts[bin];
+        return 100.0f * count / static_cast<float>(size);
+    }
+
+    // both selections share the bins of a column, so their values are merged in order bin by bin
+    RankSumTestResult countRankSumTest(const std::uint32_t* countsA, const std::uint32_t* countsB, std::size_t numBins, std::size_t sizeA, std::size_t sizeB)
+    {
+        RankSumAccumulator accumulator;
+        for (std::size_t bin = 0; bin < numBins; ++bin)
+            if (countsA[bin] + countsB[bin] > 0)
+                accumulator.addTieGroup(countsA[bin], countsB[bin]);
+        return accumulator.result(sizeA, sizeB);
+    }
+
+    // All statistics of row d of result from the non-zeros of both selections, reorders the non-zeros
+    template <typename T>
+    void nonZeroStatistics(T* columnA, std::size_t nonZeroA, std::size_t sizeA, T* columnB, std::size_t nonZeroB, std::size_t sizeB, std::size_t d, const ColumnSubset& subset, const DEOptions& options, DEResult& result)
+    {
+        // the zeros add nothing to the sums
+        result.meanA[d] = static_cast<float>(sum(columnA, nonZeroA) / sizeA);
+        result.meanB[d] = static_cast<float>(sum(columnB, nonZeroB) / sizeB);
+
+        const float sdA = standardDeviationNonZero(columnA, nonZeroA, sizeA, result.meanA[d]);
+        const float sdB = standardDeviationNonZero(columnB, nonZeroB, sizeB, result.meanB[d]);
+
+        if (options.additionalStatistics)
+        {
+            // the threshold applies to the normalized values if normalization is enabled
+            const float minValue = options.normalize ? options.minValues[subset.column(d)] : 0.0f;
+            const float rescaleValue = options.normalize ? options.rescaleValues[subset.column(d)] : 1.0f;
+
+            result.sdA[d] = sdA;
+            result.sdB[d] = sdB;
+            result.pctExpressedA[d] = percentExpressedNonZero(columnA, nonZeroA, sizeA, options.expressedThreshold, minValue, rescaleValue);
+            result.pctExpressedB[d] = percentExpressedNonZero(columnB, nonZeroB, sizeB, options.expressedThreshold, minValue, rescaleValue);
+        }
+
+        if (options.medians)
+        {
+            result.medianA[d] = orderStatistic(columnA, nonZeroA, sizeA - nonZeroA, sizeA / 2);
+            result.medianB[d] = orderStatistic(columnB, nonZeroB, sizeB - nonZeroB, sizeB / 2);
+        }
+
+        // sorts the non-zeros, after the medians
+        if (options.statisticalTests)
+        {
+            const WelchTestResult welch = welchTTest(result.meanA[d], double(sdA) * sdA, sizeA, result.meanB[d], double(sdB) * sdB, sizeB);
+            result.welchT[d] = welch.t;
+            result.welchP[d] = welch.p;
+
+            const RankSumTestResult rankSum = rankSumTestNonZero(columnA, nonZeroA, sizeA, columnB, nonZeroB, sizeB);
+            result.auroc[d] = rankSum.auroc;
+            result.wilcoxonP[d] = rankSum.p;
+        }
+    }
+
+    // values[rows[i]] for every i, empty if values is
+    template <typename T>
+    std::vector<T> selectValues(const std::vector<T>& values, std::span<const std::uint32_t> rows)
+    {
+        std::vector<T> selected;
+        if (values.empty())
+            return selected;
+
+        selected.reserve(rows.size());
+        for (const std::uint32_t row : rows)
+            selected.push_back(values[row]);
+        return selected;
+    }
+}
+
+std::size_t countOverlap(RowIndices selectionA, RowIndices selectionB)
+{
+    std::size_t overlap = 0;
+    for (std::size_t a = 0, b = 0; a < selectionA.size() && b < selectionB.size();)
+    {
+        if (selectionA[a] < selectionB[b])
+            ++a;
+        else if (selectionB[b] < selectionA[a])
+            ++b;
+        else
+        {
+            ++overlap;
+            ++a;
+            ++b;
+        }
+    }
+    return overlap;
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpression(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const local::ColumnSubset subset(options.dimensions, matrix.numColumns);
+    const std::size_t numDimensions = subset.size;
+    const std::size_t sizeA = selectionA.size();
+    const std::size_t sizeB = selectionB.size();
+
+    DEResult result = local::emptyResult(numDimensions, options);
+
+    if (sizeA == 0 || sizeB == 0 || numDimensions == 0)
+        return result;
+
+    // the copies keep the storage type, their size shrinks with its width
+    using T = typename Matrix::value_type;
+
+    // bytes of the per-dimension value copies, read or written by most phases below
+    const std::uint64_t valueCopyBytes = static_cast<std::uint64_t>(numDimensions) * (sizeA + sizeB) * sizeof(T);
+
+    // from the scratch arena the buffers are reused, only a sparse matrix needs them zeroed
+    const ScratchArena::Frame frame(options.scratch);
+    std::vector<T> ownedA, ownedB;
+    std::span<T> valuesA, valuesB;
+    {
+        PerformanceTrace::Scope scope(trace, "Allocate buffers", "de", valueCopyBytes);
+        valuesA = scratchBuffer(options.scratch, ownedA, numDimensions * sizeA);
+        valuesB = scratchBuffer(options.scratch, ownedB, numDimensions * sizeB);
+        if (isSparseMatrix<Matrix> && options.scratch)
+        {
+            std::fill(valuesA.begin(), valuesA.end(), T());
+            std::fill(valuesB.begin(), valuesB.end(), T());
+        }
+    }
+
+    {
+        PerformanceTrace::Scope scope(trace, "Gather both selections", "de", valueCopyBytes);
+        const local::SelectionUnion rows(selectionA, selectionB);
+        local::gatherColumns(matrix, rows, subset, valuesA.data(), valuesB.data(), progress);
+    }
+
+    if (local::canceled(progress))
+        return result;
+
+    {
+        PerformanceTrace::Scope scope(trace, options.medians ? "Means and medians (nth_element)" : "Means", "de", valueCopyBytes);
+
+        TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+            T* columnA = valuesA.data() + d * sizeA;
+            T* columnB = valuesB.data() + d * sizeB;
+
+            result.meanA[d] = local::mean(columnA, sizeA);
+            result.meanB[d] = local::mean(columnB, sizeB);
+            if (options.medians)
+            {
+                result.medianA[d] = local::median(columnA, sizeA);
+                result.medianB[d] = local::median(columnB, sizeB);
+            }
+
+            if (progress)
+                progress->advance(1);
+            });
+    }
+
+    if (options.additionalStatistics)
+    {
+        PerformanceTrace::Scope scope(trace, "SD and % expressed", "de", valueCopyBytes);
+
+        TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+            const T* columnA = valuesA.data() + d * sizeA;
+            const T* columnB = valuesB.data() + d * sizeB;
+
+            // the threshold applies to the normalized values if normalization is enabled
+            const float minValue = options.normalize ? options.minValues[subset.column(d)] : 0.0f;
+            const float rescaleValue = options.normalize ? options.rescaleValues[subset.column(d)] : 1.0f;
+
+            result.sdA[d] = local::standardDeviation(columnA, sizeA, result.meanA[d]);
+            result.sdB[d] = local::standardDeviation(columnB, sizeB, result.meanB[d]);
+            result.pctExpressedA[d] = local::percentExpressed(columnA, sizeA, options.expressedThreshold, minValue, rescaleValue);
+            result.pctExpressedB[d] = local::percentExpressed(columnB, sizeB, options.expressedThreshold, minValue, rescaleValue);
+            });
+    }
+
+    if (options.statisticalTests)
+    {
+        PerformanceTrace::Scope scope(trace, "Statistical tests (rank sum, Welch)", "de", valueCopyBytes);
+
+        // sorts the buffers, the medians are done with them
+        TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+            T* columnA = valuesA.data() + d * sizeA;
+            T* columnB = valuesB.data() + d * sizeB;
+
+            const float sdA = options.additionalStatistics ? result.sdA[d] : local::standardDeviation(columnA, sizeA, result.meanA[d]);
+            const float sdB = options.additionalStatistics ? result.sdB[d] : local::standardDeviation(columnB, sizeB, result.meanB[d]);
+
+            const WelchTestResult welch = welchTTest(result.meanA[d], double(sdA) * sdA, sizeA, result.meanB[d], double(sdB) * sdB, sizeB);
+            result.welchT[d] = welch.t;
+            result.welchP[d] = welch.p;
+
+            const RankSumTestResult rankSum = rankSumTest(columnA, sizeA, columnB, sizeB);
+            result.auroc[d] = rankSum.auroc;
+            result.wilcoxonP[d] = rankSum.p;
+
+            if (progress)
+                progress->advance(1);
+            });
+
+        result.welchAdjustedP = adjustBenjaminiHochberg(result.welchP);
+        result.wilcoxonAdjustedP = adjustBenjaminiHochberg(result.wilcoxonP);
+    }
+
+    if (options.normalize)
+    {
+        PerformanceTrace::Scope scope(trace, "Normalization", "de");
+        local::normalizeResult(result, options);
+    }
+
+    return result;
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionSparse(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const local::ColumnSubset subset(options.dimensions, matrix.numColumns);
+    const std::size_t numDimensions = subset.size;
+    const std::size_t sizeA = selectionA.size();
+    const std::size_t sizeB = selectionB.size();
+
+    DEResult result = local::emptyResult(numDimensions, options);
+
+    if (sizeA == 0 || sizeB == 0 || numDimensions == 0)
+        return result;
+
+    using T = typename Matrix::value_type;
+
+    const ScratchArena::Frame frame(options.scratch);
+    local::NonZeroColumns<T> columnsA, columnsB;
+    {
+        PerformanceTrace::Scope scope(trace, "Gather non-zeros", "de");
+        const local::SelectionUnion rows(selectionA, selectionB);
+        local::gatherNonZeroColumns(matrix, rows, subset, columnsA, columnsB, options.scratch, progress);
+        scope.addBytes((columnsA.values.size() + columnsB.values.size()) * sizeof(T));
+    }
+
+    if (local::canceled(progress))
+        return result;
+
+    {
+        PerformanceTrace::Scope scope(trace, "Statistics of non-zeros", "de", (columnsA.values.size() + columnsB.values.size()) * sizeof(T));
+
+        TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+            local::nonZeroStatistics(columnsA.column(d), columnsA.numNonZeros(d), sizeA, columnsB.column(d), columnsB.numNonZeros(d), sizeB, d, subset, options, result);
+
+            if (progress)
+                progress->advance(1);
+            });
+    }
+
+    if (options.statisticalTests)
+    {
+        result.welchAdjustedP = adjustBenjaminiHochberg(result.welchP);
+        result.wilcoxonAdjustedP = adjustBenjaminiHochberg(result.wilcoxonP);
+    }
+
+    if (options.normalize)
+    {
+        PerformanceTrace::Scope scope(trace, "Normalization", "de");
+        local::normalizeResult(result, options);
+    }
+
+    return result;
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionTransposed(const Matrix& transposed, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const local::ColumnSubset subset(options.dimensions, transposed.numRows);
+    const std::size_t numDimensions = subset.size;
+    const std::size_t sizeA = selectionA.size();
+    const std::size_t sizeB = selectionB.size();
+
+    DEResult result = local::emptyResult(numDimensions, options);
+
+    if (sizeA == 0 || sizeB == 0 || numDimensions == 0)
+        return result;
+
+    using T = typename Matrix::value_type;
+
+    // the columns of a sparse copy list their rows, which are looked up here: 1 for A, 2 for B, 3 for both
+    std::vector<std::uint8_t> membership;
+    if constexpr (isSparseMatrix<Matrix>)
+    {
+        PerformanceTrace::Scope scope(trace, "Selection membership", "de", transposed.numColumns);
+        membership.assign(transposed.numColumns, 0);
+        for (const std::uint32_t row : selectionA)
+            membership[row] |= 1;
+        for (const std::uint32_t row : selectionB)
+            membership[row] |= 2;
+    }
+
+    {
+        PerformanceTrace::Scope scope(trace, "Statistics of dimension-major rows", "de", static_cast<std::uint64_t>(numDimensions) * (sizeA + sizeB) * sizeof(T));
+
+        // the non-zeros of one dimension at a time, per thread of the pool
+        TaskPool& pool = TaskPool::shared();
+        const ScratchArena::Frame frame(options.scratch);
+        std::vector<T> ownedValues;
+        const std::span<T> threadValues = scratchBuffer(options.scratch, ownedValues, pool.numThreads() * (sizeA + sizeB));
+
+        pool.parallelFor(0, numDimensions, [&](std::size_t d) {
+            T* valuesA = threadValues.data() + pool.slot() * (sizeA + sizeB);
+            T* valuesB = valuesA + sizeA;
+
+            const std::size_t column = subset.column(d);
+            std::size_t nonZeroA = 0, nonZeroB = 0;
+
+            if constexpr (isSparseMatrix<Matrix>)
+            {
+                for (std::uint64_t k = transposed.rowOffsets[column]; k < transposed.rowOffsets[column + 1]; ++k)
+                {
+                    const T value = transposed.values[k];
+                    const std::uint8_t member = membership[transposed.columnIndices[k]];
+                    if (member == 0 || static_cast<float>(value) == 0.0f)
+                        continue;
+
+                    if (member & 1)
+                        valuesA[nonZeroA++] = value;
+                    if (member & 2)
+                        valuesB[nonZeroB++] = value;
+                }
+            }
+            else
+            {
+                // the selections are sorted, so both walk the contiguous row of the dimension forward;
+                // every value is stored and only kept if non-zero, without a branch per value
+                const T* values = transposed.row(column);
+                for (const std::uint32_t row : selectionA)
+                {
+                    valuesA[nonZeroA] = values[row];
+                    nonZeroA += static_cast<float>(values[row]) != 0.0f;
+                }
+                for (const std::uint32_t row : selectionB)
+                {
+                    valuesB[nonZeroB] = values[row];
+                    nonZeroB += static_cast<float>(values[row]) != 0.0f;
+                }
+            }
+
+            local::nonZeroStatistics(valuesA, nonZeroA, sizeA, valuesB, nonZeroB, sizeB, d, subset, options, result);
+
+            if (progress)
+                progress->advance(1);
+            });
+    }
+
+    if (options.statisticalTests)
+    {
+        result.welchAdjustedP = adjustBenjaminiHochberg(result.welchP);
+        result.wilcoxonAdjustedP = adjustBenjaminiHochberg(result.wilcoxonP);
+    }
+
+    if (options.normalize)
+    {
+        PerformanceTrace::Scope scope(trace, "Normalization", "de");
+        local::normalizeResult(result, options);
+    }
+
+    return result;
+}
+
+std::uint64_t countHistogramBins(const DEOptions& options, std::size_t numColumns)
+{
+    const local::CountHistograms histograms = local::countBins(options, local::ColumnSubset(options.dimensions, numColumns));
+    return histograms.offsets.empty() ? 0 : histograms.offsets.back();
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionCounts(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const local::ColumnSubset subset(options.dimensions, matrix.numColumns);
+    const std::size_t numDimensions = subset.size;
+    const std::size_t sizeA = selectionA.size();
+    const std::size_t sizeB = selectionB.size();
+
+    DEResult result = local::emptyResult(numDimensions, options);
+
+    if (sizeA == 0 || sizeB == 0 || numDimensions == 0)
+        return result;
+
+    local::CountHistograms histogramsA = local::countBins(options, subset);
+    if (histogramsA.offsets.empty())
+        return computeDifferentialExpressionSparse(matrix, selectionA, selectionB, options, progress, trace);
+
+    const ScratchArena::Frame frame(options.scratch);
+    local::CountHistograms histogramsB = histogramsA;
+    {
+        PerformanceTrace::Scope scope(trace, "Count histograms", "de", 2 * histogramsA.offsets.back() * sizeof(std::uint32_t));
+        const local::SelectionUnion rows(selectionA, selectionB);
+        local::countValues(matrix, rows, subset, histogramsA, histogramsB, options.scratch, progress);
+    }
+
+    if (local::canceled(progress))
+        return result;
+
+    // the cached ranges do not match the data, e.g. after it changed; counting reported 2 of the 3 steps per dimension
+    if (!histogramsA.valid || !histogramsB.valid)
+    {
+        if (progress == nullptr)
+            return computeDifferentialExpressionSparse(matrix, selectionA, selectionB, options, nullptr, trace);
+
+        local::ReportedProgress sparseProgress(progress, 2 * numDimensions);
+        return computeDifferentialExpressionSparse(matrix, selectionA, selectionB, options, &sparseProgress, trace);
+    }
+
+    {
+        PerformanceTrace::Scope scope(trace, "Statistics of count histograms", "de", 2 * histogramsA.offsets.back() * sizeof(std::uint32_t));
+
+        TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+            const std::uint32_t* countsA = histogramsA.column(d);
+            const std::uint32_t* countsB = histogramsB.column(d);
+            const std::size_t numBins = histogramsA.numBins(d);
+            const std::int64_t minimum = histogramsA.minimum[d];
+
+            result.meanA[d] = static_cast<float>(local::countSum(countsA, numBins, minimum) / sizeA);
+            result.meanB[d] = static_cast<float>(local::countSum(countsB, numBins, minimum) / sizeB);
+            if (options.medians)
+            {
+                result.medianA[d] = local::countOrderStatistic(countsA, numBins, minimum, sizeA / 2);
+                result.medianB[d] = local::countOrderStatistic(countsB, numBins, minimum, sizeB / 2);
+            }
+
+            const float sdA = local::countStandardDeviation(countsA, numBins, minimum, sizeA, result.meanA[d]);
+            const float sdB = local::countStandardDeviation(countsB, numBins, minimum, sizeB, result.meanB[d]);
+
+            if (options.additionalStatistics)
+            {
+                // the threshold applies to the normalized values if normalization is enabled
+                const float minValue = options.normalize ? options.minValues[subset.column(d)] : 0.0f;
+                const float rescaleValue = options.normalize ? options.rescaleValues[subset.column(d)] : 1.0f;
+
+                result.sdA[d] = sdA;
+                result.sdB[d] = sdB;
+                result.pctExpressedA[d] = local::countPercentExpressed(countsA, numBins, minimum, sizeA, options.expressedThreshold, minValue, rescaleValue);
+                result.pctExpressedB[d] = local::countPercentExpressed(countsB, numBins, minimum, sizeB, options.expressedThreshold, minValue, rescaleValue);
+            }
+
+            if (options.statisticalTests)
+            {
+                const WelchTestResult welch = welchTTest(result.meanA[d], double(sdA) * sdA, sizeA, result.meanB[d], double(sdB) * sdB, sizeB);
+                result.welchT[d] = welch.t;
+                result.welchP[d] = welch.p;
+
+                const RankSumTestResult rankSum = local::countRankSumTest(countsA, countsB, numBins, sizeA, sizeB);
+                result.auroc[d] = rankSum.auroc;
+                result.wilcoxonP[d] = rankSum.p;
+            }
+
+            if (progress)
+                progress->advance(1);
+            });
+    }
+
+    if (options.statisticalTests)
+    {
+        result.welchAdjustedP = adjustBenjaminiHochberg(result.welchP);
+        result.wilcoxonAdjustedP = adjustBenjaminiHochberg(result.wilcoxonP);
+    }
+
+    if (options.normalize)
+    {
+        PerformanceTrace::Scope scope(trace, "Normalization", "de");
+        local::normalizeResult(result, options);
+    }
+
+    return result;
+}
+
+DEResult selectRows(const DEResult& result, std::span<const std::uint32_t> rows)
+{
+    DEResult selected;
+
+    selected.dimensions.reserve(rows.size());
+    for (const std::uint32_t row : rows)
+        selected.dimensions.push_back(static_cast<std::uint32_t>(result.dimension(row)));
+
+    selected.meanA = local::selectValues(result.meanA, rows);
+    selected.meanB = local::selectValues(result.meanB, rows);
+    selected.medianA = local::selectValues(result.medianA, rows);
+    selected.medianB = local::selectValues(result.medianB, rows);
+    selected.sdA = local::selectValues(result.sdA, rows);
+    selected.sdB = local::selectValues(result.sdB, rows);
+    selected.pctExpressedA = local::selectValues(result.pctExpressedA, rows);
+    selected.pctExpressedB = local::selectValues(result.pctExpressedB, rows);
+    selected.welchT = local::selectValues(result.welchT, rows);
+    selected.welchP = local::selectValues(result.welchP, rows);
+    selected.welchAdjustedP = local::selectValues(result.welchAdjustedP, rows);
+    selected.auroc = local::selectValues(result.auroc, rows);
+    selected.wilcoxonP = local::selectValues(result.wilcoxonP, rows);
+    selected.wilcoxonAdjustedP = local::selectValues(result.wilcoxonAdjustedP, rows);
+
+    return selected;
+}
+
+bool mergeStatistics(DEResult& result, DEResult&& other)
+{
+    if (result.numDimensions() != other.numDimensions() || result.dimensions != other.dimensions)
+        return false;
+
+    if (!result.hasMedians())
+    {
+        result.medianA = std::move(other.medianA);
+        result.medianB = std::move(other.medianB);
+    }
+
+    if (!result.hasAdditionalStatistics())
+    {
+        result.sdA = std::move(other.sdA);
+        result.sdB = std::move(other.sdB);
+        result.pctExpressedA = std::move(other.pctExpressedA);
+        result.pctExpressedB = std::move(other.pctExpressedB);
+    }
+
+    if (!result.hasStatisticalTests())
+    {
+        result.welchT = std::move(other.welchT);
+        result.welchP = std::move(other.welchP);
+        result.welchAdjustedP = std::move(other.welchAdjustedP);
+        result.auroc = std::move(other.auroc);
+        result.wilcoxonP = std::move(other.wilcoxonP);
+        result.wilcoxonAdjustedP = std::move(other.wilcoxonAdjustedP);
+    }
+
+    return true;
+}
+
+std::vector<std::uint32_t> topRows(const DEResult& result, std::size_t k)
+{
+    std::vector<std::uint32_t> rows(result.numDimensions());
+    for (std::size_t row = 0; row < rows.size(); ++row)
+        rows[row] = static_cast<std::uint32_t>(row);
+
+    // larger |DE| first, ties in the order of the rows
+    const auto larger = [&result](std::uint32_t a, std::uint32_t b)
+    {
+        const float deA = std::abs(result.de(a));
+        const float deB = std::abs(result.de(b));
+        return deA > deB || (deA == deB && a < b);
+    };
+
+    k = std::min(k, rows.size());
+    if (k < rows.size())
+        std::nth_element(rows.begin(), rows.begin() + k, rows.end(), larger);
+
+    rows.resize(k);
+    std::sort(rows.begin(), rows.end(), larger);
+
+    return rows;
+}
+
+DEResult restrictToDimensions(const DEResult& result, std::span<const std::uint32_t> dimensions)
+{
+    std::vector<std::uint32_t> rows;
+    rows.reserve(dimensions.size());
+
+    // both are sorted by column
+    std::size_t row = 0;
+    for (const std::uint32_t dimension : dimensions)
+    {
+        while (row < result.numDimensions() && result.dimension(row) < dimension)
+            ++row;
+        if (row < result.numDimensions() && result.dimension(row) == dimension)
+            rows.push_back(static_cast<std::uint32_t>(row));
+    }
+
+    DEResult restricted = selectRows(result, rows);
+
+    if (restricted.hasStatisticalTests())
+    {
+        restricted.welchAdjustedP = adjustBenjaminiHochberg(restricted.welchP);
+        restricted.wilcoxonAdjustedP = adjustBenjaminiHochberg(restricted.wilcoxonP);
+    }
+
+    return restricted;
+}
+
+#define DE_INSTANTIATE_DIFFERENTIAL_EXPRESSION(T)                                                                                                   \
+    template DEResult computeDifferentialExpression(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);  \
+    template DEResult computeDifferentialExpression(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);       \
+    template DEResult computeDifferentialExpressionSparse(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);  \
+    template DEResult computeDifferentialExpressionSparse(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);   \
+    template DEResult computeDifferentialExpressionCounts(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);   \
+    template DEResult computeDifferentialExpressionCounts(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);   \
+    template DEResult computeDifferentialExpressionTransposed(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);   \
+    template DEResult computeDifferentialExpressionTransposed(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, ProgressSink*, PerformanceTrace*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_DIFFERENTIAL_EXPRESSION)
+
+} // namespace de
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+#include "ScratchArena.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace de
+{
+
+struct DEOptions
+{
+    bool                    additionalStatistics    = false;    // SD and % expressed
+    bool                    statisticalTests        = false;    // Welch's t-test, Wilcoxon rank-sum test with AUROC, BH adjusted p-values
+    bool                    medians                 = true;     // medians of both selections, the costliest of the basic statistics
+    bool                    normalize               = false;    // min-max normalization of means, medians and SDs
+    float                   expressedThreshold      = 0.0f;     // values above count as expressed, on the normalized scale if normalize is set
+    std::span<const float>  minValues;                          // per dimension, required for normalize and count histograms
+    std::span<const float>  rescaleValues;                      // per dimension 1 / (max - min), required for normalize
+    std::span<const float>  maxValues;                          // per dimension, required for count histograms
+    std::span<const std::uint8_t> integralDimensions;           // per dimension 1 if all values are whole numbers, required for count histograms
+    std::span<const std::uint32_t> dimensions;                  // sorted columns to compute, e.g. a gene panel; empty for all
+    ScratchArena*           scratch                 = nullptr;  // working buffers kept between runs; allocated per run if null
+};
+
+/*  Per-dimension statistics of two selections, medians, SD, % expressed and the tests are empty unless requested
+    Row d holds the statistics of column dimension(d) of the matrix.
+*/
+struct DEResult
+{
+    std::vector<std::uint32_t> dimensions;      // column per row, empty if row d is column d
+    std::vector<float> meanA, meanB;
+    std::vector<float> medianA, medianB;
+    std::vector<float> sdA, sdB;
+    std::vector<float> pctExpressedA, pctExpressedB;
+    std::vector<float> welchT, welchP, welchAdjustedP;
+    std::vector<float> auroc, wilcoxonP, wilcoxonAdjustedP;
+
+    std::size_t numDimensions() const { return meanA.size(); }
+    bool hasMedians() const { return !medianA.empty(); }
+    bool hasAdditionalStatistics() const { return !sdA.empty(); }
+    bool hasStatisticalTests() const { return !auroc.empty(); }
+
+    /** Column of the matrix that row \p row describes */
+    std::size_t dimension(std::size_t row) const { return dimensions.empty() ? row : dimensions[row]; }
+
+    /** The differential expression: difference of the means */
+    float de(std::size_t dimension) const { return meanA[dimension] - meanB[dimension]; }
+};
+
+/** Number of rows in both of the sorted selections \p selectionA and \p selectionB */
+std::size_t countOverlap(RowIndices selectionA, RowIndices selectionB);
+
+/*  Compares the rows \p selectionA and \p selectionB of \p matrix for every dimension (column), or those of options.dimensions
+    Per dimension the values of both selections are gathered into contiguous buffers of the stored
+    element type, from which mean, median (the upper median for even sizes), sample SD and
+    % expressed are computed. Both selections are gathered in one scan over their merged rows, so a row
+    in both is read once. Integer values are summed exactly in 64 bits.
+    The statistical tests rank the same buffers after the medians, on the unnormalized values.
+    Progress is reported in rows while gathering and in dimensions afterwards, in total
+    selectionA.size() + selectionB.size() + numDimensions steps, plus numDimensions with the tests,
+    where numDimensions is the number of computed columns.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpression(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/*  The statistics of computeDifferentialExpression from the non-zero values only
+    The non-zeros of both selections are gathered per dimension in one scan over their merged rows, the zeros are counted. Memory and
+    time scale with the number of selected non-zeros instead of all selected values; the results are
+    the same. Progress is reported in dimensions, 3 * numDimensions steps in total.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionSparse(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/*  The statistics of computeDifferentialExpressionSparse from a dimension-major copy of the matrix, see transposeMatrix
+    Row d of \p transposed holds column d of the matrix, the selections index its columns. Every dimension reads
+    one contiguous row, so threads work on whole dimensions without sharing cache lines, and only the non-zeros
+    of one dimension per thread are held at a time. The results are the same. Progress is reported in dimensions,
+    numDimensions steps in total.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionTransposed(const Matrix& transposed, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** Largest number of bins, i.e. of distinct integer values, of a dimension in the count histograms */
+constexpr std::size_t maxCountBins = 1 << 16;
+
+/*  Bins per selection of the count histograms of computeDifferentialExpressionCounts for a matrix of
+    \p numColumns columns, 0 if a computed dimension is not integer-valued or spans more than maxCountBins values
+*/
+std::uint64_t countHistogramBins(const DEOptions& options, std::size_t numColumns);
+
+/*  The statistics of computeDifferentialExpression from a histogram per dimension, for integer data such as UMI counts
+    Both selections are counted into one bin per integer value of the range of each dimension, in one pass
+    over their merged rows without copying the values. Medians, % expressed and the rank-sum test come from the bins and
+    are exact; means and SDs equal those of the other paths up to rounding. Falls back to
+    computeDifferentialExpressionSparse if countHistogramBins is 0, or if a value turns out not to be a whole
+    number within the range of its dimension. Progress is reported in dimensions, 3 * numDimensions steps in total.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionCounts(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** The rows \p rows of \p result in that order, with their statistics and columns */
+DEResult selectRows(const DEResult& result, std::span<const std::uint32_t> rows);
+
+/*  Moves the statistics that \p result lacks from \p other, a result of the same rows, e.g. computed when a column is first shown
+    Returns false and leaves \p result unchanged if the rows of both differ.
+*/
+bool mergeStatistics(DEResult& result, DEResult&& other);
+
+/*  Rows of the \p k largest |DE| of \p result, in descending order of |DE|
+    Selects them with nth_element, so only the k rows are sorted.
+*/
+std::vector<std::uint32_t> topRows(const DEResult& result, std::size_t k);
+
+/*  The rows of the sorted columns \p dimensions of a result of all columns
+    The BH adjusted p-values are recomputed over the kept rows, as if only those had been tested.
+*/
+DEResult restrictToDimensions(const DEResult& result, std::span<const std::uint32_t> dimensions);
+
+} // namespace de
@@ -0,0 +1,257 @@
+#include "DimensionRanges.h"
+
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace de
+{
+
+namespace local
+{
+    constexpr std::size_t progressBlockSize = 256;
+
+    // values of integer types are whole numbers by definition, only floating point values are checked
+    template <typename T>
+    void updateFractional(std::uint8_t& fractional, float value)
+    {
+        if constexpr (!std::is_integral_v<T>)
+            fractional |= value != std::trunc(value);
+    }
+
+    template <typename T>
+    void updateRanges(const DenseMatrixView<T>& matrix, std::size_t row, float* minimum, float* maximum, std::uint8_t* fractional, std::size_t*)
+    {
+        const T* rowData = matrix.row(row);
+        for (std::size_t column = 0; column < matrix.numColumns; ++column)
+        {
+            const float value = static_cast<float>(rowData[column]);
+            minimum[column] = std::min(minimum[column], value);
+            maximum[column] = std::max(maximum[column], value);
+            updateFractional<T>(fractional[column], value);
+        }
+    }
+
+    template <typename T>
+    void updateRanges(const SparseMatrixView<T>& matrix, std::size_t row, float* minimum, float* maximum, std::uint8_t* fractional, std::size_t* count)
+    {
+        for (std::uint64_t k = matrix.rowOffsets[row]; k < matrix.rowOffsets[row + 1]; ++k)
+        {
+            const std::uint32_t column = matrix.columnIndices[k];
+            const float value = static_cast<float>(matrix.values[k]);
+            minimum[column] = std::min(minimum[column], value);
+            maximum[column] = std::max(maximum[column], value);
+            updateFractional<T>(fractional[column], value);
+            ++count[column];
+        }
+    }
+
+    // serially on the calling thread only unless parallel, e.g. for a scan in the background
+    template <typename Matrix, typename RowAt>
+    DimensionRanges computeRanges(const Matrix& matrix, std::size_t numRows, RowAt rowAt, ProgressSink* progress, bool parallel = true)
+    {
+        const std::size_t numColumns = matrix.numColumns;
+        TaskPool& pool = TaskPool::shared();
+        const std::size_t numThreads = parallel ? pool.numThreads() : 1;
+
+        // per-thread partial ranges, merged below
+        std::vector<float> minima(numThreads * numColumns, std::numeric_limits<float>::max());
+        std::vector<float> maxima(numThreads * numColumns, std::numeric_limits<float>::lowest());
+        std::vector<std::uint8_t> fractionals(numThreads * numColumns, 0);
+        std::vector<std::size_t> counts(isSparseMatrix<Matrix> ? numThreads * numColumns : 0, 0);
+
+        const std::size_t numBlocks = (numRows + progressBlockSize - 1) / progressBlockSize;
+
+        auto scanBlock = [&](std::size_t block) {
+            const std::size_t thread = parallel ? pool.slot() : 0;
+            float* minimum = minima.data() + thread * numColumns;
+            float* maximum = maxima.data() + thread * numColumns;
+            std::uint8_t* fractional = fractionals.data() + thread * numColumns;
+            std::size_t* count = isSparseMatrix<Matrix> ? counts.data() + thread * numColumns : nullptr;
+
+            const std::size_t first = block * progressBlockSize;
+            const std::size_t last = std::min(first + progressBlockSize, numRows);
+
+            for (std::size_t i = first; i < last; ++i)
+                updateRanges(matrix, rowAt(i), minimum, maximum, fractional, count);
+
+            if (progress)
+                progress->advance(last - first);
+            };
+
+        if (parallel)
+            pool.parallelFor(0, numBlocks, scanBlock);
+        else
+            for (std::size_t block = 0; block < numBlocks; ++block)
+                scanBlock(block);
+
+        DimensionRanges ranges;
+        ranges.minimum.assign(minima.begin(), minima.begin() + numColumns);
+        ranges.maximum.assign(maxima.begin(), maxima.begin() + numColumns);
+        ranges.integral.assign(numColumns, 1);
+
+        for (std::size_t thread = 0; thread < numThreads; ++thread)
+        {
+            for (std::size_t column = 0; column < numColumns; ++column)
+            {
+                ranges.minimum[column] = std::min(ranges.minimum[column], minima[thread * numColumns + column]);
+                ranges.maximum[column] = std::max(ranges.maximum[column], maxima[thread * numColumns + column]);
+                ranges.integral[column] &= !fractionals[thread * numColumns + column];
+            }
+        }
+
+        // zeros that are not stored still count towards the range
+        if constexpr (isSparseMatrix<Matrix>)
+        {
+            for (std::size_t column = 0; column < numColumns; ++column)
+            {
+                std::size_t count = 0;
+                for (std::size_t thread = 0; thread < numThreads; ++thread)
+                    count += counts[thread * numColumns + column];
+
+                if (count < numRows)
+                {
+                    ranges.minimum[column] = std::min(ranges.minimum[column], 0.0f);
+                    ranges.maximum[column] = std::max(ranges.maximum[column], 0.0f);
+                }
+            }
+        }
+
+        return ranges;
+    }
+}
+
+template <typename Matrix>
+DimensionRanges computeDimensionRanges(const Matrix& matrix, ProgressSink* progress)
+{
+    return local::computeRanges(matrix, matrix.numRows, [](std::size_t i) { return i; }, progress);
+}
+
+template <typename Matrix>
+DimensionRanges computeDimensionRanges(const Matrix& matrix, RowIndices rows, ProgressSink* progress)
+{
+    return local::computeRanges(matrix, rows.size(), [rows](std::size_t i) -> std::size_t { return rows[i]; }, progress);
+}
+
+void mergeDimensionRanges(DimensionRanges& ranges, const DimensionRanges& other)
+{
+    if (ranges.minimum.empty())
+    {
+        ranges = other;
+        return;
+    }
+
+    for (std::size_t d = 0; d < ranges.minimum.size(); ++d)
+    {
+        ranges.minimum[d] = std::min(ranges.minimum[d], other.minimum[d]);
+        ranges.maximum[d] = std::max(ranges.maximum[d], other.maximum[d]);
+    }
+
+    ranges.integral.resize(ranges.minimum.size(), 0);
+    for (std::size_t d = 0; d < ranges.integral.size(); ++d)
+        ranges.integral[d] &= d < other.integral.size() && other.integral[d];
+}
+
+template <typename Matrix>
+BackgroundRangeScan::BackgroundRangeScan(const Matrix& matrix, RowIndices rows, std::function<void()> finished) :
+    _numRows(rows.empty() ? matrix.numRows : rows.size()),
+    _finished(std::move(finished))
+{
+    _blockRows = std::max(minimumBlockRows, (_numRows + maximumBlocks - 1) / maximumBlocks);
+    _numBlocks = (_numRows + _blockRows - 1) / _blockRows;
+
+    if (rows.empty())
+        _scanRows = [matrix](std::size_t first, std::size_t last) { return local::computeRanges(matrix, last - first, [first](std::size_t i) { return first + i; }, nullptr, false); };
+    else
+        _scanRows = [matrix, rows](std::size_t first, std::size_t last) { return local::computeRanges(matrix, last - first, [rows, first](std::size_t i) -> std::size_t { return rows[first + i]; }, nullptr, false); };
+
+    // the ranges of no rows
+    if (_numBlocks == 0)
+    {
+        _ranges = _scanRows(0, 0);
+        return;
+    }
+
+    _task = std::async(std::launch::async, [this]() {
+        while (!_stop && scanNextBlock())
+            ;
+        });
+}
+
+BackgroundRangeScan::~BackgroundRangeScan()
+{
+    _stop = true;
+    if (_task.valid())
+        _task.wait();
+}
+
+bool BackgroundRangeScan::ready() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _scannedBlocks == _numBlocks;
+}
+
+const DimensionRanges& BackgroundRangeScan::wait()
+{
+    // every index claims the next block that is left, blocks claimed by the background thread are skipped
+    TaskPool::shared().parallelFor(0, _numBlocks, [this](std::size_t) { scanNextBlock(); }, 1);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _scanned.wait(lock, [this]() { return _scannedBlocks == _numBlocks; });
+    return _ranges;
+}
+
+bool BackgroundRangeScan::scanNextBlock()
+{
+    const std::size_t block = _nextBlock++;
+    if (block >= _numBlocks)
+        return false;
+
+    const std::size_t first = block * _blockRows;
+    const DimensionRanges blockRanges = _scanRows(first, std::min(first + _blockRows, _numRows));
+
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        mergeDimensionRanges(_ranges, blockRanges);
+        last = ++_scannedBlocks == _numBlocks;
+    }
+
+    if (last)
+    {
+        _scanned.notify_all();
+        if (_finished)
+            _finished();
+    }
+
+    return true;
+}
+
+std::vector<float> rescaleFactors(const DimensionRanges& ranges)
+{
+    std::vector<float> factors(ranges.minimum.size(), 1.0f);
+
+    for (std::size_t d = 0; d < factors.size(); ++d)
+    {
+        const float diff = ranges.maximum[d] - ranges.minimum[d];
+        if (std::fabs(diff) > 1e-6f)
+            factors[d] = 1.0f / diff;
+    }
+
+    return factors;
+}
+
+#define DE_INSTANTIATE_DIMENSION_RANGES(T)                                                                              \
+    template DimensionRanges computeDimensionRanges(const DenseMatrixView<T>&, ProgressSink*);                          \
+    template DimensionRanges computeDimensionRanges(const DenseMatrixView<T>&, RowIndices, ProgressSink*);              \
+    template DimensionRanges computeDimensionRanges(const SparseMatrixView<T>&, ProgressSink*);                         \
+    template DimensionRanges computeDimensionRanges(const SparseMatrixView<T>&, RowIndices, ProgressSink*);         \
+    template BackgroundRangeScan::BackgroundRangeScan(const DenseMatrixView<T>&, RowIndices, std::function<void()>);  \
+    template BackgroundRangeScan::BackgroundRangeScan(const SparseMatrixView<T>&, RowIndices, std::function<void()>);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_DIMENSION_RANGES)
+
+} // namespace de
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MatrixView.h"
+#include "ProgressSink.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace de
+{
+
+/** Per-dimension minimum and maximum of a matrix, and whether all values of a dimension are whole numbers */
+struct DimensionRanges
+{
+    std::vector<float>          minimum;
+    std::vector<float>          maximum;
+    std::vector<std::uint8_t>   integral;   // 1 for integer-valued dimensions, e.g. raw counts
+};
+
+/** Ranges over all rows of \p matrix; implicit zeros of sparse matrices are taken into account */
+template <typename Matrix>
+DimensionRanges computeDimensionRanges(const Matrix& matrix, ProgressSink* progress = nullptr);
+
+/** Ranges over the given \p rows of \p matrix */
+template <typename Matrix>
+DimensionRanges computeDimensionRanges(const Matrix& matrix, RowIndices rows, ProgressSink* progress = nullptr);
+
+/** Widens \p ranges to include \p other, e.g. the ranges of another block of rows; empty \p ranges take \p other. A dimension stays integral if it is in both. */
+void mergeDimensionRanges(DimensionRanges& ranges, const DimensionRanges& other);
+
+/*  Dimension ranges scanned in the background, e.g. of a dataset that was just loaded and may never be normalized
+    A thread of its own scans blocks of rows one after the other without the task pool, so it takes one core at
+    most. wait() scans the blocks that are left on the task pool, so whoever needs the ranges only waits for the
+    remaining work, at full speed. The result equals that of computeDimensionRanges. The matrix must stay valid
+    until the scan is destroyed, which cancels it.
+*/
+class BackgroundRangeScan
+{
+public:
+    /** Starts scanning \p rows of \p matrix, all rows if empty; \p finished is called by the thread that scans the last block */
+    template <typename Matrix>
+    BackgroundRangeScan(const Matrix& matrix, RowIndices rows = {}, std::function<void()> finished = {});
+    ~BackgroundRangeScan();
+
+    BackgroundRangeScan(const BackgroundRangeScan&) = delete;
+    BackgroundRangeScan& operator=(const BackgroundRangeScan&) = delete;
+
+    /** All blocks are scanned */
+    bool ready() const;
+
+    /** The ranges, once the blocks that are left are scanned on the calling thread and the task pool */
+    const DimensionRanges& wait();
+
+private:
+    /** Scans the next block nobody claimed yet into the ranges, false if none is left */
+    bool scanNextBlock();
+
+private:
+    static constexpr std::size_t minimumBlockRows = 4096;
+    static constexpr std::size_t maximumBlocks = 256;
+
+    std::function<DimensionRanges(std::size_t, std::size_t)>   _scanRows;      // ranges of rows [first, last) of the scan
+    std::size_t                                                 _numRows    = 0;
+    std::size_t                                                 _blockRows  = 0;
+    std::size_t                                                 _numBlocks  = 0;
+    std::atomic<std::size_t>                                    _nextBlock  = 0;
+    std::atomic<bool>                                           _stop       = false;
+    mutable std::mutex                                          _mutex;
+    std::condition_variable                                     _scanned;
+    std::size_t                                                 _scannedBlocks = 0;
+    DimensionRanges                                             _ranges;        // of the scanned blocks
+    std::function<void()>                                       _finished;
+    std::future<void>                                           _task;
+};
+
+/** Factors for min-max normalization: 1 / (max - min), or 1 for (nearly) constant dimensions */
+std::vector<float> rescaleFactors(const DimensionRanges& ranges);
+
+} // namespace de
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace de
+{
+
+/*  Brain floating point: the upper 16 bits of an IEEE 754 float
+    Layout-compatible with biovault::bfloat16_t, which ManiVault uses to store Points
+*/
+struct BFloat16
+{
+    std::uint16_t bits = 0;
+
+    BFloat16() = default;
+
+    explicit BFloat16(float value)
+    {
+        std::uint32_t floatBits;
+        std::memcpy(&floatBits, &value, sizeof(floatBits));
+
+        if ((floatBits & 0x7fffffffu) > 0x7f800000u)    // NaN, keep it a (quiet) NaN
+            bits = static_cast<std::uint16_t>((floatBits >> 16) | 0x0040u);
+        else                                            // round to nearest even
+            bits = static_cast<std::uint16_t>((floatBits + 0x7fffu + ((floatBits >> 16) & 1u)) >> 16);
+    }
+
+    operator float() const
+    {
+        const std::uint32_t floatBits = static_cast<std::uint32_t>(bits) << 16;
+        float value;
+        std::memcpy(&value, &floatBits, sizeof(value));
+        return value;
+    }
+};
+
+static_assert(sizeof(BFloat16) == 2);
+
+/** Storage types of matrix elements, the numbering is part of the binary matrix file format */
+enum class ElementType : std::uint32_t
+{
+    Float32     = 0,
+    UInt8       = 1,
+    UInt16      = 2,
+    Int16       = 3,
+    Int8        = 4,
+    BFloat16    = 5,
+};
+
+inline std::size_t elementSize(ElementType type)
+{
+    switch (type)
+    {
+    case ElementType::Float32:  return 4;
+    case ElementType::UInt16:
+    case ElementType::Int16:
+    case ElementType::BFloat16: return 2;
+    case ElementType::UInt8:
+    case ElementType::Int8:     return 1;
+    }
+    return 0;
+}
+
+inline std::string_view elementTypeName(ElementType type)
+{
+    switch (type)
+    {
+    case ElementType::Float32:  return "float32";
+    case ElementType::UInt8:    return "uint8";
+    case ElementType::UInt16:   return "uint16";
+    case ElementType::Int16:    return "int16";
+    case ElementType::Int8:     return "int8";
+    case ElementType::BFloat16: return "bfloat16";
+    }
+    return "unknown";
+}
+
+/** The element type stored as the C++ type T, the inverse of visitElementType */
+template <typename T>
+inline constexpr ElementType elementTypeOf = ElementType::Float32;
+
+template <> inline constexpr ElementType elementTypeOf<std::uint8_t>    = ElementType::UInt8;
+template <> inline constexpr ElementType elementTypeOf<std::uint16_t>   = ElementType::UInt16;
+template <> inline constexpr ElementType elementTypeOf<std::int16_t>    = ElementType::Int16;
+template <> inline constexpr ElementType elementTypeOf<std::int8_t>     = ElementType::Int8;
+template <> inline constexpr ElementType elementTypeOf<BFloat16>        = ElementType::BFloat16;
+
+/** Calls functionObject with a default-constructed value of the C++ type that stores \p type */
+template <typename FunctionObject>
+decltype(auto) visitElementType(ElementType type, FunctionObject&& functionObject)
+{
+    switch (type)
+    {
+    case ElementType::UInt8:    return functionObject(std::uint8_t{});
+    case ElementType::UInt16:   return functionObject(std::uint16_t{});
+    case ElementType::Int16:    return functionObject(std::int16_t{});
+    case ElementType::Int8:     return functionObject(std::int8_t{});
+    case ElementType::BFloat16: return functionObject(BFloat16{});
+    case ElementType::Float32:
+    default:                    return functionObject(float{});
+    }
+}
+
+} // namespace de
@@ -0,0 +1,535 @@
+#include "GroupStatistics.h"
+
+#include "StatisticalTests.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace de
+{
+
+namespace local
+{
+    constexpr std::size_t minimumBlockColumns = 64;
+
+    // Walks the zeros and the histogram bins of one group and dimension in increasing order of value,
+    // the zeros go before the values of the bin that contains zero
+    template <typename Visitor>
+    void visitTieGroups(const GroupAggregates& aggregates, std::size_t group, std::size_t dimension, Visitor visitor)
+    {
+        const std::size_t index = aggregates.index(group, dimension);
+        const std::uint32_t* bins = aggregates.bins(group, dimension);
+        const std::uint64_t zeros = aggregates.count[group] - aggregates.nonZero[index];
+
+        const float binWidth = aggregates.binWidth[dimension];
+        const float lowerEdge = aggregates.binMinimum[dimension];
+        const auto zeroBin = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(std::floor(-lowerEdge / binWidth)), 0, aggregates.numBins - 1));
+
+        for (std::size_t bin = 0; bin < aggregates.numBins; ++bin)
+        {
+            if (bin == zeroBin)
+                visitor(-1, zeros);
+            visitor(static_cast<std::ptrdiff_t>(bin), bins[bin]);
+        }
+    }
+
+    // Median (upper median for even counts), interpolated linearly within a bin
+    float histogramMedian(const GroupAggregates& aggregates, std::size_t group, std::size_t dimension)
+    {
+        const std::uint64_t count = aggregates.count[group];
+        if (count == 0)
+            return 0.0f;
+
+        const std::uint64_t rank = count / 2;
+        const float binWidth = aggregates.binWidth[dimension];
+        const float lowerEdge = aggregates.binMinimum[dimension];
+
+        std::uint64_t before = 0;
+        float median = lowerEdge + binWidth * aggregates.numBins;
+        bool found = false;
+
+        visitTieGroups(aggregates, group, dimension, [&](std::ptrdiff_t bin, std::uint64_t size) {
+            if (found || size == 0)
+                return;
+
+            if (rank < before + size)
+            {
+                median = bin < 0 ? 0.0f : lowerEdge + binWidth * (bin + (rank - before + 0.5f) / size);
+                found = true;
+            }
+            before += size;
+            });
+
+        return median;
+    }
+
+    RankSumTestResult histogramRankSum(const GroupAggregates& aggregatesA, std::size_t groupA, const GroupAggregates& aggregatesB, std::size_t groupB, std::size_t dimension)
+    {
+        std::vector<std::uint64_t> tiesB;
+        tiesB.reserve(aggregatesB.numBins + 1);
+        visitTieGroups(aggregatesB, groupB, dimension, [&tiesB](std::ptrdiff_t, std::uint64_t size) { tiesB.push_back(size); });
+
+        RankSumAccumulator accumulator;
+        std::size_t tie = 0;
+        visitTieGroups(aggregatesA, groupA, dimension, [&](std::ptrdiff_t, std::uint64_t size) {
+            accumulator.addTieGroup(static_cast<double>(size), static_cast<double>(tiesB[tie++]));
+            });
+
+        return accumulator.result(aggregatesA.count[groupA], aggregatesB.count[groupB]);
+    }
+
+    template <typename Combine>
+    void combineGroup(GroupAggregates& target, std::size_t group, const GroupAggregates& other, std::size_t otherGroup, Combine combine)
+    {
+        target.count[group] = combine(target.count[group], other.count[otherGroup]);
+
+        const std::size_t first = target.index(group, 0);
+        const std::size_t otherFirst = other.index(otherGroup, 0);
+        for (std::size_t d = 0; d < target.numDimensions; ++d)
+        {
+            target.sum[first + d] = combine(target.sum[first + d], other.sum[otherFirst + d]);
+            target.sumOfSquares[first + d] = combine(target.sumOfSquares[first + d], other.sumOfSquares[otherFirst + d]);
+            target.nonZero[first + d] = combine(target.nonZero[first + d], other.nonZero[otherFirst + d]);
+            target.expressed[first + d] = combine(target.expressed[first + d], other.expressed[otherFirst + d]);
+        }
+
+        std::uint32_t* bins = target.histogram.data() + first * target.numBins;
+        const std::uint32_t* otherBins = other.histogram.data() + otherFirst * other.numBins;
+        for (std::size_t i = 0; i < target.numDimensions * target.numBins; ++i)
+            bins[i] = combine(bins[i], otherBins[i]);
+    }
+
+    struct ColumnBinning
+    {
+        std::vector<float> scale;               // bins per unit of value
+        std::vector<float> expressedThreshold;  // on the scale of the data
+    };
+
+    ColumnBinning columnBinning(std::size_t numBins, std::size_t numDimensions, const AggregationOptions& options)
+    {
+        ColumnBinning binning;
+        binning.scale.resize(numDimensions);
+        binning.expressedThreshold.resize(numDimensions);
+        for (std::size_t d = 0; d < numDimensions; ++d)
+        {
+            binning.scale[d] = options.rescaleValues[d] * numBins;
+            binning.expressedThreshold[d] = options.normalizedThreshold ? options.minValues[d] + options.expressedThreshold / options.rescaleValues[d] : options.expressedThreshold;
+        }
+        return binning;
+    }
+
+    void addValue(GroupAggregates& aggregates, std::uint32_t group, std::size_t column, float value, const ColumnBinning& binning)
+    {
+        const std::size_t index = aggregates.index(group, column);
+
+        aggregates.sum[index] += value;
+        aggregates.sumOfSquares[index] += static_cast<double>(value) * value;
+        ++aggregates.nonZero[index];
+
+        if (value > binning.expressedThreshold[column])
+            ++aggregates.expressed[index];
+
+        const auto bin = std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>((value - aggregates.binMinimum[column]) * binning.scale[column]), 0, aggregates.numBins - 1);
+        ++aggregates.histogram[index * aggregates.numBins + bin];
+    }
+
+    template <typename T>
+    void aggregateBlock(const DenseMatrixView<T>& matrix, const GroupMembership& membership, std::size_t numRows, std::size_t first, std::size_t last, GroupAggregates& aggregates, const ColumnBinning& binning)
+    {
+        for (std::size_t row = 0; row < numRows; ++row)
+        {
+            const std::uint64_t groupsBegin = membership.rowOffsets[row];
+            const std::uint64_t groupsEnd = membership.rowOffsets[row + 1];
+            if (groupsBegin == groupsEnd)
+                continue;
+
+            const T* rowData = matrix.row(row);
+            for (std::size_t column = first; column < last; ++column)
+            {
+                const float value = static_cast<float>(rowData[column]);
+                if (value == 0.0f)
+                    continue;
+
+                for (std::uint64_t k = groupsBegin; k < groupsEnd; ++k)
+                    addValue(aggregates, membership.groups[k], column, value, binning);
+            }
+        }
+    }
+
+    template <typename T>
+    void aggregateBlock(const SparseMatrixView<T>& matrix, const GroupMembership& membership, std::size_t numRows, std::size_t first, std::size_t last, GroupAggregates& aggregates, const ColumnBinning& binning)
+    {
+        for (std::size_t row = 0; row < numRows; ++row)
+        {
+            const std::uint64_t groupsBegin = membership.rowOffsets[row];
+            const std::uint64_t groupsEnd = membership.rowOffsets[row + 1];
+            if (groupsBegin == groupsEnd)
+                continue;
+
+            const std::uint32_t* columnsEnd = matrix.columnIndices + matrix.rowOffsets[row + 1];
+            const std::uint32_t* columns = std::lower_bound(matrix.columnIndices + matrix.rowOffsets[row], columnsEnd, static_cast<std::uint32_t>(first));
+
+            for (; columns != columnsEnd && *columns < last; ++columns)
+            {
+                const float value = static_cast<float>(matrix.values[columns - matrix.columnIndices]);
+                if (value == 0.0f)
+                    continue;
+
+                for (std::uint64_t k = groupsBegin; k < groupsEnd; ++k)
+                    addValue(aggregates, membership.groups[k], *columns, value, binning);
+            }
+        }
+    }
+}
+
+GroupMembership GroupMembership::fromLabels(std::span<const std::int32_t> labels, std::size_t numGroups)
+{
+    GroupMembership membership;
+    membership.numGroups = numGroups;
+    membership.rowOffsets.resize(labels.size() + 1, 0);
+    membership.groups.reserve(labels.size());
+
+    for (std::size_t row = 0; row < labels.size(); ++row)
+    {
+        if (labels[row] >= 0 && static_cast<std::size_t>(labels[row]) < numGroups)
+            membership.groups.push_back(static_cast<std::uint32_t>(labels[row]));
+        membership.rowOffsets[row + 1] = membership.groups.size();
+    }
+
+    return membership;
+}
+
+GroupMembership GroupMembership::fromSelections(std::size_t numRows, std::span<const RowIndices> selections)
+{
+    GroupMembership membership;
+    membership.numGroups = selections.size();
+    membership.rowOffsets.assign(numRows + 1, 0);
+
+    // count, prefix sum, fill
+    for (const auto& selection : selections)
+        for (const std::uint32_t row : selection)
+            if (row < numRows)
+                ++membership.rowOffsets[row + 1];
+
+    for (std::size_t row = 0; row < numRows; ++row)
+        membership.rowOffsets[row + 1] += membership.rowOffsets[row];
+
+    membership.groups.resize(membership.rowOffsets[numRows]);
+    std::vector<std::uint64_t> next(membership.rowOffsets.begin(), membership.rowOffsets.end() - 1);
+    for (std::size_t group = 0; group < selections.size(); ++group)
+        for (const std::uint32_t row : selections[group])
+            if (row < numRows)
+                membership.groups[next[row]++] = static_cast<std::uint32_t>(group);
+
+    return membership;
+}
+
+GroupMembership GroupMembership::fromSelections(std::size_t firstRow, std::size_t numRows, std::span<const RowIndices> selections)
+{
+    GroupMembership membership;
+    membership.numGroups = selections.size();
+    membership.rowOffsets.assign(numRows + 1, 0);
+
+    // the rows of the block are a contiguous range of every sorted selection
+    auto blockRange = [firstRow, numRows](RowIndices selection) {
+        const auto begin = std::lower_bound(selection.begin(), selection.end(), firstRow);
+        const auto end = std::lower_bound(begin, selection.end(), firstRow + numRows);
+        return selection.subspan(begin - selection.begin(), end - begin);
+        };
+
+    for (const auto& selection : selections)
+        for (const std::uint32_t row : blockRange(selection))
+            ++membership.rowOffsets[row - firstRow + 1];
+
+    for (std::size_t row = 0; row < numRows; ++row)
+        membership.rowOffsets[row + 1] += membership.rowOffsets[row];
+
+    membership.groups.resize(membership.rowOffsets[numRows]);
+    std::vector<std::uint64_t> next(membership.rowOffsets.begin(), membership.rowOffsets.end() - 1);
+    for (std::size_t group = 0; group < selections.size(); ++group)
+        for (const std::uint32_t row : blockRange(selections[group]))
+            membership.groups[next[row - firstRow]++] = static_cast<std::uint32_t>(group);
+
+    return membership;
+}
+
+void GroupAggregates::merge(const GroupAggregates& other)
+{
+    for (std::size_t group = 0; group < numGroups; ++group)
+        add(group, other, group);
+}
+
+void GroupAggregates::add(std::size_t group, const GroupAggregates& other, std::size_t otherGroup)
+{
+    local::combineGroup(*this, group, other, otherGroup, [](auto a, auto b) { return a + b; });
+}
+
+void GroupAggregates::subtract(std::size_t group, const GroupAggregates& other, std::size_t otherGroup)
+{
+    local::combineGroup(*this, group, other, otherGroup, [](auto a, auto b) { return a - b; });
+}
+
+GroupAggregates GroupAggregates::combined() const
+{
+    GroupAggregates result;
+    result.numGroups = 1;
+    result.numDimensions = numDimensions;
+    result.numBins = numBins;
+    result.binMinimum = binMinimum;
+    result.binWidth = binWidth;
+    result.count.assign(1, 0);
+    result.sum.assign(numDimensions, 0.0);
+    result.sumOfSquares.assign(numDimensions, 0.0);
+    result.nonZero.assign(numDimensions, 0);
+    result.expressed.assign(numDimensions, 0);
+    result.histogram.assign(numDimensions * numBins, 0);
+
+    for (std::size_t group = 0; group < numGroups; ++group)
+        result.add(0, *this, group);
+
+    return result;
+}
+
+std::uint64_t GroupAggregates::estimateBytes(std::size_t numGroups, std::size_t numDimensions, std::size_t numBins)
+{
+    const std::uint64_t entries = static_cast<std::uint64_t>(numGroups) * numDimensions;
+    return entries * (2 * sizeof(double) + 2 * sizeof(std::uint64_t) + numBins * sizeof(std::uint32_t));
+}
+
+GroupAggregates emptyGroupAggregates(std::size_t numGroups, std::size_t numDimensions, const AggregationOptions& options)
+{
+    const std::size_t numBins = std::max<std::size_t>(1, options.numBins);
+
+    GroupAggregates aggregates;
+    aggregates.numGroups = numGroups;
+    aggregates.numDimensions = numDimensions;
+    aggregates.numBins = numBins;
+    aggregates.binMinimum.assign(options.minValues.begin(), options.minValues.end());
+    aggregates.binWidth.resize(numDimensions);
+    aggregates.count.assign(numGroups, 0);
+    aggregates.sum.assign(numGroups * numDimensions, 0.0);
+    aggregates.sumOfSquares.assign(numGroups * numDimensions, 0.0);
+    aggregates.nonZero.assign(numGroups * numDimensions, 0);
+    aggregates.expressed.assign(numGroups * numDimensions, 0);
+    aggregates.histogram.assign(numGroups * numDimensions * numBins, 0);
+
+    for (std::size_t d = 0; d < numDimensions; ++d)
+        aggregates.binWidth[d] = 1.0f / (options.rescaleValues[d] * numBins);
+
+    return aggregates;
+}
+
+template <typename Matrix>
+void accumulateGroups(const Matrix& matrix, const GroupMembership& membership, const AggregationOptions& options, GroupAggregates& aggregates, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const std::size_t numDimensions = aggregates.numDimensions;
+    const std::size_t numRows = std::min(matrix.numRows, membership.numRows());
+
+    for (std::size_t row = 0; row < numRows; ++row)
+        for (std::uint64_t k = membership.rowOffsets[row]; k < membership.rowOffsets[row + 1]; ++k)
+            ++aggregates.count[membership.groups[k]];
+
+    const local::ColumnBinning binning = local::columnBinning(aggregates.numBins, numDimensions, options);
+
+    PerformanceTrace::Scope scope(trace, "Group aggregation (one scan)", "de", GroupAggregates::estimateBytes(aggregates.numGroups, numDimensions, aggregates.numBins));
+
+    // a few blocks per thread balance the load, blocks of at least a few cache lines keep dense rows streaming
+    const std::size_t blockColumns = std::max(local::minimumBlockColumns, (numDimensions + 4 * TaskPool::shared().concurrency() - 1) / (4 * TaskPool::shared().concurrency()));
+    const std::size_t numBlocks = (numDimensions + blockColumns - 1) / blockColumns;
+
+    TaskPool::shared().parallelFor(0, numBlocks, [&](std::size_t block) {
+        const std::size_t first = block * blockColumns;
+        const std::size_t last = std::min(first + blockColumns, numDimensions);
+
+        if (progress && progress->canceled())
+            return;
+
+        local::aggregateBlock(matrix, membership, numRows, first, last, aggregates, binning);
+
+        if (progress)
+            progress->advance(last - first);
+        });
+}
+
+void finishGroupAggregates(GroupAggregates& aggregates, const AggregationOptions& options)
+{
+    const local::ColumnBinning binning = local::columnBinning(aggregates.numBins, aggregates.numDimensions, options);
+
+    // zeros are not visited, they are expressed only for a negative threshold
+    for (std::size_t group = 0; group < aggregates.numGroups; ++group)
+        for (std::size_t d = 0; d < aggregates.numDimensions; ++d)
+            if (binning.expressedThreshold[d] < 0.0f)
+                aggregates.expressed[aggregates.index(group, d)] += aggregates.count[group] - aggregates.nonZero[aggregates.index(group, d)];
+}
+
+template <typename Matrix>
+GroupAggregates aggregateGroups(const Matrix& matrix, const GroupMembership& membership, const AggregationOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    GroupAggregates aggregates = emptyGroupAggregates(membership.numGroups, matrix.numColumns, options);
+    accumulateGroups(matrix, membership, options, aggregates, progress, trace);
+    finishGroupAggregates(aggregates, options);
+    return aggregates;
+}
+
+DEResult compareGroups(const GroupAggregates& aggregatesA, std::size_t groupA, const GroupAggregates& aggregatesB, std::size_t groupB, const DEOptions& options)
+{
+    const std::size_t numDimensions = aggregatesA.numDimensions;
+    const double sizeA = static_cast<double>(aggregatesA.count[groupA]);
+    const double sizeB = static_cast<double>(aggregatesB.count[groupB]);
+
+    DEResult result;
+    result.meanA.assign(numDimensions, 0.0f);
+    result.meanB.assign(numDimensions, 0.0f);
+    if (options.medians)
+    {
+        result.medianA.assign(numDimensions, 0.0f);
+        result.medianB.assign(numDimensions, 0.0f);
+    }
+    if (options.additionalStatistics)
+    {
+        result.sdA.assign(numDimensions, 0.0f);
+        result.sdB.assign(numDimensions, 0.0f);
+        result.pctExpressedA.assign(numDimensions, 0.0f);
+        result.pctExpressedB.assign(numDimensions, 0.0f);
+    }
+    if (options.statisticalTests)
+    {
+        result.welchT.assign(numDimensions, 0.0f);
+        result.welchP.assign(numDimensions, 1.0f);
+        result.auroc.assign(numDimensions, 0.5f);
+        result.wilcoxonP.assign(numDimensions, 1.0f);
+    }
+
+    if (sizeA == 0 || sizeB == 0 || numDimensions == 0)
+    {
+        result.welchAdjustedP = result.welchP;
+        result.wilcoxonAdjustedP = result.wilcoxonP;
+        return result;
+    }
+
+    auto variance = [](double sum, double sumOfSquares, double size) {
+        return size > 1 ? std::max(0.0, (sumOfSquares - sum * sum / size) / (size - 1)) : 0.0;
+        };
+
+    TaskPool::shared().parallelFor(0, numDimensions, [&](std::size_t d) {
+        const std::size_t indexA = aggregatesA.index(groupA, d);
+        const std::size_t indexB = aggregatesB.index(groupB, d);
+
+        const double meanA = aggregatesA.sum[indexA] / sizeA;
+        const double meanB = aggregatesB.sum[indexB] / sizeB;
+        const double varianceA = variance(aggregatesA.sum[indexA], aggregatesA.sumOfSquares[indexA], sizeA);
+        const double varianceB = variance(aggregatesB.sum[indexB], aggregatesB.sumOfSquares[indexB], sizeB);
+
+        result.meanA[d] = static_cast<float>(meanA);
+        result.meanB[d] = static_cast<float>(meanB);
+        if (options.medians)
+        {
+            result.medianA[d] = local::histogramMedian(aggregatesA, groupA, d);
+            result.medianB[d] = local::histogramMedian(aggregatesB, groupB, d);
+        }
+
+        if (options.additionalStatistics)
+        {
+            result.sdA[d] = static_cast<float>(std::sqrt(varianceA));
+            result.sdB[d] = static_cast<float>(std::sqrt(varianceB));
+            result.pctExpressedA[d] = static_cast<float>(100.0 * aggregatesA.expressed[indexA] / sizeA);
+            result.pctExpressedB[d] = static_cast<float>(100.0 * aggregatesB.expressed[indexB] / sizeB);
+        }
+
+        if (options.statisticalTests)
+        {
+            const WelchTestResult welch = welchTTest(meanA, varianceA, aggregatesA.count[groupA], meanB, varianceB, aggregatesB.count[groupB]);
+            result.welchT[d] = welch.t;
+            result.welchP[d] = welch.p;
+
+            const RankSumTestResult rankSum = local::histogramRankSum(aggregatesA, groupA, aggregatesB, groupB, d);
+            result.auroc[d] = rankSum.auroc;
+            result.wilcoxonP[d] = rankSum.p;
+        }
+
+        if (options.normalize)
+        {
+            const float minValue = options.minValues[d];
+            const float rescaleValue = options.rescaleValues[d];
+
+            result.meanA[d] = (result.meanA[d] - minValue) * rescaleValue;
+            result.meanB[d] = (result.meanB[d] - minValue) * rescaleValue;
+            if (options.medians)
+            {
+                result.medianA[d] = (result.medianA[d] - minValue) * rescaleValue;
+                result.medianB[d] = (result.medianB[d] - minValue) * rescaleValue;
+            }
+
+            if (options.additionalStatistics)
+            {
+                result.sdA[d] *= rescaleValue;
+                result.sdB[d] *= rescaleValue;
+            }
+        }
+        }, 64);
+
+    if (options.statisticalTests)
+    {
+        result.welchAdjustedP = adjustBenjaminiHochberg(result.welchP);
+        result.wilcoxonAdjustedP = adjustBenjaminiHochberg(result.wilcoxonP);
+    }
+
+    return result;
+}
+
+std::vector<DEResult> compareOneVsRest(const GroupAggregates& aggregates, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    PerformanceTrace::Scope scope(trace, "One-vs-rest statistics", "de");
+
+    const GroupAggregates all = aggregates.combined();
+
+    std::vector<DEResult> results;
+    results.reserve(aggregates.numGroups);
+
+    for (std::size_t group = 0; group < aggregates.numGroups; ++group)
+    {
+        GroupAggregates rest = all;
+        rest.subtract(0, aggregates, group);
+
+        results.push_back(compareGroups(aggregates, group, rest, 0, options));
+
+        if (progress)
+            progress->advance(1);
+    }
+
+    return results;
+}
+
+std::vector<DEResult> compareAllPairs(const GroupAggregates& aggregates, const DEOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    PerformanceTrace::Scope scope(trace, "All-pairs statistics", "de");
+
+    const std::size_t numGroups = aggregates.numGroups;
+
+    std::vector<DEResult> results;
+    results.reserve(numGroups * (numGroups - (numGroups > 0)) / 2);
+
+    for (std::size_t groupA = 0; groupA < numGroups; ++groupA)
+    {
+        for (std::size_t groupB = groupA + 1; groupB < numGroups; ++groupB)
+        {
+            results.push_back(compareGroups(aggregates, groupA, aggregates, groupB, options));
+
+            if (progress)
+                progress->advance(1);
+        }
+    }
+
+    return results;
+}
+
+#define DE_INSTANTIATE_GROUP_STATISTICS(T)                                                                                                                          \
+    template void accumulateGroups(const DenseMatrixView<T>&, const GroupMembership&, const AggregationOptions&, GroupAggregates&, ProgressSink*, PerformanceTrace*);  \
+    template void accumulateGroups(const SparseMatrixView<T>&, const GroupMembership&, const AggregationOptions&, GroupAggregates&, ProgressSink*, PerformanceTrace*); \
+    template GroupAggregates aggregateGroups(const DenseMatrixView<T>&, const GroupMembership&, const AggregationOptions&, ProgressSink*, PerformanceTrace*);       \
+    template GroupAggregates aggregateGroups(const SparseMatrixView<T>&, const GroupMembership&, const AggregationOptions&, ProgressSink*, PerformanceTrace*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_GROUP_STATISTICS)
+
+} // namespace de
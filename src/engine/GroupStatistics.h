@@ -0,0 +1,118 @@
+#pragma once
+
+#include "DifferentialExpression.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace de
+{
+
+/** Rows of a matrix assigned to groups, in CSR form: row r belongs to groups[rowOffsets[r]] ... groups[rowOffsets[r + 1] - 1] */
+struct GroupMembership
+{
+    std::size_t                 numGroups = 0;
+    std::vector<std::uint64_t>  rowOffsets;     // numRows + 1 entries
+    std::vector<std::uint32_t>  groups;
+
+    std::size_t numRows() const { return rowOffsets.empty() ? 0 : rowOffsets.size() - 1; }
+
+    /** Every row in at most one group, \p labels are group indices per row, negative for rows without a group */
+    static GroupMembership fromLabels(std::span<const std::int32_t> labels, std::size_t numGroups);
+
+    /** Every selection is a group, rows may be in several of them */
+    static GroupMembership fromSelections(std::size_t numRows, std::span<const RowIndices> selections);
+
+    /** Rows firstRow ... firstRow + numRows - 1 of sorted \p selections, numbered from 0 like the rows of a block */
+    static GroupMembership fromSelections(std::size_t firstRow, std::size_t numRows, std::span<const RowIndices> selections);
+};
+
+struct AggregationOptions
+{
+    std::size_t             numBins             = 64;       // histogram bins per group and dimension, spanning the range of the dimension
+    std::span<const float>  minValues;                      // per dimension, required
+    std::span<const float>  rescaleValues;                  // per dimension 1 / (max - min), required
+    float                   expressedThreshold  = 0.0f;     // values above count as expressed
+    bool                    normalizedThreshold = false;    // the threshold applies to min-max normalized values
+};
+
+/*  Mergeable per-group, per-dimension partial statistics
+    Sums and counts are exact, the distribution of the non-zero values is kept as a histogram
+    over the range of the dimension; zeros are only counted (count - nonZero).
+    Entries are stored per group: index = group * numDimensions + dimension.
+*/
+struct GroupAggregates
+{
+    std::size_t                 numGroups       = 0;
+    std::size_t                 numDimensions   = 0;
+    std::size_t                 numBins         = 0;
+    std::vector<float>          binMinimum;     // per dimension, lower edge of the first bin
+    std::vector<float>          binWidth;       // per dimension
+    std::vector<std::uint64_t>  count;          // rows per group
+    std::vector<double>         sum;
+    std::vector<double>         sumOfSquares;
+    std::vector<std::uint64_t>  nonZero;
+    std::vector<std::uint64_t>  expressed;
+    std::vector<std::uint32_t>  histogram;      // numBins entries per group and dimension
+
+    std::size_t index(std::size_t group, std::size_t dimension) const { return group * numDimensions + dimension; }
+    const std::uint32_t* bins(std::size_t group, std::size_t dimension) const { return histogram.data() + index(group, dimension) * numBins; }
+
+    /** Adds the statistics of \p other, which must have the same groups, dimensions and bins */
+    void merge(const GroupAggregates& other);
+
+    /** Adds or subtracts group \p otherGroup of \p other to or from \p group, the dimensions and bins must match */
+    void add(std::size_t group, const GroupAggregates& other, std::size_t otherGroup);
+    void subtract(std::size_t group, const GroupAggregates& other, std::size_t otherGroup);
+
+    /** Single-group aggregates of all groups together, rows in several groups are counted for each */
+    GroupAggregates combined() const;
+
+    /** Bytes the aggregates of \p numGroups groups occupy */
+    static std::uint64_t estimateBytes(std::size_t numGroups, std::size_t numDimensions, std::size_t numBins);
+};
+
+/*  Aggregates all groups of \p membership in one scan over \p matrix
+    Threads own blocks of dimensions, so no partial copies are needed; sparse rows are entered
+    at the first stored element of the block. Progress is reported in dimensions.
+*/
+template <typename Matrix>
+GroupAggregates aggregateGroups(const Matrix& matrix, const GroupMembership& membership, const AggregationOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** Aggregates without rows, binned for \p options */
+GroupAggregates emptyGroupAggregates(std::size_t numGroups, std::size_t numDimensions, const AggregationOptions& options);
+
+/*  Adds the grouped rows of \p matrix to \p aggregates, e.g. one block of rows of a larger matrix
+    \p membership numbers the rows like \p matrix. Call finishGroupAggregates after the last block.
+*/
+template <typename Matrix>
+void accumulateGroups(const Matrix& matrix, const GroupMembership& membership, const AggregationOptions& options, GroupAggregates& aggregates, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** Counts the zeros as expressed for a negative threshold, once all rows are accumulated */
+void finishGroupAggregates(GroupAggregates& aggregates, const AggregationOptions& options);
+
+/*  DE statistics of group \p groupA of \p aggregatesA against group \p groupB of \p aggregatesB
+    Means, SDs, % expressed and Welch's test are exact; medians, AUROC and rank-sum p-values are
+    derived from the histograms and are approximate within a bin width.
+*/
+DEResult compareGroups(const GroupAggregates& aggregatesA, std::size_t groupA, const GroupAggregates& aggregatesB, std::size_t groupB, const DEOptions& options);
+
+/** One-vs-rest DE statistics of every group against all other grouped rows */
+std::vector<DEResult> compareOneVsRest(const GroupAggregates& aggregates, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/*  DE statistics of every pair of groups, group i against group j for i < j
+    Results are ordered (0, 1), (0, 2), ..., (1, 2), ..., see pairIndex. Progress is reported in pairs.
+*/
+std::vector<DEResult> compareAllPairs(const GroupAggregates& aggregates, const DEOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** Position of the pair (\p groupA, \p groupB), groupA < groupB, in the results of compareAllPairs */
+inline std::size_t pairIndex(std::size_t groupA, std::size_t groupB, std::size_t numGroups)
+{
+    return groupA * (2 * numGroups - groupA - 1) / 2 + (groupB - groupA - 1);
+}
+
+} // namespace de
@@ -0,0 +1,77 @@
+#include "IncrementalAggregates.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace de
+{
+
+template <typename Matrix>
+std::size_t IncrementalAggregates::update(const Matrix& matrix, RowIndices rows, const AggregationOptions& options, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const bool sameBinning = !empty() && _aggregates.numDimensions == matrix.numColumns && _aggregates.numBins == std::max<std::size_t>(1, options.numBins)
+        && _expressedThreshold == options.expressedThreshold && _normalizedThreshold == options.normalizedThreshold;
+
+    std::vector<std::uint32_t> entered, left;
+    if (sameBinning)
+    {
+        std::set_difference(rows.begin(), rows.end(), _rows.begin(), _rows.end(), std::back_inserter(entered));
+        std::set_difference(_rows.begin(), _rows.end(), rows.begin(), rows.end(), std::back_inserter(left));
+    }
+
+    // the changed rows are scanned as two groups, which only pays off while they are fewer than the rows of the selection
+    const bool rescan = !sameBinning || _updates >= rescanInterval || entered.size() + left.size() >= rows.size();
+
+    GroupAggregates scanned;
+    if (rescan)
+    {
+        PerformanceTrace::Scope scope(trace, "Incremental aggregation (all rows)", "de");
+        const RowIndices selections[] = { rows };
+        scanned = aggregateGroups(matrix, GroupMembership::fromSelections(matrix.numRows, selections), options, progress, trace);
+    }
+    else
+    {
+        PerformanceTrace::Scope scope(trace, "Incremental aggregation (changed rows)", "de");
+        const RowIndices selections[] = { entered, left };
+        scanned = aggregateGroups(matrix, GroupMembership::fromSelections(matrix.numRows, selections), options, progress, trace);
+    }
+
+    if (progress && progress->canceled())
+    {
+        reset();
+        return 0;
+    }
+
+    if (rescan)
+    {
+        _aggregates = std::move(scanned);
+        _updates = 0;
+    }
+    else
+    {
+        _aggregates.add(0, scanned, 0);
+        _aggregates.subtract(0, scanned, 1);
+        ++_updates;
+    }
+
+    _rows.assign(rows.begin(), rows.end());
+    _expressedThreshold = options.expressedThreshold;
+    _normalizedThreshold = options.normalizedThreshold;
+
+    return rescan ? rows.size() : entered.size() + left.size();
+}
+
+void IncrementalAggregates::reset()
+{
+    _rows.clear();
+    _aggregates = {};
+    _updates = 0;
+}
+
+#define DE_INSTANTIATE_INCREMENTAL_AGGREGATES(T)                                                                                                               \
+    template std::size_t IncrementalAggregates::update(const DenseMatrixView<T>&, RowIndices, const AggregationOptions&, ProgressSink*, PerformanceTrace*);    \
+    template std::size_t IncrementalAggregates::update(const SparseMatrixView<T>&, RowIndices, const AggregationOptions&, ProgressSink*, PerformanceTrace*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_INCREMENTAL_AGGREGATES)
+
+} // namespace de
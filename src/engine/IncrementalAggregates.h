@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GroupStatistics.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace de
+{
+
+/*  Single-group aggregates of a selection that changes a little at a time, e.g. one that follows a brush
+    update scans only the rows that entered or left the selection since the previous update, in one scan, and
+    adds or subtracts their aggregates. The whole selection is scanned when most of it changed, when the binning
+    changed and every rescanInterval updates, so the floating-point sums do not drift from those of a scan of the
+    selection. Counts, expressed counts and histograms are exact either way. Not thread-safe.
+*/
+class IncrementalAggregates
+{
+public:
+    /** Updates at most between two scans of the whole selection */
+    static constexpr std::size_t rescanInterval = 64;
+
+    /*  Updates the aggregates to the sorted storage \p rows of \p matrix, binned for \p options
+        Call reset first if the values or the ranges of \p options changed. Returns the number of rows scanned;
+        a canceled update leaves no aggregates.
+    */
+    template <typename Matrix>
+    std::size_t update(const Matrix& matrix, RowIndices rows, const AggregationOptions& options, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+    /** Forgets the selection, the next update scans all of its rows */
+    void reset();
+
+    /** No update succeeded since the last reset */
+    bool empty() const { return _aggregates.numGroups == 0; }
+
+    /** Single-group aggregates of the rows of the last update */
+    const GroupAggregates& aggregates() const { return _aggregates; }
+
+    /** The rows of the last update */
+    RowIndices rows() const { return _rows; }
+
+private:
+    std::vector<std::uint32_t>  _rows;
+    GroupAggregates             _aggregates;
+    std::size_t                 _updates                = 0;        // since the last scan of the whole selection
+    float                       _expressedThreshold     = 0.0f;     // binning of the aggregates
+    bool                        _normalizedThreshold    = false;
+};
+
+} // namespace de
@@ -0,0 +1,281 @@
+#include "MatrixIO.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace de
+{
+
+namespace local
+{
+    constexpr char magic[4] = { 'D', 'E', 'M', 'X' };
+    constexpr std::uint32_t version = 1;
+
+    struct Header
+    {
+        char            magic[4];
+        std::uint32_t   version;
+        std::uint32_t   storage;
+        std::uint32_t   elementType;
+        std::uint64_t   numRows;
+        std::uint64_t   numColumns;
+        std::uint64_t   numNonZeros;
+    };
+
+    static_assert(sizeof(Header) == 40);
+
+    template <typename T>
+    void readArray(std::ifstream& file, std::vector<T>& array, std::size_t size, const std::string& filePath)
+    {
+        array.resize(size);
+        file.read(reinterpret_cast<char*>(array.data()), static_cast<std::streamsize>(size * sizeof(T)));
+        if (!file)
+            throw std::runtime_error("Unexpected end of matrix file " + filePath);
+    }
+
+    Header readHeader(std::ifstream& file, const std::string& filePath)
+    {
+        Header header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a DE matrix file: " + filePath);
+        if (header.version != version)
+            throw std::runtime_error("Unsupported DE matrix file version " + std::to_string(header.version));
+        if (header.storage > static_cast<std::uint32_t>(MatrixStorage::Sparse) || header.elementType > static_cast<std::uint32_t>(ElementType::BFloat16))
+            throw std::runtime_error("Unsupported storage or element type in " + filePath);
+
+        return header;
+    }
+
+    // Resizes a reused buffer, releasing it first if it has to grow, so the old and new buffer never coexist
+    template <typename T>
+    void resizeBuffer(std::vector<T>& buffer, std::size_t size)
+    {
+        if (size > buffer.capacity())
+            std::vector<T>().swap(buffer);
+        buffer.resize(size);
+    }
+
+    template <typename T>
+    void readAt(std::ifstream& file, std::uint64_t position, T* data, std::size_t size, const std::string& filePath)
+    {
+        file.seekg(static_cast<std::streamoff>(position));
+        file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size * sizeof(T)));
+        if (!file)
+            throw std::runtime_error("Unexpected end of matrix file " + filePath);
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& file, const std::vector<T>& array)
+    {
+        file.write(reinterpret_cast<const char*>(array.data()), static_cast<std::streamsize>(array.size() * sizeof(T)));
+    }
+}
+
+MatrixData readMatrix(const std::string& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot open matrix file " + filePath);
+
+    const local::Header header = local::readHeader(file, filePath);
+
+    MatrixData matrix;
+    matrix.storage = static_cast<MatrixStorage>(header.storage);
+    matrix.elementType = static_cast<ElementType>(header.elementType);
+    matrix.numRows = header.numRows;
+    matrix.numColumns = header.numColumns;
+
+    const std::size_t valueSize = elementSize(matrix.elementType);
+
+    if (matrix.storage == MatrixStorage::Dense)
+    {
+        local::readArray(file, matrix.values, matrix.numRows * matrix.numColumns * valueSize, filePath);
+    }
+    else
+    {
+        local::readArray(file, matrix.rowOffsets, matrix.numRows + 1, filePath);
+        local::readArray(file, matrix.columnIndices, header.numNonZeros, filePath);
+        local::readArray(file, matrix.values, header.numNonZeros * valueSize, filePath);
+
+        if (matrix.rowOffsets.front() != 0 || matrix.rowOffsets.back() != header.numNonZeros)
+            throw std::runtime_error("Inconsistent row offsets in " + filePath);
+        for (std::size_t r = 0; r < matrix.numRows; ++r)
+            if (matrix.rowOffsets[r] > matrix.rowOffsets[r + 1])
+                throw std::runtime_error("Inconsistent row offsets in " + filePath);
+        for (const std::uint32_t column : matrix.columnIndices)
+            if (column >= matrix.numColumns)
+                throw std::runtime_error("Column index out of range in " + filePath);
+    }
+
+    return matrix;
+}
+
+void writeMatrix(const std::string& filePath, const MatrixData& matrix)
+{
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Cannot open matrix file " + filePath + " for writing");
+
+    local::Header header = {};
+    std::memcpy(header.magic, local::magic, sizeof(local::magic));
+    header.version = local::version;
+    header.storage = static_cast<std::uint32_t>(matrix.storage);
+    header.elementType = static_cast<std::uint32_t>(matrix.elementType);
+    header.numRows = matrix.numRows;
+    header.numColumns = matrix.numColumns;
+    header.numNonZeros = matrix.storage == MatrixStorage::Sparse ? matrix.columnIndices.size() : 0;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (matrix.storage == MatrixStorage::Sparse)
+    {
+        local::writeArray(file, matrix.rowOffsets);
+        local::writeArray(file, matrix.columnIndices);
+    }
+    local::writeArray(file, matrix.values);
+
+    if (!file)
+        throw std::runtime_error("Failed writing matrix file " + filePath);
+}
+
+MatrixFileReader::MatrixFileReader(const std::string& filePath) :
+    _filePath(filePath),
+    _file(filePath, std::ios::binary)
+{
+    if (!_file)
+        throw std::runtime_error("Cannot open matrix file " + filePath);
+
+    const local::Header header = local::readHeader(_file, filePath);
+    _storage = static_cast<MatrixStorage>(header.storage);
+    _elementType = static_cast<ElementType>(header.elementType);
+    _numRows = header.numRows;
+    _numColumns = header.numColumns;
+    _numNonZeros = header.numNonZeros;
+}
+
+void MatrixFileReader::readRowOffsets(std::size_t firstRow, std::size_t count, std::vector<std::uint64_t>& offsets)
+{
+    local::resizeBuffer(offsets, count);
+    local::readAt(_file, sizeof(local::Header) + firstRow * sizeof(std::uint64_t), offsets.data(), count, _filePath);
+}
+
+std::size_t MatrixFileReader::rowsWithin(std::size_t firstRow, std::uint64_t bytes, std::uint64_t bytesPerRow)
+{
+    if (firstRow >= _numRows)
+        return 0;
+
+    const std::size_t valueSize = elementSize(_elementType);
+
+    if (_storage == MatrixStorage::Dense)
+        return static_cast<std::size_t>(std::min<std::uint64_t>(_numRows - firstRow, bytes / (_numColumns * valueSize + bytesPerRow)));
+
+    // sparse rows differ in size, walk their offsets in pieces
+    constexpr std::size_t pieceSize = 4096;
+    const std::uint64_t elementBytes = sizeof(std::uint32_t) + valueSize;
+
+    std::uint64_t used = sizeof(std::uint64_t);    // the leading row offset of the block
+    std::size_t numRows = 0;
+
+    for (std::size_t pieceRow = firstRow; pieceRow < _numRows; pieceRow += pieceSize - 1)
+    {
+        const std::size_t count = std::min(pieceSize, _numRows + 1 - pieceRow);
+        readRowOffsets(pieceRow, count, _offsets);
+
+        for (std::size_t i = 1; i < count; ++i)
+        {
+            used += sizeof(std::uint64_t) + bytesPerRow + (_offsets[i] - _offsets[i - 1]) * elementBytes;
+            if (used > bytes)
+                return numRows;
+            ++numRows;
+        }
+    }
+
+    return numRows;
+}
+
+void MatrixFileReader::readRows(std::size_t firstRow, std::size_t numRows, MatrixData& block)
+{
+    if (firstRow + numRows > _numRows)
+        throw std::runtime_error("Rows out of range of matrix file " + _filePath);
+
+    const std::size_t valueSize = elementSize(_elementType);
+
+    block.storage = _storage;
+    block.elementType = _elementType;
+    block.numRows = numRows;
+    block.numColumns = _numColumns;
+
+    if (_storage == MatrixStorage::Dense)
+    {
+        const std::uint64_t rowBytes = static_cast<std::uint64_t>(_numColumns) * valueSize;
+        local::resizeBuffer(block.values, numRows * rowBytes);
+        local::readAt(_file, sizeof(local::Header) + firstRow * rowBytes, block.values.data(), block.values.size(), _filePath);
+        return;
+    }
+
+    readRowOffsets(firstRow, numRows + 1, block.rowOffsets);
+
+    const std::uint64_t first = block.rowOffsets.front();
+    const std::uint64_t numElements = block.rowOffsets.back() - first;
+    for (std::size_t r = 0; r < numRows; ++r)
+        if (block.rowOffsets[r] > block.rowOffsets[r + 1])
+            throw std::runtime_error("Inconsistent row offsets in " + _filePath);
+    if (block.rowOffsets.back() > _numNonZeros)
+        throw std::runtime_error("Inconsistent row offsets in " + _filePath);
+
+    for (auto& offset : block.rowOffsets)
+        offset -= first;
+
+    const std::uint64_t columnsStart = sizeof(local::Header) + (_numRows + 1) * sizeof(std::uint64_t);
+    const std::uint64_t valuesStart = columnsStart + _numNonZeros * sizeof(std::uint32_t);
+
+    local::resizeBuffer(block.columnIndices, numElements);
+    local::readAt(_file, columnsStart + first * sizeof(std::uint32_t), block.columnIndices.data(), numElements, _filePath);
+
+    local::resizeBuffer(block.values, numElements * valueSize);
+    local::readAt(_file, valuesStart + first * valueSize, block.values.data(), block.values.size(), _filePath);
+
+    for (const std::uint32_t column : block.columnIndices)
+        if (column >= _numColumns)
+            throw std::runtime_error("Column index out of range in " + _filePath);
+}
+
+std::vector<std::uint32_t> readIndices(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if (!file)
+        throw std::runtime_error("Cannot open index file " + filePath);
+
+    std::vector<std::uint32_t> indices;
+    std::uint64_t index;
+    while (file >> index)
+        indices.push_back(static_cast<std::uint32_t>(index));
+
+    if (!file.eof())
+        throw std::runtime_error("Malformed index file " + filePath);
+
+    return indices;
+}
+
+std::vector<std::string> readNames(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if (!file)
+        throw std::runtime_error("Cannot open names file " + filePath);
+
+    std::vector<std::string> names;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        names.push_back(line);
+    }
+
+    return names;
+}
+
+} // namespace de
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "MatrixView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace de
+{
+
+enum class MatrixStorage : std::uint32_t
+{
+    Dense   = 0,
+    Sparse  = 1,    // compressed sparse rows
+};
+
+/*  Owning matrix as read from (or written to) a binary matrix file
+
+    File layout, all numbers little-endian:
+        char[4]     magic "DEMX"
+        uint32      version (1)
+        uint32      storage (MatrixStorage)
+        uint32      element type (ElementType)
+        uint64      number of rows
+        uint64      number of columns
+        uint64      number of stored elements (sparse only, 0 for dense)
+    followed for dense matrices by
+        rows * columns elements, row-major
+    and for sparse matrices by
+        (rows + 1) uint64 row offsets, nnz uint32 column indices, nnz elements
+*/
+struct MatrixData
+{
+    MatrixStorage               storage         = MatrixStorage::Dense;
+    ElementType                 elementType     = ElementType::Float32;
+    std::size_t                 numRows         = 0;
+    std::size_t                 numColumns      = 0;
+    std::vector<std::byte>      values;
+    std::vector<std::uint64_t>  rowOffsets;         // sparse only
+    std::vector<std::uint32_t>  columnIndices;      // sparse only
+
+    /** Bytes of the values and, for sparse matrices, of the row offsets and column indices */
+    std::uint64_t bytes() const { return values.size() + rowOffsets.size() * sizeof(std::uint64_t) + columnIndices.size() * sizeof(std::uint32_t); }
+
+    /** Calls functionObject with the DenseMatrixView<T> or SparseMatrixView<T> matching storage and element type */
+    template <typename FunctionObject>
+    decltype(auto) visit(FunctionObject&& functionObject) const
+    {
+        return visitElementType(elementType, [this, &functionObject](auto element) -> decltype(auto) {
+            using T = decltype(element);
+            const T* typedValues = reinterpret_cast<const T*>(values.data());
+
+            if (storage == MatrixStorage::Sparse)
+                return functionObject(SparseMatrixView<T>{ rowOffsets.data(), columnIndices.data(), typedValues, numRows, numColumns });
+
+            return functionObject(DenseMatrixView<T>{ typedValues, numRows, numColumns });
+            });
+    }
+};
+
+/** Throws std::runtime_error if the file cannot be read or is malformed */
+MatrixData readMatrix(const std::string& filePath);
+
+/** Throws std::runtime_error if the file cannot be written */
+void writeMatrix(const std::string& filePath, const MatrixData& matrix);
+
+/*  Reads blocks of rows of a matrix file, for matrices that do not fit in memory
+    Only the header is read on construction. Block buffers are reused and only grow when a
+    larger block is read, after releasing the previous buffer.
+*/
+class MatrixFileReader
+{
+public:
+    /** Throws std::runtime_error if the file cannot be opened or is malformed */
+    explicit MatrixFileReader(const std::string& filePath);
+
+    MatrixStorage storage() const { return _storage; }
+    ElementType elementType() const { return _elementType; }
+    std::size_t numRows() const { return _numRows; }
+    std::size_t numColumns() const { return _numColumns; }
+
+    /** Number of rows from \p firstRow on that, read into a block with \p bytesPerRow extra each, fit in \p bytes; 0 if not even one does */
+    std::size_t rowsWithin(std::size_t firstRow, std::uint64_t bytes, std::uint64_t bytesPerRow = 0);
+
+    /** Reads rows firstRow ... firstRow + numRows - 1 into \p block, its row offsets start at 0; throws std::runtime_error on failure */
+    void readRows(std::size_t firstRow, std::size_t numRows, MatrixData& block);
+
+private:
+    void readRowOffsets(std::size_t firstRow, std::size_t count, std::vector<std::uint64_t>& offsets);
+
+private:
+    std::string                 _filePath;
+    std::ifstream               _file;
+    MatrixStorage               _storage        = MatrixStorage::Dense;
+    ElementType                 _elementType    = ElementType::Float32;
+    std::size_t                 _numRows        = 0;
+    std::size_t                 _numColumns     = 0;
+    std::uint64_t               _numNonZeros    = 0;
+    std::vector<std::uint64_t>  _offsets;           // piece of the row offsets, read by rowsWithin
+};
+
+/** Reads whitespace separated row indices, throws std::runtime_error on failure */
+std::vector<std::uint32_t> readIndices(const std::string& filePath);
+
+/** Reads one (dimension) name per line, throws std::runtime_error on failure */
+std::vector<std::string> readNames(const std::string& filePath);
+
+} // namespace de
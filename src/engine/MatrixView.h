@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ElementTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace de
+{
+
+/** Indices of matrix rows (e.g. cells), sorted and unique unless stated otherwise */
+using RowIndices = std::span<const std::uint32_t>;
+
+/** Non-owning view of a row-major (rows x columns) matrix, e.g. cells x genes */
+template <typename T>
+struct DenseMatrixView
+{
+    using value_type = T;
+
+    const T*        data        = nullptr;
+    std::size_t     numRows     = 0;
+    std::size_t     numColumns  = 0;
+
+    const T* row(std::size_t r) const { return data + r * numColumns; }
+};
+
+/** Non-owning view of a compressed sparse row (CSR) matrix, elements that are not stored are zero */
+template <typename T>
+struct SparseMatrixView
+{
+    using value_type = T;
+
+    const std::uint64_t*    rowOffsets      = nullptr;  // numRows + 1 entries
+    const std::uint32_t*    columnIndices   = nullptr;  // rowOffsets[numRows] entries, sorted per row
+    const T*                values          = nullptr;  // rowOffsets[numRows] entries
+    std::size_t             numRows         = 0;
+    std::size_t             numColumns      = 0;
+
+    std::size_t numNonZeros() const { return numRows == 0 ? 0 : static_cast<std::size_t>(rowOffsets[numRows] - rowOffsets[0]); }
+};
+
+/** View of rows firstRow ... firstRow + numRows - 1 */
+template <typename T>
+DenseMatrixView<T> rowBlock(const DenseMatrixView<T>& matrix, std::size_t firstRow, std::size_t numRows)
+{
+    return { matrix.row(firstRow), numRows, matrix.numColumns };
+}
+
+/** View of rows firstRow ... firstRow + numRows - 1, the row offsets keep indexing the full arrays */
+template <typename T>
+SparseMatrixView<T> rowBlock(const SparseMatrixView<T>& matrix, std::size_t firstRow, std::size_t numRows)
+{
+    return { matrix.rowOffsets + firstRow, matrix.columnIndices, matrix.values, numRows, matrix.numColumns };
+}
+
+template <typename Matrix>
+inline constexpr bool isSparseMatrix = false;
+
+template <typename T>
+inline constexpr bool isSparseMatrix<SparseMatrixView<T>> = true;
+
+/** Expands MACRO(T) for every element type the engine is instantiated for */
+#define DE_FOR_ALL_ELEMENT_TYPES(MACRO) \
+    MACRO(float)                        \
+    MACRO(de::BFloat16)                 \
+    MACRO(std::uint16_t)                \
+    MACRO(std::int16_t)                 \
+    MACRO(std::uint8_t)                 \
+    MACRO(std::int8_t)
+
+} // namespace de
@@ -0,0 +1,177 @@
+#include "PerformanceTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace de
+{
+
+namespace local
+{
+    static std::string jsonEscape(const std::string& text)
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (const char c : text)
+        {
+            switch (c)
+            {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    result += buffer;
+                }
+                else
+                    result += c;
+            }
+        }
+        return result;
+    }
+}
+
+PerformanceTrace::Scope::Scope(PerformanceTrace* trace, const char* name, const char* category, std::uint64_t bytes, bool replace) :
+    _trace(trace),
+    _name(name),
+    _category(category),
+    _bytes(bytes),
+    _replace(replace),
+    _start(Clock::now())
+{
+}
+
+PerformanceTrace::Scope::~Scope()
+{
+    if (_trace)
+        _trace->record(_name, _category, _start, Clock::now(), _bytes, _replace);
+}
+
+PerformanceTrace::PerformanceTrace() :
+    _origin(Clock::now())
+{
+}
+
+void PerformanceTrace::reset(const std::string& runName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _runName = runName;
+    _origin = Clock::now();
+    _events.clear();
+}
+
+void PerformanceTrace::record(const char* name, const char* category, Clock::time_point start, Clock::time_point end, std::uint64_t bytes, bool replace)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Event event;
+    event.name          = name;
+    event.category      = category;
+    event.startUs       = std::chrono::duration_cast<std::chrono::microseconds>(start - _origin).count();
+    event.durationUs    = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    event.bytes         = bytes;
+    event.threadId      = threadIndex(std::this_thread::get_id());
+
+    if (replace)
+        _events.erase(std::remove_if(_events.begin(), _events.end(), [&event](const Event& other) { return other.name == event.name; }), _events.end());
+
+    _events.push_back(std::move(event));
+}
+
+std::vector<PerformanceTrace::Event> PerformanceTrace::events() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _events;
+}
+
+std::string PerformanceTrace::summary() const
+{
+    std::vector<Event> sortedEvents = events();
+    std::stable_sort(sortedEvents.begin(), sortedEvents.end(), [](const Event& a, const Event& b) { return a.startUs < b.startUs; });
+
+    std::ostringstream stream;
+    stream.setf(std::ios::fixed);
+    stream.precision(1);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        stream << _runName;
+    }
+
+    for (const auto& event : sortedEvents)
+    {
+        stream << "\n" << event.name << ": " << event.durationUs / 1000.0 << " ms";
+        if (event.bytes > 0)
+        {
+            stream << ", " << formatBytes(event.bytes);
+            if (event.durationUs > 0)
+                stream << " (" << formatBytes(static_cast<std::uint64_t>(event.bytes * 1e6 / event.durationUs)) << "/s)";
+        }
+    }
+
+    return stream.str();
+}
+
+bool PerformanceTrace::writeChromeTrace(const std::string& filePath) const
+{
+    std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+    if (!file)
+        return false;
+
+    const std::vector<Event> allEvents = events();
+
+    file << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < allEvents.size(); ++i)
+    {
+        const Event& event = allEvents[i];
+        if (i != 0)
+            file << ",";
+        file << "\n{\"name\":\"" << local::jsonEscape(event.name) << "\""
+             << ",\"cat\":\"" << local::jsonEscape(event.category) << "\""
+             << ",\"ph\":\"X\",\"pid\":1"
+             << ",\"tid\":" << event.threadId
+             << ",\"ts\":" << event.startUs
+             << ",\"dur\":" << event.durationUs
+             << ",\"args\":{\"bytes\":" << event.bytes << "}}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return static_cast<bool>(file);
+}
+
+std::string PerformanceTrace::formatBytes(std::uint64_t bytes)
+{
+    constexpr const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+
+    double value = static_cast<double>(bytes);
+    std::size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < std::size(units))
+    {
+        value /= 1024.0;
+        ++unit;
+    }
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+    return buffer;
+}
+
+std::uint32_t PerformanceTrace::threadIndex(std::thread::id id)
+{
+    // caller holds _mutex
+    const auto found = _threadIds.find(id);
+    if (found != _threadIds.end())
+        return found->second;
+
+    const auto index = static_cast<std::uint32_t>(_threadIds.size());
+    _threadIds.emplace(id, index);
+    return index;
+}
+
+} // namespace de
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace de
+{
+
+/*  Collects per-phase timings and byte counts of a DE run
+    Phases are recorded with the RAII PerformanceTrace::Scope, which is cheap enough for
+    coarse phases (gather, medians, table building, ...) but should not be used per element.
+    The result can be shown as a compact summary or written as Chrome trace-event JSON,
+    which can be opened in chrome://tracing or https://ui.perfetto.dev
+*/
+class PerformanceTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        std::string     name;
+        std::string     category;
+        std::int64_t    startUs     = 0;    // relative to the start of the trace
+        std::int64_t    durationUs  = 0;
+        std::uint64_t   bytes       = 0;    // bytes read, written or allocated by the phase
+        std::uint32_t   threadId    = 0;
+    };
+
+    class Scope
+    {
+    public:
+        /** With \p replace the event replaces the previous one of the same name, see record */
+        Scope(PerformanceTrace* trace, const char* name, const char* category = "de", std::uint64_t bytes = 0, bool replace = false);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(std::uint64_t bytes) { _bytes += bytes; }
+
+    private:
+        PerformanceTrace*   _trace;
+        const char*         _name;
+        const char*         _category;
+        std::uint64_t       _bytes;
+        bool                _replace;
+        Clock::time_point   _start;
+    };
+
+public:
+    PerformanceTrace();
+
+    /** Drop all events and restart the clock, \p runName labels the summary */
+    void reset(const std::string& runName);
+
+    /*  Thread-safe
+        With \p replace the event replaces the previous one of the same name, e.g. for interactions repeated between runs
+        such as sorting the table, so they do not pile up until the next reset.
+    */
+    void record(const char* name, const char* category, Clock::time_point start, Clock::time_point end, std::uint64_t bytes, bool replace = false);
+
+    std::vector<Event> events() const;
+
+    /** One line per recorded phase: name, duration and bytes */
+    std::string summary() const;
+
+    /** Write all events as Chrome trace-event JSON, returns false if the file cannot be written */
+    bool writeChromeTrace(const std::string& filePath) const;
+
+    static std::string formatBytes(std::uint64_t bytes);
+
+private:
+    std::uint32_t threadIndex(std::thread::id id);
+
+private:
+    mutable std::mutex                                  _mutex;
+    std::string                                         _runName;
+    Clock::time_point                                   _origin;
+    std::vector<Event>                                  _events;
+    std::unordered_map<std::thread::id, std::uint32_t>  _threadIds;
+};
+
+} // namespace de
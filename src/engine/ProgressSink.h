@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace de
+{
+
+/*  Receiver of progress reports of long-running engine functions
+    advance() is called from worker threads, so implementations must be thread-safe and cheap.
+*/
+class ProgressSink
+{
+public:
+    virtual ~ProgressSink() = default;
+
+    /** Mark a number of work items (rows, dimensions, ...) as done */
+    virtual void advance(std::uint64_t steps) = 0;
+
+    /** Engine functions stop early, with an incomplete result, if this returns true */
+    virtual bool canceled() const { return false; }
+};
+
+} // namespace de
@@ -0,0 +1,141 @@
+#include "ProgressiveStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace de
+{
+
+namespace local
+{
+    // Rank uncertainty of every dimension from the confidence intervals of all dimensions, in descending order of DE
+    std::vector<std::uint8_t> rankStability(const std::vector<float>& low, const std::vector<float>& high, double rankTolerance)
+    {
+        const std::size_t numDimensions = low.size();
+
+        std::vector<float> sortedLow(low), sortedHigh(high);
+        std::sort(sortedLow.begin(), sortedLow.end());
+        std::sort(sortedHigh.begin(), sortedHigh.end());
+
+        const auto tolerance = static_cast<std::size_t>(rankTolerance * numDimensions);
+
+        std::vector<std::uint8_t> stable(numDimensions);
+        for (std::size_t d = 0; d < numDimensions; ++d)
+        {
+            // dimensions certainly ranked above d, and those that may be
+            const std::size_t certainlyAbove = sortedLow.end() - std::upper_bound(sortedLow.begin(), sortedLow.end(), high[d]);
+            std::size_t possiblyAbove = sortedHigh.end() - std::upper_bound(sortedHigh.begin(), sortedHigh.end(), low[d]);
+            if (high[d] > low[d])
+                --possiblyAbove;
+
+            stable[d] = possiblyAbove - std::min(possiblyAbove, certainlyAbove) <= tolerance;
+        }
+
+        return stable;
+    }
+}
+
+std::size_t ProgressiveResult::numStable() const
+{
+    return static_cast<std::size_t>(std::count(rankStable.begin(), rankStable.end(), std::uint8_t(1)));
+}
+
+std::vector<std::pair<std::size_t, std::size_t>> progressiveSampleSizes(std::size_t sizeA, std::size_t sizeB, const ProgressiveOptions& options)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> sizes;
+
+    const std::size_t growth = std::max<std::size_t>(2, options.growthFactor);
+    for (std::size_t sampleSize = std::max<std::size_t>(1, options.initialSampleSize); sampleSize < std::max(sizeA, sizeB); sampleSize *= growth)
+        sizes.emplace_back(std::min(sampleSize, sizeA), std::min(sampleSize, sizeB));
+
+    sizes.emplace_back(sizeA, sizeB);
+
+    return sizes;
+}
+
+std::vector<std::uint32_t> stratifiedSample(RowIndices selection, std::size_t sampleSize, std::uint64_t seed)
+{
+    if (sampleSize >= selection.size())
+        return { selection.begin(), selection.end() };
+
+    std::mt19937_64 generator(seed);
+
+    std::vector<std::uint32_t> sample(sampleSize);
+    for (std::size_t stratum = 0; stratum < sampleSize; ++stratum)
+    {
+        const std::size_t first = stratum * selection.size() / sampleSize;
+        const std::size_t last = (stratum + 1) * selection.size() / sampleSize;
+        sample[stratum] = selection[std::uniform_int_distribution<std::size_t>(first, last - 1)(generator)];
+    }
+
+    return sample;
+}
+
+template <typename Matrix>
+ProgressiveResult computeProgressiveRound(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, std::size_t sampleSizeA, std::size_t sampleSizeB, const DEOptions& options, const DEPlan& plan,
+                                          const ProgressiveOptions& progressiveOptions, ProgressSink* progress, PerformanceTrace* trace, const Matrix* transposed)
+{
+    ProgressiveResult round;
+
+    std::vector<std::uint32_t> sampleA, sampleB;
+    {
+        PerformanceTrace::Scope scope(trace, "Stratified samples", "de");
+        sampleA = stratifiedSample(selectionA, sampleSizeA, progressiveOptions.seed);
+        sampleB = stratifiedSample(selectionB, sampleSizeB, progressiveOptions.seed + 1);
+    }
+
+    round.sampleSizeA = sampleA.size();
+    round.sampleSizeB = sampleB.size();
+    round.exact = round.sampleSizeA == selectionA.size() && round.sampleSizeB == selectionB.size();
+
+    // the intervals need the SDs
+    DEOptions roundOptions = options;
+    roundOptions.additionalStatistics = true;
+
+    round.result = computeDifferentialExpressionPlanned(matrix, sampleA, sampleB, roundOptions, plan, progress, trace, transposed);
+
+    const std::size_t numDimensions = round.result.numDimensions();
+    round.deLow.resize(numDimensions);
+    round.deHigh.resize(numDimensions);
+
+    {
+        PerformanceTrace::Scope scope(trace, "Confidence intervals and rank stability", "de");
+
+        const double sizeA = static_cast<double>(selectionA.size());
+        const double sizeB = static_cast<double>(selectionB.size());
+        const double nA = static_cast<double>(round.sampleSizeA);
+        const double nB = static_cast<double>(round.sampleSizeB);
+
+        for (std::size_t d = 0; d < numDimensions; ++d)
+        {
+            const double sdA = round.result.sdA[d];
+            const double sdB = round.result.sdB[d];
+            const double standardError = std::sqrt(sdA * sdA / nA * (1.0 - nA / sizeA) + sdB * sdB / nB * (1.0 - nB / sizeB));
+            const double halfWidth = progressiveOptions.z * standardError;
+
+            round.deLow[d] = static_cast<float>(round.result.de(d) - halfWidth);
+            round.deHigh[d] = static_cast<float>(round.result.de(d) + halfWidth);
+        }
+
+        round.rankStable = local::rankStability(round.deLow, round.deHigh, progressiveOptions.rankTolerance);
+    }
+
+    if (!options.additionalStatistics)
+    {
+        round.result.sdA.clear();
+        round.result.sdB.clear();
+        round.result.pctExpressedA.clear();
+        round.result.pctExpressedB.clear();
+    }
+
+    return round;
+}
+
+#define DE_INSTANTIATE_PROGRESSIVE_STATISTICS(T)                                                                                                                                                   \
+    template ProgressiveResult computeProgressiveRound(const DenseMatrixView<T>&, RowIndices, RowIndices, std::size_t, std::size_t, const DEOptions&, const DEPlan&, const ProgressiveOptions&, ProgressSink*, PerformanceTrace*, const DenseMatrixView<T>*);  \
+    template ProgressiveResult computeProgressiveRound(const SparseMatrixView<T>&, RowIndices, RowIndices, std::size_t, std::size_t, const DEOptions&, const DEPlan&, const ProgressiveOptions&, ProgressSink*, PerformanceTrace*, const SparseMatrixView<T>*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_PROGRESSIVE_STATISTICS)
+
+} // namespace de
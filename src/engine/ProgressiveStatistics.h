@@ -0,0 +1,58 @@
+#pragma once
+
+#include "DifferentialExpression.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+#include "StrategyPlanner.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace de
+{
+
+struct ProgressiveOptions
+{
+    std::size_t     initialSampleSize   = 1024;     // items per selection in the first round
+    std::size_t     growthFactor        = 8;        // sample growth from round to round
+    double          z                   = 1.96;     // of the confidence intervals, 1.96 for 95%
+    double          rankTolerance       = 0.01;     // fraction of the dimensions by which a stable rank may still change
+    std::uint64_t   seed                = 1;
+};
+
+/** Statistics of one round of a progressive run, computed from stratified samples of both selections */
+struct ProgressiveResult
+{
+    DEResult                    result;                 // of the samples, with the options of the run
+    std::size_t                 sampleSizeA     = 0;
+    std::size_t                 sampleSizeB     = 0;
+    bool                        exact           = false;    // the samples are the full selections
+    std::vector<float>          deLow, deHigh;          // confidence interval of the DE per dimension
+    std::vector<std::uint8_t>   rankStable;             // 1 if the rank of the DE is known within the rank tolerance
+
+    std::size_t numStable() const;
+};
+
+/** Sample sizes of the rounds, growing until the last round takes both selections completely */
+std::vector<std::pair<std::size_t, std::size_t>> progressiveSampleSizes(std::size_t sizeA, std::size_t sizeB, const ProgressiveOptions& options);
+
+/*  Sorted random sample of \p sampleSize rows of \p selection
+    The selection is split into sampleSize strata of consecutive rows, one row is drawn from each,
+    so every part of the selection (e.g. batches stored one after the other) is represented.
+*/
+std::vector<std::uint32_t> stratifiedSample(RowIndices selection, std::size_t sampleSize, std::uint64_t seed);
+
+/*  One round of a progressive run: the strategy of \p plan on samples of \p sampleSizeA and \p sampleSizeB rows
+    The confidence interval of the DE follows from the sample SDs with the finite population
+    correction, so it collapses to the DE once the samples are the full selections. A rank is
+    stable if the confidence intervals of the other dimensions leave it at most rankTolerance * numColumns
+    positions of uncertainty. Medians and tests are those of the samples, without intervals.
+    \p transposed is passed on to computeDifferentialExpressionPlanned.
+*/
+template <typename Matrix>
+ProgressiveResult computeProgressiveRound(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, std::size_t sampleSizeA, std::size_t sampleSizeB, const DEOptions& options, const DEPlan& plan,
+                                          const ProgressiveOptions& progressiveOptions, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr, const Matrix* transposed = nullptr);
+
+} // namespace de
@@ -0,0 +1,155 @@
+#include "ResultTable.h"
+
+#include <cmath>
+
+namespace de
+{
+
+std::vector<ResultColumn> resultColumns(bool additionalStatistics, bool statisticalTests)
+{
+    std::vector<ResultColumn> columns = {
+        { "DE",                 ResultStatistics::Means,    nullptr },
+        { "Mean (Sel. 1)",      ResultStatistics::Means,    &DEResult::meanA },
+        { "Mean (Sel. 2)",      ResultStatistics::Means,    &DEResult::meanB },
+        { "Median (Sel. 1)",    ResultStatistics::Medians,  &DEResult::medianA },
+        { "Median (Sel. 2)",    ResultStatistics::Medians,  &DEResult::medianB },
+    };
+
+    if (additionalStatistics)
+    {
+        columns.insert(columns.end(), {
+            { "SD (Sel. 1)",            ResultStatistics::Additional,   &DEResult::sdA },
+            { "SD (Sel. 2)",            ResultStatistics::Additional,   &DEResult::sdB },
+            { "% Expressed (Sel. 1)",   ResultStatistics::Additional,   &DEResult::pctExpressedA },
+            { "% Expressed (Sel. 2)",   ResultStatistics::Additional,   &DEResult::pctExpressedB },
+            });
+    }
+
+    if (statisticalTests)
+    {
+        columns.insert(columns.end(), {
+            { "t (Welch)",          ResultStatistics::Tests,    &DEResult::welchT },
+            { "p (Welch)",          ResultStatistics::Tests,    &DEResult::welchP,              true },
+            { "Adj. p (Welch)",     ResultStatistics::Tests,    &DEResult::welchAdjustedP,      true },
+            { "AUROC",              ResultStatistics::Tests,    &DEResult::auroc },
+            { "p (Wilcoxon)",       ResultStatistics::Tests,    &DEResult::wilcoxonP,           true },
+            { "Adj. p (Wilcoxon)",  ResultStatistics::Tests,    &DEResult::wilcoxonAdjustedP,   true },
+            });
+    }
+
+    return columns;
+}
+
+std::vector<std::string> resultColumnNames(bool additionalStatistics, bool statisticalTests)
+{
+    std::vector<std::string> names = { "ID" };
+    for (const ResultColumn& column : resultColumns(additionalStatistics, statisticalTests))
+        names.push_back(column.name);
+
+    return names;
+}
+
+bool hasStatistics(const DEResult& result, ResultStatistics statistics)
+{
+    switch (statistics)
+    {
+    case ResultStatistics::Means:       return true;
+    case ResultStatistics::Medians:     return result.hasMedians();
+    case ResultStatistics::Additional:  return result.hasAdditionalStatistics();
+    case ResultStatistics::Tests:       return result.hasStatisticalTests();
+    }
+    return false;
+}
+
+void requestStatistics(DEOptions& options, ResultStatistics statistics)
+{
+    switch (statistics)
+    {
+    case ResultStatistics::Means:
+        break;
+    case ResultStatistics::Medians:
+        options.medians = true;
+        break;
+    case ResultStatistics::Additional:
+        options.additionalStatistics = true;
+        break;
+    case ResultStatistics::Tests:
+        options.statisticalTests = true;
+        break;
+    }
+}
+
+float roundTo(float value, int decimals)
+{
+    const double scale = std::pow(10., decimals);
+    return static_cast<float>(std::floor(value * scale + 0.5) / scale);
+}
+
+namespace local
+{
+    // the columns of the statistics that result holds
+    std::vector<ResultColumn> heldColumns(const DEResult& result)
+    {
+        std::vector<ResultColumn> columns = resultColumns(result.hasAdditionalStatistics(), result.hasStatisticalTests());
+        std::erase_if(columns, [&result](const ResultColumn& column) { return !hasStatistics(result, column.statistics); });
+        return columns;
+    }
+
+    void writeHeader(std::ostream& output, std::span<const ResultColumn> columns, char separator, bool grouped)
+    {
+        if (grouped)
+            output << "\"Group\"" << separator;
+
+        output << "\"ID\"";
+        for (const ResultColumn& column : columns)
+            output << separator << '"' << column.name << '"';
+        output << '\n';
+    }
+
+    void writeRows(std::ostream& output, const DEResult& result, std::span<const ResultColumn> columns, std::span<const std::string> dimensionNames, const std::string* groupName, char separator, int decimals)
+    {
+        for (std::size_t d = 0; d < result.numDimensions(); ++d)
+        {
+            if (groupName)
+                output << *groupName << separator;
+
+            const std::size_t dimension = result.dimension(d);
+            if (dimension < dimensionNames.size())
+                output << dimensionNames[dimension];
+            else
+                output << "Dim " << dimension;
+
+            // rounding would turn small p-values into zeros
+            for (const ResultColumn& column : columns)
+            {
+                const float value = column.value(result, d);
+                output << separator << (column.probability ? value : roundTo(value, decimals));
+            }
+
+            output << '\n';
+        }
+    }
+}
+
+void writeResultTable(std::ostream& output, const DEResult& result, std::span<const std::string> dimensionNames, char separator, int decimals)
+{
+    const std::vector<ResultColumn> columns = local::heldColumns(result);
+    local::writeHeader(output, columns, separator, false);
+    local::writeRows(output, result, columns, dimensionNames, nullptr, separator, decimals);
+}
+
+void writeGroupedResultTable(std::ostream& output, std::span<const DEResult> results, std::span<const std::string> groupNames, std::span<const std::string> dimensionNames, char separator, int decimals)
+{
+    if (results.empty())
+        return;
+
+    const std::vector<ResultColumn> columns = local::heldColumns(results.front());
+    local::writeHeader(output, columns, separator, true);
+    for (std::size_t group = 0; group < results.size(); ++group)
+    {
+        const std::string groupName = group < groupNames.size() ? groupNames[group] : "Group " + std::to_string(group);
+        local::writeRows(output, results[group], columns, dimensionNames, &groupName, separator, decimals);
+    }
+}
+
+} // namespace de
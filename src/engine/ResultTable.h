@@ -0,0 +1,56 @@
+#pragma once
+
+#include "DifferentialExpression.h"
+
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace de
+{
+
+/** Statistics of a result that are computed together, each fills some of the columns of a result table */
+enum class ResultStatistics
+{
+    Means,          // the DE and the means, always computed
+    Medians,
+    Additional,     // SD and % expressed
+    Tests           // Welch's t-test and the rank-sum test with their adjusted p-values
+};
+
+/** A statistic column of a result table, which reads its values from the statistics of a result that fill it */
+struct ResultColumn
+{
+    std::string                     name;
+    ResultStatistics                statistics  = ResultStatistics::Means;
+    std::vector<float> DEResult::*  values      = nullptr;  // null for the DE, the difference of the means
+    bool                            probability = false;    // not rounded, small p-values would all become zero
+
+    float value(const DEResult& result, std::size_t row) const { return values ? (result.*values)[row] : result.de(row); }
+};
+
+/** The statistic columns of a DE result table in their order, following the column of the dimension names */
+std::vector<ResultColumn> resultColumns(bool additionalStatistics, bool statisticalTests = false);
+
+/** Column titles of a DE result table, the first column holds the dimension names */
+std::vector<std::string> resultColumnNames(bool additionalStatistics, bool statisticalTests = false);
+
+/** \p result holds \p statistics */
+bool hasStatistics(const DEResult& result, ResultStatistics statistics);
+
+/** Makes a run with \p options compute \p statistics too */
+void requestStatistics(DEOptions& options, ResultStatistics statistics);
+
+/** Round to \p decimals decimals, the way values are presented in result tables */
+float roundTo(float value, int decimals);
+
+/** Writes \p result as a table with a quoted header line, one row per row of the result named by its column, p-values are not rounded
+    Columns of statistics that \p result does not hold are left out.
+*/
+void writeResultTable(std::ostream& output, const DEResult& result, std::span<const std::string> dimensionNames, char separator = ',', int decimals = 3);
+
+/** Writes several results (e.g. one per group) stacked, with a leading "Group" column holding \p groupNames */
+void writeGroupedResultTable(std::ostream& output, std::span<const DEResult> results, std::span<const std::string> groupNames, std::span<const std::string> dimensionNames, char separator = ',', int decimals = 3);
+
+} // namespace de
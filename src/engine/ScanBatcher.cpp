@@ -0,0 +1,143 @@
+#include "ScanBatcher.h"
+
+#include <algorithm>
+
+namespace de
+{
+
+namespace local
+{
+    bool sameBinning(const AggregationOptions& options, const AggregationOptions& other)
+    {
+        return options.numBins == other.numBins && options.expressedThreshold == other.expressedThreshold && options.normalizedThreshold == other.normalizedThreshold;
+    }
+}
+
+ScanBatcher& ScanBatcher::shared()
+{
+    static ScanBatcher batcher;
+    return batcher;
+}
+
+std::uint64_t ScanBatcher::submit(const DatasetKey& key, const AggregationOptions& options, Selections selections, Scan scan, ProgressSink* progress, Done done)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Request& request    = _queue.emplace_back();
+    request.id          = _nextId++;
+    request.key         = key;
+    request.options     = options;
+    request.selections  = std::move(selections);
+    request.scan        = std::move(scan);
+    request.progress    = progress;
+    request.done        = std::move(done);
+
+    return request.id;
+}
+
+void ScanBatcher::cancel(std::uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::erase_if(_queue, [id](const Request& request) { return request.id == id; });
+}
+
+bool ScanBatcher::pending() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_queue.empty();
+}
+
+void ScanBatcher::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+            return;
+        _running = true;
+    }
+
+    // Done may throw, the next run must still serve
+    struct Running
+    {
+        ScanBatcher& batcher;
+        ~Running()
+        {
+            std::lock_guard<std::mutex> lock(batcher._mutex);
+            batcher._running = false;
+        }
+    } running{ *this };
+
+    for (std::vector<Request> batch = takeBatch(); !batch.empty(); batch = takeBatch())
+        serve(batch);
+}
+
+void ScanBatcher::SharedProgress::advance(std::uint64_t steps)
+{
+    for (const Request& request : _requests)
+        if (request.progress)
+            request.progress->advance(steps);
+}
+
+bool ScanBatcher::SharedProgress::canceled() const
+{
+    return std::all_of(_requests.begin(), _requests.end(), [](const Request& request) { return request.progress && request.progress->canceled(); });
+}
+
+std::vector<ScanBatcher::Request> ScanBatcher::takeBatch()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<Request> batch;
+    if (_queue.empty())
+        return batch;
+
+    const DatasetKey key = _queue.front().key;
+    const AggregationOptions options = _queue.front().options;
+
+    const auto shared = std::stable_partition(_queue.begin(), _queue.end(), [&](const Request& request) {
+        return request.key.id == key.id && request.key.generation == key.generation && local::sameBinning(request.options, options);
+        });
+
+    batch.assign(std::make_move_iterator(_queue.begin()), std::make_move_iterator(shared));
+    _queue.erase(_queue.begin(), shared);
+
+    return batch;
+}
+
+void ScanBatcher::serve(std::vector<Request>& batch)
+{
+    // requests often ask for the same selections, e.g. the clusters of a dataset; those are one group of the scan
+    std::vector<RowIndices> distinct;
+    std::vector<std::vector<std::size_t>> groups(batch.size());
+    for (std::size_t r = 0; r < batch.size(); ++r)
+    {
+        for (const auto& selection : batch[r].selections)
+        {
+            const RowIndices rows = selection;
+            const auto found = std::find_if(distinct.begin(), distinct.end(), [rows](RowIndices other) {
+                return std::equal(rows.begin(), rows.end(), other.begin(), other.end());
+                });
+
+            groups[r].push_back(found - distinct.begin());
+            if (found == distinct.end())
+                distinct.push_back(rows);
+        }
+    }
+
+    SharedProgress progress(batch);
+    const Aggregates aggregates = batch.front().scan(distinct, &progress);
+    const bool canceled = progress.canceled();
+
+    for (std::size_t r = 0; r < batch.size(); ++r)
+    {
+        Aggregates requested;
+        requested.reserve(groups[r].size());
+        for (const std::size_t group : groups[r])
+            requested.push_back(group < aggregates.size() ? aggregates[group] : nullptr);
+
+        if (batch[r].done)
+            batch[r].done(std::move(requested), canceled);
+    }
+}
+
+} // namespace de
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "GroupStatistics.h"
+#include "ProgressSink.h"
+#include "StatisticsRegistry.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace de
+{
+
+/*  Gathers requests for the aggregates of selections and serves those on the same dataset from one scan
+    Requests are queued by submit, e.g. by several views reacting to the same event or a grouped analysis,
+    and served by run, e.g. after a short window in which more requests may arrive. run scans once per
+    dataset and binning for the union of the selections of all its requests, each distinct selection one
+    group of the scan, so N simultaneous requests read the data about once. Selections in the registry
+    are not scanned at all. Thread-safe; run serves one batch at a time and returns at once when called
+    while it is serving, e.g. from the event loop run by a progress report, the serving call picks up the
+    requests queued meanwhile.
+*/
+class ScanBatcher
+{
+public:
+    using Selections = std::vector<std::vector<std::uint32_t>>;
+    using Aggregates = std::vector<std::shared_ptr<const GroupAggregates>>;
+
+    /** Aggregates the sorted storage rows of every selection of a batch, like aggregateSelections on the matrix of the request */
+    using Scan = std::function<Aggregates(std::span<const RowIndices> selections, ProgressSink* progress)>;
+
+    /** Receives the aggregates of the selections of a request in their order, incomplete if the scan was canceled */
+    using Done = std::function<void(Aggregates aggregates, bool canceled)>;
+
+    /** The batcher of the process */
+    static ScanBatcher& shared();
+
+    ScanBatcher() = default;
+
+    ScanBatcher(const ScanBatcher&) = delete;
+    ScanBatcher& operator=(const ScanBatcher&) = delete;
+
+    /*  Queues the aggregation of the sorted storage rows of \p selections of dataset \p key, binned for \p options
+        Requests on the same key and binning share a scan: \p scan of one of them is called for all, with the
+        \p options of that request, which must stay valid until it is served. \p progress receives the progress
+        of the scan, which is canceled only if the progress of all its requests is. Returns an id for cancel.
+    */
+    std::uint64_t submit(const DatasetKey& key, const AggregationOptions& options, Selections selections, Scan scan, ProgressSink* progress, Done done);
+
+    /** Drops request \p id if it is not served yet, e.g. when its receiver is destroyed */
+    void cancel(std::uint64_t id);
+
+    /** Requests are queued */
+    bool pending() const;
+
+    /** Serves the queued requests and calls their Done on the calling thread */
+    void run();
+
+private:
+    struct Request
+    {
+        std::uint64_t       id = 0;
+        DatasetKey          key;
+        AggregationOptions  options;
+        Selections          selections;
+        Scan                scan;
+        ProgressSink*       progress = nullptr;
+        Done                done;
+    };
+
+    /** Reports the progress of a shared scan to all its requests */
+    class SharedProgress : public ProgressSink
+    {
+    public:
+        explicit SharedProgress(std::span<const Request> requests) : _requests(requests) {}
+
+        void advance(std::uint64_t steps) override;
+        bool canceled() const override;
+
+    private:
+        std::span<const Request> _requests;
+    };
+
+    /** The requests of the oldest queued request's dataset and binning, removed from the queue */
+    std::vector<Request> takeBatch();
+
+    /** Scans once for the distinct selections of \p batch and calls the Done of every request */
+    static void serve(std::vector<Request>& batch);
+
+private:
+    mutable std::mutex      _mutex;
+    std::vector<Request>    _queue;         // in order of submission
+    std::uint64_t           _nextId = 1;
+    bool                    _running = false;
+};
+
+} // namespace de
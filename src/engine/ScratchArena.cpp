@@ -0,0 +1,87 @@
+#include "ScratchArena.h"
+
+#include <algorithm>
+
+namespace de
+{
+
+namespace local
+{
+    std::size_t alignedSize(std::size_t bytes)
+    {
+        return (bytes + ScratchArena::alignment - 1) / ScratchArena::alignment * ScratchArena::alignment;
+    }
+}
+
+ScratchArena::Frame::Frame(ScratchArena* arena) :
+    _arena(arena),
+    _used(arena ? arena->_used : 0),
+    _numBlocks(arena ? arena->_blocks.size() : 0)
+{
+    if (_arena)
+        ++_arena->_depth;
+}
+
+ScratchArena::Frame::~Frame()
+{
+    if (_arena)
+        _arena->endFrame(_used, _numBlocks);
+}
+
+void ScratchArena::release()
+{
+    _slab.reset();
+    _blocks.clear();
+    _capacity = 0;
+    _used = 0;
+    _blockBytes = 0;
+    _required = 0;
+}
+
+ScratchArena::Block ScratchArena::allocateBlock(std::size_t bytes)
+{
+    return Block(new (std::align_val_t(alignment)) std::byte[bytes]);
+}
+
+std::byte* ScratchArena::allocateBytes(std::size_t bytes)
+{
+    bytes = local::alignedSize(std::max<std::size_t>(bytes, 1));
+
+    std::byte* buffer;
+    if (_used + bytes <= _capacity)
+    {
+        buffer = _slab.get() + _used;
+        _used += bytes;
+    }
+    else
+    {
+        _blocks.emplace_back(allocateBlock(bytes), bytes);
+        _blockBytes += bytes;
+        buffer = _blocks.back().first.get();
+    }
+
+    _required = std::max(_required, _used + _blockBytes);
+    return buffer;
+}
+
+void ScratchArena::endFrame(std::size_t used, std::size_t numBlocks)
+{
+    --_depth;
+
+    _used = used;
+    while (_blocks.size() > numBlocks)
+    {
+        _blockBytes -= _blocks.back().second;
+        _blocks.pop_back();
+    }
+
+    // the next run gets all of its buffers from the slab
+    if (_depth == 0 && _required > _capacity)
+    {
+        _slab.reset();
+        _slab = allocateBlock(_required);
+        _capacity = _required;
+    }
+}
+
+} // namespace de
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace de
+{
+
+/*  Working memory of DE runs, kept between runs: one aligned slab from which the buffers of a run are carved
+    Buffers are carved in frames: a Frame returns everything carved within it when it ends, so nested engine
+    functions can share the arena. Buffers that do not fit the slab get blocks of their own; when the outermost
+    frame ends these are merged into a slab large enough for the whole run. The slab only grows, so repeated runs
+    of the same or smaller sizes allocate nothing and touch pages that are already mapped. Not thread-safe: one
+    run at a time, whose threads may use the buffers carved for it.
+*/
+class ScratchArena
+{
+public:
+    /** Alignment of every buffer, a cache line */
+    static constexpr std::size_t alignment = 64;
+
+    /** Returns the buffers carved from \p arena while it exists; does nothing for a null arena */
+    class Frame
+    {
+    public:
+        explicit Frame(ScratchArena* arena);
+        ~Frame();
+
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+
+    private:
+        ScratchArena*   _arena;
+        std::size_t     _used;
+        std::size_t     _numBlocks;
+    };
+
+    ScratchArena() = default;
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    /** \p count uninitialized elements, valid until the innermost frame ends */
+    template <typename T>
+    std::span<T> allocate(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= alignment);
+        return { reinterpret_cast<T*>(allocateBytes(count * sizeof(T))), count };
+    }
+
+    /** Bytes of the slab */
+    std::size_t capacity() const { return _capacity; }
+
+    /** Frees the slab, e.g. when the dataset changes; call outside of frames */
+    void release();
+
+private:
+    struct AlignedDelete
+    {
+        void operator()(std::byte* block) const { ::operator delete[](block, std::align_val_t(alignment)); }
+    };
+    using Block = std::unique_ptr<std::byte[], AlignedDelete>;
+
+    static Block allocateBlock(std::size_t bytes);
+
+    std::byte* allocateBytes(std::size_t bytes);
+
+    /** Returns to the state at the start of a frame, merges the blocks when no frame is left */
+    void endFrame(std::size_t used, std::size_t numBlocks);
+
+private:
+    Block               _slab;
+    std::size_t         _capacity   = 0;
+    std::size_t         _used       = 0;    // bytes carved from the slab
+    std::vector<std::pair<Block, std::size_t>> _blocks;     // buffers that did not fit the slab, with their bytes
+    std::size_t         _blockBytes = 0;
+    std::size_t         _required   = 0;    // largest number of bytes carved at once since the last merge
+    std::size_t         _depth      = 0;    // frames open
+};
+
+/*  A buffer of \p count elements from \p arena, or from \p fallback without an arena
+    Elements from the arena are uninitialized, those from \p fallback value-initialized.
+*/
+template <typename T>
+std::span<T> scratchBuffer(ScratchArena* arena, std::vector<T>& fallback, std::size_t count)
+{
+    if (arena)
+        return arena->allocate<T>(count);
+
+    fallback.resize(count);
+    return fallback;
+}
+
+} // namespace de
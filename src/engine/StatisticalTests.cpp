@@ -0,0 +1,267 @@
+#include "StatisticalTests.h"
+
+#include "MatrixView.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+namespace de
+{
+
+namespace local
+{
+    // Continued fraction of the incomplete beta function (modified Lentz's method)
+    double betaContinuedFraction(double a, double b, double x)
+    {
+        constexpr int maxIterations = 300;
+        constexpr double epsilon = 1e-14;
+        constexpr double tiny = 1e-300;
+
+        const double qab = a + b;
+        const double qap = a + 1.0;
+        const double qam = a - 1.0;
+
+        double c = 1.0;
+        double d = 1.0 - qab * x / qap;
+        if (std::fabs(d) < tiny)
+            d = tiny;
+        d = 1.0 / d;
+        double h = d;
+
+        for (int m = 1; m <= maxIterations; ++m)
+        {
+            const int m2 = 2 * m;
+
+            double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+            d = 1.0 + aa * d;
+            if (std::fabs(d) < tiny)
+                d = tiny;
+            c = 1.0 + aa / c;
+            if (std::fabs(c) < tiny)
+                c = tiny;
+            d = 1.0 / d;
+            h *= d * c;
+
+            aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+            d = 1.0 + aa * d;
+            if (std::fabs(d) < tiny)
+                d = tiny;
+            c = 1.0 + aa / c;
+            if (std::fabs(c) < tiny)
+                c = tiny;
+            d = 1.0 / d;
+            const double delta = d * c;
+            h *= delta;
+
+            if (std::fabs(delta - 1.0) < epsilon)
+                break;
+        }
+
+        return h;
+    }
+
+    // Regularized incomplete beta function I_x(a, b)
+    double regularizedIncompleteBeta(double a, double b, double x)
+    {
+        if (x <= 0.0)
+            return 0.0;
+        if (x >= 1.0)
+            return 1.0;
+
+        const double logFront = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x);
+        const double front = std::exp(logFront);
+
+        if (x < (a + 1.0) / (a + b + 2.0))
+            return front * betaContinuedFraction(a, b, x) / a;
+
+        return 1.0 - front * betaContinuedFraction(b, a, 1.0 - x) / b;
+    }
+
+    // Moves the zeros to the end, returns the number of non-zero values
+    template <typename T>
+    std::size_t partitionNonZero(T* values, std::size_t size)
+    {
+        return static_cast<std::size_t>(std::partition(values, values + size, [](T value) { return static_cast<float>(value) != 0.0f; }) - values);
+    }
+
+    // Moves the NaNs to the end, returns the number of other values
+    template <typename T>
+    std::size_t partitionNotNaN(T* values, std::size_t size)
+    {
+        if constexpr (std::is_integral_v<T>)
+            return size;
+        else
+            return static_cast<std::size_t>(std::partition(values, values + size, [](T value) { return !std::isnan(static_cast<float>(value)); }) - values);
+    }
+}
+
+double studentTTwoSidedP(double t, double degreesOfFreedom)
+{
+    if (!std::isfinite(t))
+        return std::isnan(t) ? 1.0 : 0.0;
+
+    return local::regularizedIncompleteBeta(0.5 * degreesOfFreedom, 0.5, degreesOfFreedom / (degreesOfFreedom + t * t));
+}
+
+WelchTestResult welchTTest(double meanA, double varianceA, std::size_t sizeA, double meanB, double varianceB, std::size_t sizeB)
+{
+    WelchTestResult result;
+
+    // moments of samples with NaNs
+    if (std::isnan(meanA) || std::isnan(meanB) || std::isnan(varianceA) || std::isnan(varianceB))
+        return result;
+
+    const double errorA = varianceA / sizeA;
+    const double errorB = varianceB / sizeB;
+    const double standardError2 = errorA + errorB;
+
+    if (!(standardError2 > 0.0))
+        return result;
+
+    // Welch-Satterthwaite degrees of freedom, a selection of one item contributes no variance
+    double denominator = 0.0;
+    if (sizeA > 1)
+        denominator += errorA * errorA / (sizeA - 1.0);
+    if (sizeB > 1)
+        denominator += errorB * errorB / (sizeB - 1.0);
+
+    const double t = (meanA - meanB) / std::sqrt(standardError2);
+    const double degreesOfFreedom = standardError2 * standardError2 / denominator;
+
+    result.t = static_cast<float>(t);
+    result.p = static_cast<float>(studentTTwoSidedP(t, degreesOfFreedom));
+
+    return result;
+}
+
+template <typename T>
+RankSumTestResult rankSumTest(T* valuesA, std::size_t sizeA, T* valuesB, std::size_t sizeB)
+{
+    // only the non-zero values need sorting, the zeros form a single tie group
+    const std::size_t nonZeroA = local::partitionNonZero(valuesA, sizeA);
+    const std::size_t nonZeroB = local::partitionNonZero(valuesB, sizeB);
+
+    return rankSumTestNonZero(valuesA, nonZeroA, sizeA, valuesB, nonZeroB, sizeB);
+}
+
+template <typename T>
+RankSumTestResult rankSumTestNonZero(T* valuesA, std::size_t nonZeroA, std::size_t sizeA, T* valuesB, std::size_t nonZeroB, std::size_t sizeB)
+{
+    RankSumTestResult result;
+
+    // NaNs have no rank and cannot be sorted, they are left out of the samples
+    const std::size_t rankedA = local::partitionNotNaN(valuesA, nonZeroA);
+    const std::size_t rankedB = local::partitionNotNaN(valuesB, nonZeroB);
+    sizeA -= nonZeroA - rankedA;
+    sizeB -= nonZeroB - rankedB;
+    nonZeroA = rankedA;
+    nonZeroB = rankedB;
+
+    if (sizeA == 0 || sizeB == 0)
+        return result;
+
+    std::sort(valuesA, valuesA + nonZeroA);
+    std::sort(valuesB, valuesB + nonZeroB);
+
+    const std::size_t zerosA = sizeA - nonZeroA;
+    const std::size_t zerosB = sizeB - nonZeroB;
+    bool zerosPending = zerosA + zerosB > 0;
+
+    RankSumAccumulator accumulator;
+
+    std::size_t a = 0, b = 0;
+    while (a < nonZeroA || b < nonZeroB || zerosPending)
+    {
+        float value = zerosPending ? 0.0f : std::numeric_limits<float>::infinity();
+        if (a < nonZeroA)
+            value = std::min(value, static_cast<float>(valuesA[a]));
+        if (b < nonZeroB)
+            value = std::min(value, static_cast<float>(valuesB[b]));
+
+        double countA = 0.0, countB = 0.0;
+        while (a < nonZeroA && static_cast<float>(valuesA[a]) == value)
+        {
+            ++a;
+            ++countA;
+        }
+        while (b < nonZeroB && static_cast<float>(valuesB[b]) == value)
+        {
+            ++b;
+            ++countB;
+        }
+        if (zerosPending && value == 0.0f)
+        {
+            countA += zerosA;
+            countB += zerosB;
+            zerosPending = false;
+        }
+
+        accumulator.addTieGroup(countA, countB);
+    }
+
+    return accumulator.result(sizeA, sizeB);
+}
+
+void RankSumAccumulator::addTieGroup(double countA, double countB)
+{
+    const double tieSize = countA + countB;
+    _rankSumA += countA * (_rank + (tieSize + 1.0) / 2.0);
+    _tieCorrection += tieSize * tieSize * tieSize - tieSize;
+    _rank += tieSize;
+}
+
+RankSumTestResult RankSumAccumulator::result(std::size_t sizeA, std::size_t sizeB) const
+{
+    RankSumTestResult result;
+
+    if (sizeA == 0 || sizeB == 0)
+        return result;
+
+    const double nA = static_cast<double>(sizeA);
+    const double nB = static_cast<double>(sizeB);
+    const double n = nA + nB;
+
+    const double u = _rankSumA - nA * (nA + 1.0) / 2.0;
+    result.auroc = static_cast<float>(u / (nA * nB));
+
+    const double variance = nA * nB / 12.0 * ((n + 1.0) - (n > 1.0 ? _tieCorrection / (n * (n - 1.0)) : 0.0));
+    if (variance > 0.0)
+    {
+        const double z = std::max(0.0, std::fabs(u - nA * nB / 2.0) - 0.5) / std::sqrt(variance);
+        result.p = static_cast<float>(std::erfc(z / std::sqrt(2.0)));
+    }
+
+    return result;
+}
+
+std::vector<float> adjustBenjaminiHochberg(std::span<const float> pValues)
+{
+    const std::size_t size = pValues.size();
+
+    std::vector<std::uint32_t> order(size);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [pValues](std::uint32_t l, std::uint32_t r) { return pValues[l] < pValues[r]; });
+
+    std::vector<float> adjusted(size);
+    double minimum = 1.0;
+    for (std::size_t i = size; i > 0; --i)
+    {
+        const std::uint32_t index = order[i - 1];
+        minimum = std::min(minimum, static_cast<double>(pValues[index]) * size / i);
+        adjusted[index] = static_cast<float>(minimum);
+    }
+
+    return adjusted;
+}
+
+#define DE_INSTANTIATE_RANK_SUM_TEST(T)                                                                                       \
+    template RankSumTestResult rankSumTest(T*, std::size_t, T*, std::size_t);                                               \
+    template RankSumTestResult rankSumTestNonZero(T*, std::size_t, std::size_t, T*, std::size_t, std::size_t);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_RANK_SUM_TEST)
+
+} // namespace de
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace de
+{
+
+struct WelchTestResult
+{
+    float t         = 0.0f;     // positive if the mean of A is larger
+    float p         = 1.0f;     // two-sided
+};
+
+struct RankSumTestResult
+{
+    float auroc     = 0.5f;     // probability that a value of A exceeds one of B, ties count half
+    float p         = 1.0f;     // two-sided, normal approximation with tie and continuity correction
+};
+
+/** Welch's unequal variances t-test from the sample means and (n - 1) variances, t = 0 and p = 1 without variance or with NaN moments */
+WelchTestResult welchTTest(double meanA, double varianceA, std::size_t sizeA, double meanB, double varianceB, std::size_t sizeB);
+
+/*  Wilcoxon rank-sum (Mann-Whitney U) test with AUROC
+    Reorders both value ranges. Zeros are counted and ranked as one tie group instead of being
+    sorted, so for sparse single-cell data only the expressed values are sorted. The values are
+    sorted in their own type T, any of the element types of the engine. NaNs are left out of the samples.
+*/
+template <typename T>
+RankSumTestResult rankSumTest(T* valuesA, std::size_t sizeA, T* valuesB, std::size_t sizeB);
+
+/** rankSumTest of samples given by their \p nonZeroA and \p nonZeroB non-zero values, the remaining values are zero; sorts the values */
+template <typename T>
+RankSumTestResult rankSumTestNonZero(T* valuesA, std::size_t nonZeroA, std::size_t sizeA, T* valuesB, std::size_t nonZeroB, std::size_t sizeB);
+
+/** Rank-sum test from tie groups of both samples, added in increasing order of value */
+class RankSumAccumulator
+{
+public:
+    void addTieGroup(double countA, double countB);
+
+    RankSumTestResult result(std::size_t sizeA, std::size_t sizeB) const;
+
+private:
+    double _rank            = 0.0;  // ranks handed out so far
+    double _rankSumA        = 0.0;
+    double _tieCorrection   = 0.0;  // sum of t^3 - t over tie groups
+};
+
+/** Benjamini-Hochberg adjusted p-values (false discovery rate), in the order of \p pValues */
+std::vector<float> adjustBenjaminiHochberg(std::span<const float> pValues);
+
+/** Two-sided p-value of Student's t distribution with \p degreesOfFreedom */
+double studentTTwoSidedP(double t, double degreesOfFreedom);
+
+} // namespace de
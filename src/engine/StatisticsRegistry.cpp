@@ -0,0 +1,352 @@
+#include "StatisticsRegistry.h"
+
+#include <algorithm>
+
+namespace de
+{
+
+StatisticsRegistry& StatisticsRegistry::shared()
+{
+    static StatisticsRegistry registry;
+    return registry;
+}
+
+StatisticsRegistry::StatisticsRegistry(std::uint64_t aggregatesCapacity, std::uint64_t transposedCapacity) :
+    _aggregatesCapacity(aggregatesCapacity),
+    _transposed(transposedCapacity)
+{
+}
+
+DatasetKey StatisticsRegistry::key(const std::string& id) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto generation = _generations.find(id);
+    return { id, generation == _generations.end() ? 0 : generation->second };
+}
+
+DatasetKey StatisticsRegistry::invalidate(const DatasetKey& key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::uint64_t& generation = _generations[key.id];
+    if (generation == key.generation)
+    {
+        eraseDataset(key.id, generation);
+        ++generation;
+    }
+
+    return { key.id, generation };
+}
+
+void StatisticsRegistry::remove(const std::string& id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the generation is kept, results of computations still running on the removed data stay out of date
+    std::uint64_t& generation = _generations[id];
+    eraseDataset(id, generation);
+    ++generation;
+}
+
+std::shared_ptr<const RangeStatistics> StatisticsRegistry::ranges(const DatasetKey& key) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto ranges = _ranges.find(key.id);
+    if (ranges == _ranges.end() || !current(key))
+        return nullptr;
+
+    return ranges->second;
+}
+
+std::shared_ptr<const RangeStatistics> StatisticsRegistry::insertRanges(const DatasetKey& key, DimensionRanges ranges)
+{
+    auto statistics = std::make_shared<RangeStatistics>();
+    statistics->rescaleValues = rescaleFactors(ranges);
+    statistics->ranges = std::move(ranges);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (current(key))
+        _ranges[key.id] = statistics;
+
+    return statistics;
+}
+
+std::shared_ptr<const GroupAggregates> StatisticsRegistry::aggregates(const DatasetKey& key, RowIndices rows, const AggregationOptions& options)
+{
+    const std::uint64_t hash = hashRows(rows);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto entry = std::find_if(_aggregates.begin(), _aggregates.end(), [&](const AggregatesEntry& entry) { return entry.matches(key, hash, rows, options); });
+    if (entry == _aggregates.end() || !current(key))
+        return nullptr;
+
+    _aggregates.splice(_aggregates.begin(), _aggregates, entry);
+    return entry->aggregates;
+}
+
+void StatisticsRegistry::insertAggregates(const DatasetKey& key, RowIndices rows, const AggregationOptions& options, std::shared_ptr<const GroupAggregates> aggregates)
+{
+    if (!aggregates)
+        return;
+
+    AggregatesEntry entry;
+    entry.id                    = key.id;
+    entry.generation            = key.generation;
+    entry.hash                  = hashRows(rows);
+    entry.rows.assign(rows.begin(), rows.end());
+    entry.numBins               = options.numBins;
+    entry.expressedThreshold    = options.expressedThreshold;
+    entry.normalizedThreshold   = options.normalizedThreshold;
+    entry.bytes                 = GroupAggregates::estimateBytes(1, aggregates->numDimensions, aggregates->numBins) + rows.size() * sizeof(std::uint32_t);
+    entry.aggregates            = std::move(aggregates);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!current(key) || entry.bytes > _aggregatesCapacity)
+        return;
+
+    const auto previous = std::find_if(_aggregates.begin(), _aggregates.end(), [&](const AggregatesEntry& other) { return other.matches(key, entry.hash, rows, options); });
+    if (previous != _aggregates.end())
+    {
+        _aggregatesSize -= previous->bytes;
+        _aggregates.erase(previous);
+    }
+
+    evictAggregates(entry.bytes);
+    _aggregatesSize += entry.bytes;
+    _aggregates.push_front(std::move(entry));
+}
+
+std::shared_ptr<const MatrixData> StatisticsRegistry::transposed(const DatasetKey& key)
+{
+    return _transposed.find(transposedKey(key));
+}
+
+bool StatisticsRegistry::containsTransposed(const DatasetKey& key) const
+{
+    return _transposed.contains(transposedKey(key));
+}
+
+bool StatisticsRegistry::insertTransposed(const DatasetKey& key, std::shared_ptr<const MatrixData> matrix)
+{
+    // the generation can advance right after the check, invalidate then erases the copy again under the same mutex
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!current(key))
+        return false;
+
+    return _transposed.insert(transposedKey(key), std::move(matrix));
+}
+
+void StatisticsRegistry::eraseTransposed(const DatasetKey& key)
+{
+    _transposed.erase(transposedKey(key));
+}
+
+std::uint64_t StatisticsRegistry::aggregatesCapacity() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _aggregatesCapacity;
+}
+
+std::uint64_t StatisticsRegistry::transposedCapacity() const
+{
+    return _transposed.capacity();
+}
+
+void StatisticsRegistry::setAggregatesCapacity(std::uint64_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _aggregatesCapacity = capacityBytes;
+    evictAggregates(0);
+}
+
+void StatisticsRegistry::setTransposedCapacity(std::uint64_t capacityBytes)
+{
+    _transposed.setCapacity(capacityBytes);
+}
+
+std::uint64_t StatisticsRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::uint64_t bytes = _aggregatesSize + _transposed.size();
+    for (const auto& [id, statistics] : _ranges)
+        bytes += statistics->ranges.minimum.size() * (3 * sizeof(float) + sizeof(std::uint8_t));
+
+    return bytes;
+}
+
+bool StatisticsRegistry::AggregatesEntry::matches(const DatasetKey& key, std::uint64_t rowsHash, RowIndices otherRows, const AggregationOptions& options) const
+{
+    return hash == rowsHash && generation == key.generation && id == key.id
+        && numBins == options.numBins && expressedThreshold == options.expressedThreshold && normalizedThreshold == options.normalizedThreshold
+        && std::equal(rows.begin(), rows.end(), otherRows.begin(), otherRows.end());
+}
+
+std::string StatisticsRegistry::transposedKey(const DatasetKey& key)
+{
+    return key.id + '#' + std::to_string(key.generation);
+}
+
+std::uint64_t StatisticsRegistry::hashRows(RowIndices rows)
+{
+    // FNV-1a over the indices, entries are compared row by row on a match
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const std::uint32_t row : rows)
+    {
+        hash ^= row;
+        hash *= 1099511628211ull;
+    }
+
+    return hash ^ rows.size();
+}
+
+bool StatisticsRegistry::current(const DatasetKey& key) const
+{
+    const auto generation = _generations.find(key.id);
+    return key.generation == (generation == _generations.end() ? 0 : generation->second);
+}
+
+void StatisticsRegistry::eraseDataset(const std::string& id, std::uint64_t generation)
+{
+    _ranges.erase(id);
+    _transposed.erase(transposedKey({ id, generation }));
+
+    for (auto entry = _aggregates.begin(); entry != _aggregates.end();)
+    {
+        if (entry->id != id)
+        {
+            ++entry;
+            continue;
+        }
+
+        _aggregatesSize -= entry->bytes;
+        entry = _aggregates.erase(entry);
+    }
+}
+
+void StatisticsRegistry::evictAggregates(std::uint64_t bytes)
+{
+    while (!_aggregates.empty() && _aggregatesSize + bytes > _aggregatesCapacity)
+    {
+        _aggregatesSize -= _aggregates.back().bytes;
+        _aggregates.pop_back();
+    }
+}
+
+template <typename Matrix>
+std::vector<std::shared_ptr<const GroupAggregates>> aggregateSelections(const Matrix& matrix, std::span<const RowIndices> rows, const AggregationOptions& options,
+    StatisticsRegistry& registry, const DatasetKey& key, ProgressSink* progress, PerformanceTrace* trace)
+{
+    std::vector<std::shared_ptr<const GroupAggregates>> selections(rows.size());
+
+    std::vector<std::size_t> missing;
+    for (std::size_t selection = 0; selection < rows.size(); ++selection)
+    {
+        selections[selection] = registry.aggregates(key, rows[selection], options);
+        if (!selections[selection])
+            missing.push_back(selection);
+    }
+
+    if (missing.empty())
+    {
+        if (progress)
+            progress->advance(matrix.numColumns);
+        return selections;
+    }
+
+    std::vector<RowIndices> missingRows(missing.size());
+    for (std::size_t i = 0; i < missing.size(); ++i)
+        missingRows[i] = rows[missing[i]];
+
+    const auto membership = GroupMembership::fromSelections(matrix.numRows, missingRows);
+    const GroupAggregates scanned = aggregateGroups(matrix, membership, options, progress, trace);
+    const bool complete = !(progress && progress->canceled());
+
+    // the sums of a group do not depend on the other groups of the scan, so the split aggregates equal those of a scan of one group
+    for (std::size_t i = 0; i < missing.size(); ++i)
+    {
+        auto selection = std::make_shared<GroupAggregates>(emptyGroupAggregates(1, scanned.numDimensions, options));
+        selection->add(0, scanned, i);
+
+        if (complete)
+            registry.insertAggregates(key, missingRows[i], options, selection);
+        selections[missing[i]] = std::move(selection);
+    }
+
+    return selections;
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionRegistered(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, std::size_t numBins,
+    StatisticsRegistry& registry, const DatasetKey& key, ProgressSink* progress, PerformanceTrace* trace)
+{
+    const RowIndices selections[] = { selectionA, selectionB };
+
+    AggregationOptions aggregationOptions;
+    aggregationOptions.numBins              = numBins;
+    aggregationOptions.minValues            = options.minValues;
+    aggregationOptions.rescaleValues        = options.rescaleValues;
+    aggregationOptions.expressedThreshold   = options.expressedThreshold;
+    aggregationOptions.normalizedThreshold  = options.normalize;
+
+    const auto aggregates = aggregateSelections(matrix, std::span<const RowIndices>(selections), aggregationOptions, registry, key, progress, trace);
+    if (progress && progress->canceled())
+        return {};
+
+    PerformanceTrace::Scope scope(trace, "Statistics from aggregates", "de");
+    DEResult result = compareGroups(*aggregates[0], 0, *aggregates[1], 0, options);
+
+    // the selections are aggregated for all columns, a subset is sliced from the result
+    if (!options.dimensions.empty())
+        result = restrictToDimensions(result, options.dimensions);
+
+    return result;
+}
+
+GroupAggregates joinAggregates(std::span<const std::shared_ptr<const GroupAggregates>> selections)
+{
+    GroupAggregates joined;
+    if (selections.empty())
+        return joined;
+
+    const GroupAggregates& first = *selections.front();
+    const std::size_t numGroups = selections.size();
+    const std::size_t entries = numGroups * first.numDimensions;
+
+    joined.numGroups = numGroups;
+    joined.numDimensions = first.numDimensions;
+    joined.numBins = first.numBins;
+    joined.binMinimum = first.binMinimum;
+    joined.binWidth = first.binWidth;
+    joined.count.assign(numGroups, 0);
+    joined.sum.assign(entries, 0.0);
+    joined.sumOfSquares.assign(entries, 0.0);
+    joined.nonZero.assign(entries, 0);
+    joined.expressed.assign(entries, 0);
+    joined.histogram.assign(entries * first.numBins, 0);
+
+    for (std::size_t group = 0; group < numGroups; ++group)
+        joined.add(group, *selections[group], 0);
+
+    return joined;
+}
+
+#define DE_INSTANTIATE_STATISTICS_REGISTRY(T)                                                                                                               \
+    template std::vector<std::shared_ptr<const GroupAggregates>> aggregateSelections(const DenseMatrixView<T>&, std::span<const RowIndices>,               \
+        const AggregationOptions&, StatisticsRegistry&, const DatasetKey&, ProgressSink*, PerformanceTrace*);                                               \
+    template std::vector<std::shared_ptr<const GroupAggregates>> aggregateSelections(const SparseMatrixView<T>&, std::span<const RowIndices>,              \
+        const AggregationOptions&, StatisticsRegistry&, const DatasetKey&, ProgressSink*, PerformanceTrace*);                                               \
+    template DEResult computeDifferentialExpressionRegistered(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, std::size_t,              \
+        StatisticsRegistry&, const DatasetKey&, ProgressSink*, PerformanceTrace*);                                                                          \
+    template DEResult computeDifferentialExpressionRegistered(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, std::size_t,             \
+        StatisticsRegistry&, const DatasetKey&, ProgressSink*, PerformanceTrace*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_STATISTICS_REGISTRY)
+
+} // namespace de
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "DimensionRanges.h"
+#include "GroupStatistics.h"
+#include "MatrixIO.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+#include "TransposedMatrix.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace de
+{
+
+/** A dataset as it was at one point: the generation advances whenever its values change */
+struct DatasetKey
+{
+    std::string     id;
+    std::uint64_t   generation = 0;
+};
+
+/** Ranges of a dataset with the min-max normalization factors derived from them */
+struct RangeStatistics
+{
+    DimensionRanges     ranges;
+    std::vector<float>  rescaleValues;
+};
+
+/*  Statistics of datasets shared by everything in the process that computes on them, e.g. all DE views
+    Holds per dataset its dimension ranges, the aggregates of the selections compared on it and its
+    dimension-major copy, so that a view reuses what another view on the same dataset has computed and
+    the memory is counted once. Entries are looked up under the generation of the dataset: invalidate
+    advances it when the values change, which drops the entries and rejects results of computations that
+    started before. Aggregates and copies are evicted least recently used first when they exceed their
+    capacity; they are shared, so an evicted entry stays valid for whoever still holds it. Thread-safe.
+*/
+class StatisticsRegistry
+{
+public:
+    /** The registry of the process */
+    static StatisticsRegistry& shared();
+
+    StatisticsRegistry(std::uint64_t aggregatesCapacity = 1ull << 30, std::uint64_t transposedCapacity = 8ull << 30);
+
+    StatisticsRegistry(const StatisticsRegistry&) = delete;
+    StatisticsRegistry& operator=(const StatisticsRegistry&) = delete;
+
+    /** The current generation of dataset \p id, 0 until its values first change */
+    DatasetKey key(const std::string& id) const;
+
+    /*  Drops the entries of \p key and advances the generation of its dataset
+        Does nothing if the generation already advanced past \p key, e.g. when several views hear of the same
+        change. Returns the current key.
+    */
+    DatasetKey invalidate(const DatasetKey& key);
+
+    /** Drops all entries of dataset \p id, e.g. when it is removed */
+    void remove(const std::string& id);
+
+    /** Ranges of \p key, nullptr if none are known */
+    std::shared_ptr<const RangeStatistics> ranges(const DatasetKey& key) const;
+
+    /** Stores the ranges of \p key, unless its generation is out of date; returns the stored ranges */
+    std::shared_ptr<const RangeStatistics> insertRanges(const DatasetKey& key, DimensionRanges ranges);
+
+    /** Single-group aggregates of the sorted storage \p rows of \p key, binned for \p options; nullptr if they are not cached */
+    std::shared_ptr<const GroupAggregates> aggregates(const DatasetKey& key, RowIndices rows, const AggregationOptions& options);
+
+    /** Caches single-group \p aggregates of \p rows, unless the generation of \p key is out of date or they exceed the capacity */
+    void insertAggregates(const DatasetKey& key, RowIndices rows, const AggregationOptions& options, std::shared_ptr<const GroupAggregates> aggregates);
+
+    /** The dimension-major copy of \p key, marked as most recently used; nullptr if there is none */
+    std::shared_ptr<const MatrixData> transposed(const DatasetKey& key);
+
+    /** A copy of \p key is cached, without marking it as used */
+    bool containsTransposed(const DatasetKey& key) const;
+
+    /** Caches the copy of \p key, evicting the least recently used copies; false if its generation is out of date or it alone exceeds the capacity */
+    bool insertTransposed(const DatasetKey& key, std::shared_ptr<const MatrixData> matrix);
+
+    /** Drops the copy of \p key */
+    void eraseTransposed(const DatasetKey& key);
+
+    std::uint64_t aggregatesCapacity() const;
+    std::uint64_t transposedCapacity() const;
+
+    /** Evict entries until the cached ones fit the new capacity */
+    void setAggregatesCapacity(std::uint64_t capacityBytes);
+    void setTransposedCapacity(std::uint64_t capacityBytes);
+
+    /** Bytes of all entries of all datasets */
+    std::uint64_t size() const;
+
+private:
+    struct AggregatesEntry
+    {
+        std::string                             id;
+        std::uint64_t                           generation = 0;
+        std::uint64_t                           hash = 0;
+        std::vector<std::uint32_t>              rows;
+        std::size_t                             numBins = 0;
+        float                                   expressedThreshold = 0.0f;
+        bool                                    normalizedThreshold = false;
+        std::shared_ptr<const GroupAggregates>  aggregates;
+        std::uint64_t                           bytes = 0;
+
+        bool matches(const DatasetKey& key, std::uint64_t hash, RowIndices rows, const AggregationOptions& options) const;
+    };
+
+    static std::string transposedKey(const DatasetKey& key);
+
+    static std::uint64_t hashRows(RowIndices rows);
+
+    /** Key has the current generation of its dataset, call with the mutex locked */
+    bool current(const DatasetKey& key) const;
+
+    /** Drops the entries of dataset \p id, call with the mutex locked */
+    void eraseDataset(const std::string& id, std::uint64_t generation);
+
+    /** Evicts aggregates from the back until \p bytes more fit, call with the mutex locked */
+    void evictAggregates(std::uint64_t bytes);
+
+private:
+    mutable std::mutex                                                          _mutex;
+    std::unordered_map<std::string, std::uint64_t>                              _generations;   // of the datasets whose values changed
+    std::unordered_map<std::string, std::shared_ptr<const RangeStatistics>>     _ranges;        // of the current generation
+    std::list<AggregatesEntry>                                                  _aggregates;    // most recently used first
+    std::uint64_t                                                               _aggregatesCapacity = 0;
+    std::uint64_t                                                               _aggregatesSize     = 0;
+    TransposedCache                                                             _transposed;    // keyed by transposedKey
+};
+
+/*  Single-group aggregates of every selection of \p rows, those not in \p registry aggregated in one scan over \p matrix
+    The aggregates of the selections that were scanned are added to \p registry under \p key, unless \p progress is
+    canceled. Progress is reported in dimensions of the scan, which is skipped if all selections are cached.
+*/
+template <typename Matrix>
+std::vector<std::shared_ptr<const GroupAggregates>> aggregateSelections(const Matrix& matrix, std::span<const RowIndices> rows, const AggregationOptions& options,
+    StatisticsRegistry& registry, const DatasetKey& key, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/*  computeDifferentialExpressionChunked in a single chunk of \p numBins bins, on the aggregates of \p registry
+    A selection aggregated before, e.g. in the background when it was saved, is taken from \p registry and only the
+    other one is scanned, see aggregateSelections. Progress is reported in dimensions of the scan.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionRegistered(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, std::size_t numBins,
+    StatisticsRegistry& registry, const DatasetKey& key, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** The single-group \p selections as the groups of one GroupAggregates, e.g. to compare them one-vs-rest or pairwise */
+GroupAggregates joinAggregates(std::span<const std::shared_ptr<const GroupAggregates>> selections);
+
+} // namespace de
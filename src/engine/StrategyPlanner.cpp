@@ -0,0 +1,363 @@
+#include "StrategyPlanner.h"
+
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <type_traits>
+
+namespace de
+{
+
+namespace local
+{
+    // Rough single-thread costs in nanoseconds per value, from DifferentialExpressionBenchmark
+    // on float32 data of 100000 x 2000 with 10% non-zeros
+    constexpr double allocateNs         = 3.0;      // first touch of the value copies
+    constexpr double gatherDenseNs      = 3.0;      // copying a selected value into its column
+    constexpr double readDenseNs        = 1.5;      // the part of gatherDenseNs for reading the row, saved for rows in both selections
+    constexpr double scatterSparseNs    = 12.0;     // scattering a stored value into its column
+    constexpr double selectNs           = 5.5;      // mean and nth_element median
+    constexpr double passNs             = 2.0;      // one more pass over the values, e.g. the means without medians, SD and % expressed
+    constexpr double sortNs             = 1.5;      // per value and log2 of the column length
+    constexpr double countDenseNs       = 4.0;      // reading a dense value to count or gather the non-zeros
+    constexpr double countSparseNs      = 10.0;     // per stored value
+    constexpr double binDenseNs         = 4.5;      // adding a selected value to the aggregates of its group
+    constexpr double binSparseNs        = 25.0;     // per stored value
+    constexpr double binCompareNs       = 2.0;      // per bin of both groups when comparing
+    constexpr double countBinNs         = 1.0;      // per bin of a count histogram, zeroing and walking it
+    constexpr double readTransposedNs   = 1.5;      // reading a selected value from the contiguous row of its dimension
+    constexpr double lookupTransposedNs = 3.0;      // per stored value of a sparse copy, looking up the selection of its row
+    constexpr double membershipNs       = 2.0;      // per row of a block
+    constexpr double chunkOverhead      = 1.1;      // Chunked relative to Histogram, for entering every block
+
+    // floats of one DEResult per dimension, with all statistics and tests
+    constexpr std::uint64_t resultBytesPerDimension = 16 * sizeof(float);
+
+    double log2Length(double length)
+    {
+        return std::log2(std::max(2.0, length));
+    }
+
+    // values of the merged rows of both selections, which the fused scans of Exact, Sparse and Counts read
+    double scannedValues(const DEProblem& problem)
+    {
+        return static_cast<double>(problem.numDimensions) * (problem.sizeA + problem.sizeB - std::min(problem.overlap, std::min(problem.sizeA, problem.sizeB)));
+    }
+
+    StrategyEstimate estimateExact(const DEProblem& problem, const DEOptions& options)
+    {
+        const double values = static_cast<double>(problem.numDimensions) * (problem.sizeA + problem.sizeB);
+        const double nonZeros = values * problem.nonZeroFraction;
+        const double scanned = scannedValues(problem);
+
+        StrategyEstimate estimate;
+        estimate.strategy = DEStrategy::Exact;
+        estimate.peakBytes = static_cast<std::uint64_t>(values) * problem.elementBytes + problem.numDimensions * resultBytesPerDimension;
+
+        double ns = values * allocateNs + (problem.sparseStorage ? nonZeros * scatterSparseNs : values * gatherDenseNs + (scanned - values) * readDenseNs);
+        ns += values * (options.medians ? selectNs : passNs);
+        if (options.additionalStatistics)
+            ns += values * passNs;
+        if (options.statisticalTests)
+            ns += values * passNs + nonZeros * sortNs * log2Length(nonZeros / (2.0 * problem.numDimensions));
+
+        estimate.seconds = ns * 1e-9;
+        return estimate;
+    }
+
+    StrategyEstimate estimateSparse(const DEProblem& problem, const DEOptions& options)
+    {
+        const double values = static_cast<double>(problem.numDimensions) * (problem.sizeA + problem.sizeB);
+        const double nonZeros = values * problem.nonZeroFraction;
+
+        StrategyEstimate estimate;
+        estimate.strategy = DEStrategy::Sparse;
+        estimate.peakBytes = static_cast<std::uint64_t>(nonZeros) * problem.elementBytes + 2 * (problem.numDimensions + 1) * sizeof(std::uint64_t) + problem.numDimensions * resultBytesPerDimension;
+
+        // one pass over the merged rows to count the non-zeros per dimension, one to gather them
+        const double scanned = scannedValues(problem);
+        double ns = 2.0 * (problem.sparseStorage ? scanned * problem.nonZeroFraction * countSparseNs : scanned * countDenseNs);
+        ns += nonZeros * (options.medians ? selectNs : passNs);
+        if (options.additionalStatistics)
+            ns += nonZeros * passNs;
+        if (options.statisticalTests)
+            ns += nonZeros * sortNs * log2Length(nonZeros / (2.0 * problem.numDimensions));
+
+        estimate.seconds = ns * 1e-9;
+        return estimate;
+    }
+
+    StrategyEstimate estimateCounts(const DEProblem& problem, const DEOptions& options, std::uint64_t countBins)
+    {
+        StrategyEstimate estimate;
+        estimate.strategy = DEStrategy::Counts;
+        estimate.applicable = countBins > 0;
+        estimate.peakBytes = 2 * countBins * sizeof(std::uint32_t) + problem.numDimensions * resultBytesPerDimension;
+
+        // one pass over the merged rows to count the non-zeros per dimension, then a few walks over the bins
+        const double scanned = scannedValues(problem);
+        double ns = problem.sparseStorage ? scanned * problem.nonZeroFraction * countSparseNs : scanned * countDenseNs;
+        ns += 2.0 * countBins * (options.statisticalTests ? 5.0 : 3.0) * countBinNs;
+
+        estimate.seconds = ns * 1e-9;
+        return estimate;
+    }
+
+    StrategyEstimate estimateTransposed(const DEProblem& problem, const DEOptions& options, double threads)
+    {
+        const double values = static_cast<double>(problem.numDimensions) * (problem.sizeA + problem.sizeB);
+        const double nonZeros = values * problem.nonZeroFraction;
+
+        StrategyEstimate estimate;
+        estimate.strategy = DEStrategy::Transposed;
+        estimate.applicable = problem.transposedCopy;
+
+        // the non-zeros of one dimension per thread, and for sparse copies the selection of every row
+        estimate.peakBytes = static_cast<std::uint64_t>(threads * (problem.sizeA + problem.sizeB) * problem.elementBytes) + problem.numDimensions * resultBytesPerDimension;
+        if (problem.sparseStorage)
+            estimate.peakBytes += problem.numRows;
+
+        double ns = problem.sparseStorage ? static_cast<double>(problem.numDimensions) * problem.numRows * problem.nonZeroFraction * lookupTransposedNs : values * readTransposedNs;
+        ns += nonZeros * (options.medians ? selectNs : passNs);
+        if (options.additionalStatistics)
+            ns += nonZeros * passNs;
+        if (options.statisticalTests)
+            ns += nonZeros * sortNs * log2Length(nonZeros / (2.0 * problem.numDimensions));
+
+        estimate.seconds = ns * 1e-9;
+        return estimate;
+    }
+
+    StrategyEstimate estimateHistogram(const DEProblem& problem, const DEOptions& options, const ChunkPlan& chunks, DEStrategy strategy)
+    {
+        const double values = static_cast<double>(problem.numDimensions) * (problem.sizeA + problem.sizeB);
+        const double nonZeros = values * problem.nonZeroFraction;
+
+        StrategyEstimate estimate;
+        estimate.strategy = strategy;
+        estimate.exact = false;
+        estimate.applicable = !options.minValues.empty() && !options.rescaleValues.empty();
+        estimate.peakBytes = chunks.fixedBytes + std::min<std::uint64_t>(chunks.blockBytes, std::max<std::size_t>(1, problem.numRows) * membershipBytesPerRow(2));
+
+        double ns = problem.sparseStorage ? nonZeros * binSparseNs : values * binDenseNs;
+        ns += static_cast<double>(problem.numRows) * membershipNs;
+        ns += 2.0 * problem.numDimensions * chunks.numBins * binCompareNs;
+        if (strategy == DEStrategy::Chunked)
+            ns *= chunkOverhead;
+
+        estimate.seconds = ns * 1e-9;
+        return estimate;
+    }
+
+    // The problem restricted to options.dimensions, which Exact, Sparse, Counts and Transposed compute exclusively
+    DEProblem computedProblem(DEProblem problem, const DEOptions& options)
+    {
+        if (!options.dimensions.empty())
+            problem.numDimensions = std::min(problem.numDimensions, options.dimensions.size());
+        return problem;
+    }
+
+    bool faster(const StrategyEstimate& a, const StrategyEstimate& b)
+    {
+        return a.seconds < b.seconds;
+    }
+}
+
+const char* strategyName(DEStrategy strategy)
+{
+    switch (strategy)
+    {
+    case DEStrategy::Automatic:     return "Automatic";
+    case DEStrategy::Exact:         return "Exact";
+    case DEStrategy::Sparse:        return "Sparse";
+    case DEStrategy::Counts:        return "Counts";
+    case DEStrategy::Transposed:    return "Transposed";
+    case DEStrategy::Histogram:     return "Histogram";
+    case DEStrategy::Chunked:       return "Chunked";
+    }
+    return "";
+}
+
+template <typename Matrix>
+DEProblem describeProblem(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, std::size_t sampleRows)
+{
+    DEProblem problem;
+    problem.numRows = matrix.numRows;
+    problem.numDimensions = matrix.numColumns;
+    problem.sizeA = selectionA.size();
+    problem.sizeB = selectionB.size();
+    problem.overlap = countOverlap(selectionA, selectionB);
+    problem.sparseStorage = std::is_same_v<Matrix, SparseMatrixView<typename Matrix::value_type>>;
+    problem.elementBytes = sizeof(typename Matrix::value_type);
+
+    if (matrix.numColumns == 0)
+        return problem;
+
+    std::uint64_t values = 0, nonZeros = 0;
+    for (const RowIndices selection : { selectionA, selectionB })
+    {
+        if constexpr (std::is_same_v<Matrix, SparseMatrixView<typename Matrix::value_type>>)
+        {
+            for (const std::uint32_t row : selection)
+                nonZeros += matrix.rowOffsets[row + 1] - matrix.rowOffsets[row];
+            values += selection.size() * matrix.numColumns;
+        }
+        else
+        {
+            // evenly spaced rows of the selection
+            const std::size_t numSamples = std::min(sampleRows, selection.size());
+            for (std::size_t i = 0; i < numSamples; ++i)
+            {
+                const auto* row = matrix.row(selection[i * selection.size() / numSamples]);
+                for (std::size_t column = 0; column < matrix.numColumns; ++column)
+                    if (static_cast<float>(row[column]) != 0.0f)
+                        ++nonZeros;
+            }
+            values += numSamples * matrix.numColumns;
+        }
+    }
+
+    if (values > 0)
+        problem.nonZeroFraction = static_cast<double>(nonZeros) / values;
+
+    return problem;
+}
+
+const StrategyEstimate& DEPlan::chosen() const
+{
+    return estimates[static_cast<std::size_t>(strategy) - static_cast<std::size_t>(DEStrategy::Exact)];
+}
+
+std::string DEPlan::describe() const
+{
+    std::ostringstream stream;
+    stream.setf(std::ios::fixed);
+    stream.precision(2);
+
+    const StrategyEstimate& estimate = chosen();
+    stream << strategyName(strategy) << (estimate.exact ? " (exact): " : " (approximate medians and rank tests): ")
+           << PerformanceTrace::formatBytes(estimate.peakBytes) << " peak, about " << estimate.seconds << " s";
+
+    if (!estimate.applicable && strategy == DEStrategy::Transposed)
+        stream << ", no dimension-major copy of the data";
+    else if (!estimate.applicable && !rangesKnown)
+        stream << ", needs the dimension ranges";
+    else if (!estimate.applicable)
+        stream << ", not applicable to dimensions with fractional values";
+    else if (!feasible)
+        stream << ", exceeds the budget of " << PerformanceTrace::formatBytes(budget);
+
+    return stream.str();
+}
+
+DEPlan planDifferentialExpression(const DEProblem& problem, const DEOptions& options, std::uint64_t memoryBudget, DEStrategy requested, int numThreads)
+{
+    const double threads = numThreads > 0 ? numThreads : TaskPool::shared().concurrency();
+
+    const ChunkPlan singleChunk = planSingleChunk(2, problem.numDimensions, 1, problem.numRows);
+    ChunkPlan chunks = planChunks(2, problem.numDimensions, 1, memoryBudget);
+
+    // a chunk needs room for at least one row
+    if (chunks.blockBytes < membershipBytesPerRow(2))
+        chunks.blockBytes = 0;
+
+    DEPlan plan;
+    plan.budget = memoryBudget;
+    plan.rangesKnown = !options.minValues.empty();
+    plan.estimates = {
+        local::estimateExact(local::computedProblem(problem, options), options),
+        local::estimateSparse(local::computedProblem(problem, options), options),
+        local::estimateCounts(local::computedProblem(problem, options), options, countHistogramBins(options, problem.numDimensions)),
+        local::estimateTransposed(local::computedProblem(problem, options), options, threads),
+        local::estimateHistogram(problem, options, singleChunk, DEStrategy::Histogram),
+        local::estimateHistogram(problem, options, chunks, DEStrategy::Chunked),
+    };
+
+    for (StrategyEstimate& estimate : plan.estimates)
+    {
+        estimate.seconds /= threads;
+        estimate.fits = estimate.applicable && estimate.peakBytes <= memoryBudget;
+    }
+    plan.estimates.back().fits = plan.estimates.back().applicable && chunks.fits();
+
+    if (requested == DEStrategy::Automatic)
+    {
+        const StrategyEstimate* best = nullptr;
+        for (const bool exact : { true, false })
+        {
+            for (const StrategyEstimate& estimate : plan.estimates)
+                if (estimate.fits && estimate.exact == exact && (!best || local::faster(estimate, *best)))
+                    best = &estimate;
+
+            if (best)
+                break;
+        }
+
+        // nothing fits, report the applicable strategy that needs the least memory
+        if (!best)
+            for (const StrategyEstimate& estimate : plan.estimates)
+                if (estimate.applicable && (!best || estimate.peakBytes < best->peakBytes))
+                    best = &estimate;
+
+        requested = best->strategy;
+    }
+
+    plan.strategy = requested;
+    plan.feasible = plan.chosen().fits;
+    plan.chunks = requested == DEStrategy::Histogram ? singleChunk : chunks;
+
+    return plan;
+}
+
+std::size_t progressSteps(const DEPlan& plan, const DEProblem& problem, const DEOptions& options)
+{
+    const std::size_t numDimensions = local::computedProblem(problem, options).numDimensions;
+
+    switch (plan.strategy)
+    {
+    case DEStrategy::Sparse:
+    case DEStrategy::Counts:
+        return 3 * numDimensions;
+    case DEStrategy::Transposed:
+        return numDimensions;
+    case DEStrategy::Histogram:
+    case DEStrategy::Chunked:
+        return problem.numRows;
+    default:
+        return problem.sizeA + problem.sizeB + (options.statisticalTests ? 2 : 1) * numDimensions;
+    }
+}
+
+template <typename Matrix>
+DEResult computeDifferentialExpressionPlanned(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, const DEPlan& plan, ProgressSink* progress, PerformanceTrace* trace,
+                                              const Matrix* transposed)
+{
+    switch (plan.strategy)
+    {
+    case DEStrategy::Transposed:
+        if (transposed)
+            return computeDifferentialExpressionTransposed(*transposed, selectionA, selectionB, options, progress, trace);
+        [[fallthrough]];
+    case DEStrategy::Sparse:
+        return computeDifferentialExpressionSparse(matrix, selectionA, selectionB, options, progress, trace);
+    case DEStrategy::Counts:
+        return computeDifferentialExpressionCounts(matrix, selectionA, selectionB, options, progress, trace);
+    case DEStrategy::Histogram:
+    case DEStrategy::Chunked:
+        return computeDifferentialExpressionChunked(matrix, selectionA, selectionB, options, plan.chunks, progress, trace);
+    default:
+        return computeDifferentialExpression(matrix, selectionA, selectionB, options, progress, trace);
+    }
+}
+
+#define DE_INSTANTIATE_STRATEGY_PLANNER(T)                                                                                                                                       \
+    template DEProblem describeProblem(const DenseMatrixView<T>&, RowIndices, RowIndices, std::size_t);                                                                          \
+    template DEProblem describeProblem(const SparseMatrixView<T>&, RowIndices, RowIndices, std::size_t);                                                                         \
+    template DEResult computeDifferentialExpressionPlanned(const DenseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, const DEPlan&, ProgressSink*, PerformanceTrace*, const DenseMatrixView<T>*); \
+    template DEResult computeDifferentialExpressionPlanned(const SparseMatrixView<T>&, RowIndices, RowIndices, const DEOptions&, const DEPlan&, ProgressSink*, PerformanceTrace*, const SparseMatrixView<T>*);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_STRATEGY_PLANNER)
+
+} // namespace de
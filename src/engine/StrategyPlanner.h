@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ChunkedStatistics.h"
+#include "DifferentialExpression.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace de
+{
+
+/** Algorithms that compute the statistics of two selections */
+enum class DEStrategy
+{
+    Automatic,      // chosen by planDifferentialExpression
+    Exact,          // copies the selected values per dimension, see computeDifferentialExpression
+    Sparse,         // gathers only the selected non-zeros per dimension, see computeDifferentialExpressionSparse
+    Counts,         // counts integer values into a histogram per dimension, see computeDifferentialExpressionCounts
+    Transposed,     // reads the non-zeros per dimension from a dimension-major copy, see computeDifferentialExpressionTransposed
+    Histogram,      // aggregates all rows in one block; medians and rank tests are approximate
+    Chunked,        // aggregates blocks of rows within the budget; medians and rank tests are approximate
+};
+
+const char* strategyName(DEStrategy strategy);
+
+/** The sizes the planner estimates from */
+struct DEProblem
+{
+    std::size_t numRows             = 0;
+    std::size_t numDimensions       = 0;
+    std::size_t sizeA               = 0;
+    std::size_t sizeB               = 0;
+    std::size_t overlap             = 0;        // rows in both selections, Exact, Sparse and Counts read them once
+    double      nonZeroFraction     = 1.0;      // of the selected values
+    bool        sparseStorage       = false;    // CSR matrix
+    std::size_t elementBytes        = 4;        // of the stored type, Exact and Sparse copy values in it
+    bool        transposedCopy      = false;    // a dimension-major copy of the matrix is at hand, see transposeMatrix
+};
+
+/*  Sizes of comparing \p selectionA and \p selectionB of \p matrix
+    The non-zero fraction is counted from the row offsets of sparse matrices and sampled
+    from up to \p sampleRows rows of each selection of dense ones.
+*/
+template <typename Matrix>
+DEProblem describeProblem(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, std::size_t sampleRows = 512);
+
+struct StrategyEstimate
+{
+    DEStrategy      strategy    = DEStrategy::Exact;
+    std::uint64_t   peakBytes   = 0;        // working memory on top of the matrix itself
+    double          seconds     = 0.0;      // rough, from a per-value cost model
+    bool            exact       = true;
+    bool            applicable  = true;     // false for Counts if a dimension is not integer-valued, for Transposed without a copy, for Counts, Histogram and Chunked without ranges
+    bool            fits        = false;    // peakBytes is within the budget
+};
+
+struct DEPlan
+{
+    DEStrategy                      strategy    = DEStrategy::Exact;
+    bool                            feasible    = false;    // the chosen strategy fits the budget
+    std::uint64_t                   budget      = 0;
+    bool                            rangesKnown = true;     // options.minValues were given, which Counts, Histogram and Chunked need
+    ChunkPlan                       chunks;                 // for Histogram and Chunked
+    std::vector<StrategyEstimate>   estimates;              // Exact, Sparse, Counts, Transposed, Histogram, Chunked
+
+    const StrategyEstimate& chosen() const;
+
+    /** One line for the user, e.g. "Sparse (exact): 1.2 GB peak, about 0.8 s" */
+    std::string describe() const;
+};
+
+/*  Estimates the peak memory and runtime of every strategy and picks one
+    With DEStrategy::Automatic the fastest exact strategy that fits \p memoryBudget is chosen,
+    the fastest approximate one only if no exact strategy fits. A requested strategy is kept,
+    the plan is infeasible if it does not fit or does not apply. Histogram and Chunked apply if options.minValues
+    and options.rescaleValues are given; Counts applies if options.integralDimensions marks every computed dimension
+    as integer-valued, see countHistogramBins; Transposed if problem.transposedCopy is set. Exact, Sparse, Counts
+    and Transposed are estimated for the columns of options.dimensions only, Histogram and Chunked aggregate all
+    columns. \p numThreads 0 uses the concurrency of the shared task pool.
+*/
+DEPlan planDifferentialExpression(const DEProblem& problem, const DEOptions& options, std::uint64_t memoryBudget, DEStrategy requested = DEStrategy::Automatic, int numThreads = 0);
+
+/** Progress steps the strategy of \p plan reports in total */
+std::size_t progressSteps(const DEPlan& plan, const DEProblem& problem, const DEOptions& options);
+
+/*  Runs the strategy of \p plan, which should be feasible
+    Transposed reads \p transposed, the dimension-major copy of \p matrix; without it Sparse runs instead.
+*/
+template <typename Matrix>
+DEResult computeDifferentialExpressionPlanned(const Matrix& matrix, RowIndices selectionA, RowIndices selectionB, const DEOptions& options, const DEPlan& plan, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr,
+                                              const Matrix* transposed = nullptr);
+
+} // namespace de
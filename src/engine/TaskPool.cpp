@@ -0,0 +1,216 @@
+#include "TaskPool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+namespace de
+{
+
+namespace local
+{
+    // the pool whose worker the calling thread is, and its slot there
+    thread_local const TaskPool* currentPool = nullptr;
+    thread_local std::size_t currentSlot = 0;
+
+    std::size_t hardwareThreads()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // as OpenMP did, so existing settings keep working
+    std::size_t threadsFromEnvironment()
+    {
+        if (const char* value = std::getenv("OMP_NUM_THREADS"))
+        {
+            try
+            {
+                const long threads = std::stol(value);
+                if (threads > 0)
+                    return static_cast<std::size_t>(threads);
+            }
+            catch (const std::exception&)
+            {
+            }
+        }
+        return hardwareThreads();
+    }
+}
+
+TaskPool& TaskPool::shared()
+{
+    static TaskPool pool(local::threadsFromEnvironment());
+    return pool;
+}
+
+TaskPool::TaskPool(std::size_t numThreads)
+{
+    if (numThreads == 0)
+        numThreads = local::hardwareThreads();
+
+    _concurrency = numThreads;
+
+    for (std::size_t slot = 0; slot < numThreads; ++slot)
+        _queues.push_back(std::make_unique<Queue>());
+
+    for (std::size_t slot = 1; slot < numThreads; ++slot)
+        _workers.emplace_back([this, slot]() { work(slot); });
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for (std::thread& worker : _workers)
+        worker.join();
+}
+
+void TaskPool::setConcurrency(std::size_t concurrency)
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _concurrency = std::clamp<std::size_t>(concurrency, 1, numThreads());
+    }
+    _wake.notify_all();
+}
+
+std::size_t TaskPool::slot() const
+{
+    return local::currentPool == this ? local::currentSlot : 0;
+}
+
+void TaskPool::work(std::size_t slot)
+{
+    local::currentPool = this;
+    local::currentSlot = slot;
+
+    while (true)
+    {
+        Task task;
+        if (slot < _concurrency && (pop(slot, nullptr, task) || steal(slot, nullptr, task)))
+        {
+            execute(task, slot);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_wakeMutex);
+        _wake.wait(lock, [this, slot]() { return _stop || (slot < _concurrency && _queued > 0); });
+        if (_stop)
+            return;
+    }
+}
+
+void TaskPool::run(Job& job, std::size_t first, std::size_t last)
+{
+    const std::size_t ownSlot = slot();
+
+    execute({ &job, first, last }, ownSlot);
+
+    // help with the ranges of this loop only, a thread never resumes another loop while this one is on its stack
+    while (job.remaining > 0)
+    {
+        Task task;
+        if (pop(ownSlot, &job, task) || steal(ownSlot, &job, task))
+        {
+            execute(task, ownSlot);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done.wait_for(lock, std::chrono::microseconds(100), [&job]() { return job.remaining == 0; });
+    }
+
+    // the thread that finished the last range has released the job
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+void TaskPool::execute(Task task, std::size_t slot)
+{
+    Job& job = *task.job;
+
+    while (task.last - task.first > job.grain)
+    {
+        const std::size_t middle = task.first + (task.last - task.first) / 2;
+        push(slot, { &job, middle, task.last });
+        task.last = middle;
+    }
+
+    if (!job.failed)
+    {
+        try
+        {
+            job.runRange(job.body, task.first, task.last);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.failed.exchange(true))
+                job.error = std::current_exception();
+        }
+    }
+
+    // under the lock, so the caller cannot return and free the job before it is notified
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (job.remaining.fetch_sub(task.last - task.first) == task.last - task.first)
+        job.done.notify_all();
+}
+
+void TaskPool::push(std::size_t slot, const Task& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_queues[slot]->mutex);
+        _queues[slot]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        ++_queued;
+    }
+    _wake.notify_one();
+}
+
+bool TaskPool::pop(std::size_t slot, const Job* job, Task& task)
+{
+    Queue& queue = *_queues[slot];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    for (auto candidate = queue.tasks.rbegin(); candidate != queue.tasks.rend(); ++candidate)
+    {
+        if (job == nullptr || candidate->job == job)
+        {
+            task = *candidate;
+            queue.tasks.erase(std::next(candidate).base());
+            --_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::steal(std::size_t slot, const Job* job, Task& task)
+{
+    for (std::size_t offset = 1; offset < _queues.size(); ++offset)
+    {
+        Queue& queue = *_queues[(slot + offset) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        for (auto candidate = queue.tasks.begin(); candidate != queue.tasks.end(); ++candidate)
+        {
+            if (job == nullptr || candidate->job == job)
+            {
+                task = *candidate;
+                queue.tasks.erase(candidate);
+                --_queued;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace de
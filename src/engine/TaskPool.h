@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace de
+{
+
+/*  Pool of worker threads for the parallel loops of the engine, one per process is shared by all DE views
+    parallelFor splits its range in halves down to a grain. A thread pushes the halves it splits off to the back
+    of its own queue and takes its next range from there; idle threads steal from the front of the other queues,
+    where the largest ranges are. The calling thread works on its own loop too, so loops may nest, and loops of
+    several views share the workers instead of each starting a team of threads. The cap of concurrency() applies
+    to the workers: at most concurrency() - 1 of them take ranges at a time. Every thread calling parallelFor from
+    outside the pool works on its own loop in addition, as slot 0, so loops started by several threads at once may
+    keep more threads busy.
+*/
+class TaskPool
+{
+public:
+    /** The pool of the process, of OMP_NUM_THREADS threads if set, else of one thread per hardware thread */
+    static TaskPool& shared();
+
+    /** \p numThreads threads including a caller, 0 for one per hardware thread */
+    explicit TaskPool(std::size_t numThreads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /** Threads of the pool including a caller, the bound of slot() */
+    std::size_t numThreads() const { return _workers.size() + 1; }
+
+    /** Workers that take ranges plus one for a caller, at most numThreads() */
+    std::size_t concurrency() const { return _concurrency; }
+
+    /** Parks the workers beyond \p concurrency - 1, the callers of parallelFor always work on their loops */
+    void setConcurrency(std::size_t concurrency);
+
+    /** Index of the calling thread below numThreads(), 0 outside the workers; distinct for the threads of a loop, e.g. for per-thread buffers */
+    std::size_t slot() const;
+
+    /*  Calls body(i) for every i in [first, last) on the calling thread and idle workers, returns when all are done
+        Ranges of at most \p grain indices run on one thread, 0 picks a grain of about eight ranges per thread.
+        The first exception thrown by body is rethrown here, indices that did not start by then are skipped.
+    */
+    template <typename Body>
+    void parallelFor(std::size_t first, std::size_t last, Body&& body, std::size_t grain = 0)
+    {
+        if (first >= last)
+            return;
+
+        using BodyType = std::remove_reference_t<Body>;
+        auto runRange = [](void* context, std::size_t begin, std::size_t end) {
+            BodyType& rangeBody = *static_cast<BodyType*>(context);
+            for (std::size_t i = begin; i < end; ++i)
+                rangeBody(i);
+            };
+
+        if (grain == 0)
+            grain = std::max<std::size_t>(1, (last - first) / (8 * _concurrency));
+
+        if (_concurrency == 1 || last - first <= grain)
+        {
+            runRange(&body, first, last);
+            return;
+        }
+
+        Job job(runRange, const_cast<void*>(static_cast<const void*>(&body)), grain, last - first);
+        run(job, first, last);
+    }
+
+private:
+    /** A parallelFor, on the stack of its caller */
+    struct Job
+    {
+        Job(void (*runRange)(void*, std::size_t, std::size_t), void* body, std::size_t grain, std::size_t size) :
+            runRange(runRange), body(body), grain(grain), remaining(size)
+        {
+        }
+
+        void                        (*runRange)(void*, std::size_t, std::size_t);
+        void*                       body;
+        std::size_t                 grain;
+        std::atomic<std::size_t>    remaining;      // indices not done
+        std::atomic<bool>           failed = false;
+        std::exception_ptr          error;          // the first exception of body
+        std::mutex                  mutex;
+        std::condition_variable     done;
+    };
+
+    struct Task
+    {
+        Job*        job = nullptr;
+        std::size_t first = 0;
+        std::size_t last = 0;
+    };
+
+    /** Tasks split off by a thread, queue 0 is shared by the threads outside the pool */
+    struct Queue
+    {
+        std::mutex          mutex;
+        std::deque<Task>    tasks;
+    };
+
+    void work(std::size_t slot);
+
+    /** Runs \p job from the calling thread and helps with its tasks until all are done */
+    void run(Job& job, std::size_t first, std::size_t last);
+
+    /** Splits \p task down to the grain, pushing the upper halves to queue \p slot, and runs the rest */
+    void execute(Task task, std::size_t slot);
+
+    void push(std::size_t slot, const Task& task);
+
+    /** The newest task of queue \p slot, of \p job only unless it is null */
+    bool pop(std::size_t slot, const Job* job, Task& task);
+
+    /** The oldest task of another queue than \p slot, of \p job only unless it is null */
+    bool steal(std::size_t slot, const Job* job, Task& task);
+
+private:
+    std::vector<std::unique_ptr<Queue>> _queues;            // one per slot
+    std::vector<std::thread>            _workers;           // slots 1 ... numThreads() - 1
+    std::atomic<std::size_t>            _concurrency = 1;
+    std::atomic<std::size_t>            _queued = 0;        // tasks in all queues
+    std::atomic<bool>                   _stop = false;
+    std::mutex                          _wakeMutex;
+    std::condition_variable             _wake;
+};
+
+} // namespace de
@@ -0,0 +1,230 @@
+#include "TransposedMatrix.h"
+
+#include "TaskPool.h"
+
+#include <algorithm>
+
+namespace de
+{
+
+namespace local
+{
+    template <typename T>
+    T* typedValues(MatrixData& matrix)
+    {
+        return reinterpret_cast<T*>(matrix.values.data());
+    }
+
+    // Threads own tiles of rows of the source, i.e. tiles of columns of the copy, so their writes never overlap
+    template <typename T>
+    void transposeDense(const DenseMatrixView<T>& matrix, T* transposed, ProgressSink* progress)
+    {
+        const std::size_t numRows = matrix.numRows;
+        const std::size_t numColumns = matrix.numColumns;
+        const std::size_t numRowTiles = (numRows + transposeTileSize - 1) / transposeTileSize;
+
+        TaskPool::shared().parallelFor(0, numRowTiles, [&](std::size_t rowTile) {
+            if (progress && progress->canceled())
+                return;
+
+            const std::size_t firstRow = rowTile * transposeTileSize;
+            const std::size_t lastRow = std::min(firstRow + transposeTileSize, numRows);
+
+            for (std::size_t firstColumn = 0; firstColumn < numColumns; firstColumn += transposeTileSize)
+            {
+                const std::size_t lastColumn = std::min(firstColumn + transposeTileSize, numColumns);
+                for (std::size_t column = firstColumn; column < lastColumn; ++column)
+                {
+                    T* transposedRow = transposed + column * numRows;
+                    for (std::size_t row = firstRow; row < lastRow; ++row)
+                        transposedRow[row] = matrix.row(row)[column];
+                }
+            }
+
+            if (progress)
+                progress->advance(lastRow - firstRow);
+            });
+    }
+
+    // Counts the stored elements per column, then fills the columns in increasing order of rows
+    template <typename T>
+    void transposeSparse(const SparseMatrixView<T>& matrix, MatrixData& transposed, ProgressSink* progress)
+    {
+        const std::size_t numNonZeros = matrix.numNonZeros();
+        const std::uint64_t first = matrix.numRows == 0 ? 0 : matrix.rowOffsets[0];
+
+        transposed.rowOffsets.assign(matrix.numColumns + 1, 0);
+        for (std::uint64_t k = first; k < first + numNonZeros; ++k)
+            ++transposed.rowOffsets[matrix.columnIndices[k] + 1];
+        for (std::size_t column = 0; column < matrix.numColumns; ++column)
+            transposed.rowOffsets[column + 1] += transposed.rowOffsets[column];
+
+        transposed.columnIndices.resize(numNonZeros);
+        transposed.values.resize(numNonZeros * sizeof(T));
+        T* values = typedValues<T>(transposed);
+
+        std::vector<std::uint64_t> next(transposed.rowOffsets.begin(), transposed.rowOffsets.end() - 1);
+        for (std::size_t row = 0; row < matrix.numRows; ++row)
+        {
+            for (std::uint64_t k = matrix.rowOffsets[row]; k < matrix.rowOffsets[row + 1]; ++k)
+            {
+                const std::uint64_t position = next[matrix.columnIndices[k]]++;
+                transposed.columnIndices[position] = static_cast<std::uint32_t>(row);
+                values[position] = matrix.values[k];
+            }
+
+            if (progress && (row + 1) % 1024 == 0)
+            {
+                progress->advance(1024);
+                if (progress->canceled())
+                    return;
+            }
+        }
+
+        if (progress)
+            progress->advance(matrix.numRows % 1024);
+    }
+}
+
+template <typename Matrix>
+MatrixData transposeMatrix(const Matrix& matrix, ProgressSink* progress, PerformanceTrace* trace)
+{
+    using T = typename Matrix::value_type;
+
+    PerformanceTrace::Scope scope(trace, "Transpose", "de", transposedBytes(matrix));
+
+    MatrixData transposed;
+    transposed.elementType = elementTypeOf<T>;
+    transposed.numRows = matrix.numColumns;
+    transposed.numColumns = matrix.numRows;
+
+    if constexpr (isSparseMatrix<Matrix>)
+    {
+        transposed.storage = MatrixStorage::Sparse;
+        local::transposeSparse(matrix, transposed, progress);
+    }
+    else
+    {
+        transposed.storage = MatrixStorage::Dense;
+        transposed.values.resize(matrix.numRows * matrix.numColumns * sizeof(T));
+        local::transposeDense(matrix, local::typedValues<T>(transposed), progress);
+    }
+
+    if (progress && progress->canceled())
+        return {};
+
+    return transposed;
+}
+
+template <typename Matrix>
+std::uint64_t transposedBytes(const Matrix& matrix)
+{
+    using T = typename Matrix::value_type;
+
+    if constexpr (isSparseMatrix<Matrix>)
+        return matrix.numNonZeros() * (sizeof(T) + sizeof(std::uint32_t)) + (matrix.numColumns + 1) * sizeof(std::uint64_t);
+    else
+        return static_cast<std::uint64_t>(matrix.numRows) * matrix.numColumns * sizeof(T);
+}
+
+TransposedCache::TransposedCache(std::uint64_t capacityBytes) :
+    _capacity(capacityBytes)
+{
+}
+
+std::uint64_t TransposedCache::capacity() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _capacity;
+}
+
+std::uint64_t TransposedCache::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size;
+}
+
+void TransposedCache::setCapacity(std::uint64_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capacity = capacityBytes;
+    evict(0);
+}
+
+std::shared_ptr<const MatrixData> TransposedCache::find(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto entry = std::find_if(_entries.begin(), _entries.end(), [&key](const Entry& entry) { return entry.key == key; });
+    if (entry == _entries.end())
+        return nullptr;
+
+    _entries.splice(_entries.begin(), _entries, entry);
+    return entry->matrix;
+}
+
+bool TransposedCache::contains(const std::string& key) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::any_of(_entries.begin(), _entries.end(), [&key](const Entry& entry) { return entry.key == key; });
+}
+
+bool TransposedCache::insert(const std::string& key, std::shared_ptr<const MatrixData> matrix)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto previous = std::find_if(_entries.begin(), _entries.end(), [&key](const Entry& entry) { return entry.key == key; });
+    if (previous != _entries.end())
+    {
+        _size -= previous->bytes;
+        _entries.erase(previous);
+    }
+
+    const std::uint64_t bytes = matrix ? matrix->bytes() : 0;
+    if (!matrix || bytes > _capacity)
+        return false;
+
+    evict(bytes);
+    _entries.push_front({ key, std::move(matrix), bytes });
+    _size += bytes;
+
+    return true;
+}
+
+void TransposedCache::erase(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto entry = std::find_if(_entries.begin(), _entries.end(), [&key](const Entry& entry) { return entry.key == key; });
+    if (entry == _entries.end())
+        return;
+
+    _size -= entry->bytes;
+    _entries.erase(entry);
+}
+
+void TransposedCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+    _size = 0;
+}
+
+void TransposedCache::evict(std::uint64_t bytes)
+{
+    while (!_entries.empty() && _size + bytes > _capacity)
+    {
+        _size -= _entries.back().bytes;
+        _entries.pop_back();
+    }
+}
+
+#define DE_INSTANTIATE_TRANSPOSED_MATRIX(T)                                                                     \
+    template MatrixData transposeMatrix(const DenseMatrixView<T>&, ProgressSink*, PerformanceTrace*);         \
+    template MatrixData transposeMatrix(const SparseMatrixView<T>&, ProgressSink*, PerformanceTrace*);        \
+    template std::uint64_t transposedBytes(const DenseMatrixView<T>&);                                         \
+    template std::uint64_t transposedBytes(const SparseMatrixView<T>&);
+
+DE_FOR_ALL_ELEMENT_TYPES(DE_INSTANTIATE_TRANSPOSED_MATRIX)
+
+} // namespace de
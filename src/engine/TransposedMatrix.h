@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MatrixIO.h"
+#include "MatrixView.h"
+#include "PerformanceTrace.h"
+#include "ProgressSink.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace de
+{
+
+/** Rows and columns of the tiles in which dense matrices are transposed, a tile of floats fits in L1 */
+constexpr std::size_t transposeTileSize = 64;
+
+/*  Dimension-major copy of \p matrix: row d of the copy holds column d of the matrix
+    Dense matrices are transposed in tiles of transposeTileSize x transposeTileSize elements, so that
+    reads and writes both stay within a few cache lines; sparse matrices become the CSR form of their
+    transpose (compressed columns), with the rows of every column in increasing order.
+    Progress is reported in rows of \p matrix. Returns an empty matrix if \p progress is canceled.
+*/
+template <typename Matrix>
+MatrixData transposeMatrix(const Matrix& matrix, ProgressSink* progress = nullptr, PerformanceTrace* trace = nullptr);
+
+/** \p transposed, made by transposeMatrix from a matrix of type Matrix, as a view of the same type */
+template <typename Matrix>
+Matrix transposedView(const MatrixData& transposed)
+{
+    using T = typename Matrix::value_type;
+    const T* values = reinterpret_cast<const T*>(transposed.values.data());
+
+    if constexpr (isSparseMatrix<Matrix>)
+        return { transposed.rowOffsets.data(), transposed.columnIndices.data(), values, transposed.numRows, transposed.numColumns };
+    else
+        return { values, transposed.numRows, transposed.numColumns };
+}
+
+/** Bytes of the copy transposeMatrix makes of \p matrix */
+template <typename Matrix>
+std::uint64_t transposedBytes(const Matrix& matrix);
+
+/*  Transposed copies of datasets within a memory cap, the least recently used copy is evicted first
+    Thread-safe, so copies can be built and inserted in the background. Copies are shared: one that is
+    evicted stays valid for a computation that still holds it.
+*/
+class TransposedCache
+{
+public:
+    explicit TransposedCache(std::uint64_t capacityBytes = 0);
+
+    std::uint64_t capacity() const;
+    std::uint64_t size() const;     // bytes of the cached copies
+
+    /** Evicts copies until the cached ones fit \p capacityBytes */
+    void setCapacity(std::uint64_t capacityBytes);
+
+    /** The copy cached under \p key, marked as most recently used; nullptr if there is none */
+    std::shared_ptr<const MatrixData> find(const std::string& key);
+
+    /** A copy is cached under \p key, without marking it as used */
+    bool contains(const std::string& key) const;
+
+    /** Caches \p matrix under \p key, evicting the least recently used copies; false if it alone exceeds the capacity */
+    bool insert(const std::string& key, std::shared_ptr<const MatrixData> matrix);
+
+    void erase(const std::string& key);
+    void clear();
+
+private:
+    struct Entry
+    {
+        std::string                         key;
+        std::shared_ptr<const MatrixData>   matrix;
+        std::uint64_t                       bytes = 0;
+    };
+
+    /** Evicts from the back until \p bytes more fit, call with the mutex locked */
+    void evict(std::uint64_t bytes);
+
+private:
+    mutable std::mutex  _mutex;
+    std::list<Entry>    _entries;       // most recently used first
+    std::uint64_t       _capacity   = 0;
+    std::uint64_t       _size       = 0;
+};
+
+} // namespace de